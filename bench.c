@@ -0,0 +1,496 @@
+#include <stdio.h>
+#include "mnet.h"
+
+#ifdef MNET_UNIX
+#   include <sys/resource.h>
+#endif
+
+// loopback benchmarks for mnet, results are printed as one JSON
+//  document on stdout so runs of different versions can be diffed.
+//
+// usage: mnet_bench [--quick] [name filter]
+
+
+#define BENCH_MAX_RESULTS   64
+#define BENCH_LATENCY_MSG   64
+#define BENCH_UDP_MSG       64
+#define BENCH_CHUNK         (64 * 1024)
+
+typedef struct bench_result
+{
+    char        name[64];
+    double      value;
+    const char* unit;
+} bench_result_t;
+
+static bench_result_t   results[BENCH_MAX_RESULTS];
+static int              result_count = 0;
+static int              quick = 0;
+
+static void report(const char* name, double value, const char* unit)
+{
+    if (result_count == BENCH_MAX_RESULTS) return;
+    bench_result_t* r = &results[result_count++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->value = value;
+    r->unit = unit;
+    fprintf(stderr, "  %-36s %14.2f %s\n", name, value, unit);
+}
+
+static double seconds_since(uint64_t start_ns)
+{
+    return (double)(mnet_time_ns() - start_ns) / 1e9;
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+    const uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static int send_all(mnet_socket_t sock, const void* buf, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)buf;
+    while (len > 0)
+    {
+        const int sent = mnet_send(sock, p, len, mnet_msg_default);
+        if (sent <= 0) return -1;
+        p += sent;
+        len -= (size_t)sent;
+    }
+    return 0;
+}
+
+static int recv_all(mnet_socket_t sock, void* buf, size_t len)
+{
+    uint8_t* p = (uint8_t*)buf;
+    while (len > 0)
+    {
+        const int got = mnet_recv(sock, p, len, mnet_msg_default);
+        if (got <= 0) return -1;
+        p += got;
+        len -= (size_t)got;
+    }
+    return 0;
+}
+
+static void set_nodelay(mnet_socket_t sock)
+{
+    const int on = 1;
+    mnet_setsockopt(sock, mnet_ipproto_tcp_level, mnet_tcp_nodelay, &on, (mnet_socklen_t)sizeof(on));
+}
+
+static mnet_socket_t loopback_listener(mnet_sockaddr_in_t* addr)
+{
+    mnet_socket_t sock = mnet_socket(mnet_af_inet, mnet_sock_stream, mnet_ipproto_tcp);
+    if (!mnet_socket_is_valid(sock)) return MNET_INVALID_SOCKET;
+
+    mnet_socklen_t len = (mnet_socklen_t)sizeof(*addr);
+    if (mnet_addr_ipv4(addr, "127.0.0.1", 0) != mnet_ok ||
+        mnet_bind(sock, MNET_SOCKADDR(*addr), len) != mnet_ok ||
+        mnet_listen(sock, 1024) != mnet_ok ||
+        mnet_getsockname(sock, (mnet_sockaddr_t*)addr, &len) != mnet_ok)
+    {
+        mnet_close(sock);
+        return MNET_INVALID_SOCKET;
+    }
+    return sock;
+}
+
+static mnet_socket_t loopback_connect(const mnet_sockaddr_in_t* addr)
+{
+    mnet_socket_t sock = mnet_socket(mnet_af_inet, mnet_sock_stream, mnet_ipproto_tcp);
+    if (!mnet_socket_is_valid(sock)) return MNET_INVALID_SOCKET;
+
+    if (mnet_connect(sock, MNET_SOCKADDR(*addr), (mnet_socklen_t)sizeof(*addr)) != mnet_ok)
+    {
+        mnet_close(sock);
+        return MNET_INVALID_SOCKET;
+    }
+    return sock;
+}
+
+static mnet_socket_t loopback_udp(mnet_sockaddr_in_t* addr)
+{
+    mnet_socket_t sock = mnet_socket(mnet_af_inet, mnet_sock_dgram, mnet_ipproto_udp);
+    if (!mnet_socket_is_valid(sock)) return MNET_INVALID_SOCKET;
+
+    mnet_socklen_t len = (mnet_socklen_t)sizeof(*addr);
+    if (mnet_addr_ipv4(addr, "127.0.0.1", 0) != mnet_ok ||
+        mnet_bind(sock, MNET_SOCKADDR(*addr), len) != mnet_ok ||
+        mnet_getsockname(sock, (mnet_sockaddr_t*)addr, &len) != mnet_ok)
+    {
+        mnet_close(sock);
+        return MNET_INVALID_SOCKET;
+    }
+    return sock;
+}
+
+
+// ================================================
+//            TCP ECHO
+//
+
+
+typedef struct echo_server
+{
+    mnet_socket_t   listener;
+} echo_server_t;
+
+static void echo_server_thread(void* arg)
+{
+    echo_server_t* server = (echo_server_t*)arg;
+    mnet_socket_t conn = mnet_accept(server->listener, NULL, NULL);
+    if (!mnet_socket_is_valid(conn)) return;
+    set_nodelay(conn);
+
+    static uint8_t buf[BENCH_CHUNK];
+    for (;;)
+    {
+        const int got = mnet_recv(conn, buf, sizeof(buf), mnet_msg_default);
+        if (got <= 0 || send_all(conn, buf, (size_t)got) != 0) break;
+    }
+    mnet_close(conn);
+}
+
+typedef struct echo_writer
+{
+    mnet_socket_t   sock;
+    size_t          total;
+} echo_writer_t;
+
+static void echo_writer_thread(void* arg)
+{
+    echo_writer_t* writer = (echo_writer_t*)arg;
+    static uint8_t buf[BENCH_CHUNK];
+    memset(buf, 0xAB, sizeof(buf));
+
+    size_t left = writer->total;
+    while (left > 0)
+    {
+        const size_t n = left < sizeof(buf) ? left : sizeof(buf);
+        if (send_all(writer->sock, buf, n) != 0) break;
+        left -= n;
+    }
+}
+
+static void bench_tcp_echo(void)
+{
+    mnet_sockaddr_in_t addr;
+    echo_server_t server;
+    server.listener = loopback_listener(&addr);
+    if (!mnet_socket_is_valid(server.listener)) return;
+
+    // connect first, it completes in the backlog and the server
+    //  thread never waits in accept for a client that failed.
+    mnet_socket_t sock = loopback_connect(&addr);
+    if (!mnet_socket_is_valid(sock))
+    {
+        mnet_close(server.listener);
+        return;
+    }
+    set_nodelay(sock);
+
+    mnet_thread_t server_thread;
+    if (mnet_thread_create(&server_thread, echo_server_thread, &server) != mnet_ok)
+    {
+        mnet_close(sock);
+        mnet_close(server.listener);
+        return;
+    }
+
+    // latency: one small message in flight.
+    const int rounds = quick ? 2000 : 20000;
+    uint64_t* samples = (uint64_t*)malloc((size_t)rounds * sizeof(uint64_t));
+    uint8_t msg[BENCH_LATENCY_MSG];
+    memset(msg, 0x5A, sizeof(msg));
+
+    int done = 0;
+    for (; samples && done < rounds; done++)
+    {
+        const uint64_t start = mnet_time_ns();
+        if (send_all(sock, msg, sizeof(msg)) != 0 || recv_all(sock, msg, sizeof(msg)) != 0) break;
+        samples[done] = mnet_time_ns() - start;
+    }
+
+    if (done > 0)
+    {
+        qsort(samples, (size_t)done, sizeof(uint64_t), compare_u64);
+        report("tcp_echo_latency_p50", (double)samples[done / 2] / 1e3, "us");
+        report("tcp_echo_latency_p99", (double)samples[(size_t)done * 99 / 100] / 1e3, "us");
+    }
+    free(samples);
+
+    // throughput: a writer thread keeps the pipe full, echoed bytes are counted here.
+    echo_writer_t writer;
+    writer.sock = sock;
+    writer.total = (size_t)(quick ? 64 : 512) * 1024 * 1024;
+
+    const uint64_t start = mnet_time_ns();
+    mnet_thread_t writer_thread;
+    if (mnet_thread_create(&writer_thread, echo_writer_thread, &writer) == mnet_ok)
+    {
+        static uint8_t buf[BENCH_CHUNK];
+        size_t received = 0;
+        while (received < writer.total)
+        {
+            const int got = mnet_recv(sock, buf, sizeof(buf), mnet_msg_default);
+            if (got <= 0) break;
+            received += (size_t)got;
+        }
+        mnet_thread_join(writer_thread);
+
+        report("tcp_echo_throughput", (double)received / (1024.0 * 1024.0) / seconds_since(start), "MB/s");
+    }
+
+    mnet_close(sock);
+    mnet_thread_join(server_thread);
+    mnet_close(server.listener);
+}
+
+
+// ================================================
+//            TCP ACCEPT RATE
+//
+
+
+static void bench_tcp_accept(void)
+{
+    mnet_sockaddr_in_t addr;
+    mnet_socket_t listener = loopback_listener(&addr);
+    if (!mnet_socket_is_valid(listener)) return;
+
+    // the handshake completes in the kernel, connect then accept
+    //  on one thread measures the setup and teardown cost.
+    const int count = quick ? 1000 : 5000;
+    int accepted = 0;
+
+    const uint64_t start = mnet_time_ns();
+    for (int i = 0; i < count; i++)
+    {
+        mnet_socket_t client = loopback_connect(&addr);
+        if (!mnet_socket_is_valid(client)) break;
+
+        mnet_socket_t conn = mnet_accept(listener, NULL, NULL);
+        mnet_close(client);
+        if (!mnet_socket_is_valid(conn)) break;
+        mnet_close(conn);
+        accepted++;
+    }
+
+    if (accepted > 0) report("tcp_accept_rate", (double)accepted / seconds_since(start), "conn/s");
+    mnet_close(listener);
+}
+
+
+// ================================================
+//            UDP PACKET RATE
+//
+
+
+static void bench_udp_pps(void)
+{
+    mnet_sockaddr_in_t rx_addr, tx_addr;
+    mnet_socket_t rx = loopback_udp(&rx_addr);
+    mnet_socket_t tx = loopback_udp(&tx_addr);
+    if (!mnet_socket_is_valid(rx) || !mnet_socket_is_valid(tx))
+    {
+        mnet_close(rx);
+        mnet_close(tx);
+        return;
+    }
+
+    // bursts of MNET_MMSG_BATCH datagrams stay well inside the receive
+    //  buffer, so nothing is dropped and both variants move the same data.
+    const int bursts = quick ? 2000 : 20000;
+    static uint8_t payload[MNET_MMSG_BATCH][BENCH_UDP_MSG];
+    mnet_mmsg_t msgs[MNET_MMSG_BATCH];
+
+    uint64_t start = mnet_time_ns();
+    long moved = 0;
+    for (int b = 0; b < bursts; b++)
+    {
+        for (int i = 0; i < MNET_MMSG_BATCH; i++)
+            if (mnet_sendto(tx, payload[i], BENCH_UDP_MSG, mnet_msg_default,
+                            MNET_SOCKADDR(rx_addr), (mnet_socklen_t)sizeof(rx_addr)) != BENCH_UDP_MSG) goto per_packet_done;
+        for (int i = 0; i < MNET_MMSG_BATCH; i++)
+        {
+            if (mnet_recvfrom(rx, payload[i], BENCH_UDP_MSG, mnet_msg_default, NULL, NULL) != BENCH_UDP_MSG) goto per_packet_done;
+            moved++;
+        }
+    }
+per_packet_done:
+    report("udp_pps_per_packet", (double)moved / seconds_since(start), "pkt/s");
+
+    start = mnet_time_ns();
+    moved = 0;
+    for (int b = 0; b < bursts; b++)
+    {
+        for (int i = 0; i < MNET_MMSG_BATCH; i++)
+        {
+            msgs[i].buf = payload[i];
+            msgs[i].len = BENCH_UDP_MSG;
+            msgs[i].addr = (mnet_sockaddr_t*)&rx_addr;
+            msgs[i].addrlen = (mnet_socklen_t)sizeof(rx_addr);
+        }
+        if (mnet_sendmmsg(tx, msgs, MNET_MMSG_BATCH, mnet_msg_default) != MNET_MMSG_BATCH) break;
+
+        int left = MNET_MMSG_BATCH;
+        while (left > 0)
+        {
+            for (int i = 0; i < left; i++)
+            {
+                msgs[i].buf = payload[i];
+                msgs[i].len = BENCH_UDP_MSG;
+                msgs[i].addr = NULL;
+                msgs[i].addrlen = 0;
+            }
+            const int got = mnet_recvmmsg(rx, msgs, left, mnet_msg_default);
+            if (got <= 0) break;
+            left -= got;
+            moved += got;
+        }
+        if (left > 0) break;
+    }
+    report("udp_pps_batched", (double)moved / seconds_since(start), "pkt/s");
+
+    mnet_close(rx);
+    mnet_close(tx);
+}
+
+
+// ================================================
+//            EVENT LOOP SCALING
+//
+
+
+static int max_open_sockets(void)
+{
+#ifdef MNET_UNIX
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+        return (int)limit.rlim_cur - 32;
+#endif
+    return 1 << 20;
+}
+
+static void bench_loop_scaling(void)
+{
+    static const int idle_counts[] = { 0, 100, 1000, 10000 };
+    const int max_sockets = max_open_sockets();
+    const int rounds = quick ? 5000 : 50000;
+
+    for (size_t c = 0; c < sizeof(idle_counts) / sizeof(idle_counts[0]); c++)
+    {
+        const int idle = idle_counts[c];
+        if (idle + 2 > max_sockets) break;
+
+        mnet_loop_t loop;
+        if (mnet_loop_init(&loop) != mnet_ok) return;
+
+        mnet_socket_t* sockets = (mnet_socket_t*)malloc((size_t)(idle + 1) * sizeof(mnet_socket_t));
+        int opened = 0;
+        mnet_sockaddr_in_t addr;
+
+        for (; sockets && opened < idle; opened++)
+        {
+            sockets[opened] = loopback_udp(&addr);
+            if (!mnet_socket_is_valid(sockets[opened])) break;
+            mnet_loop_add(&loop, sockets[opened], mnet_loop_in, NULL);
+        }
+
+        mnet_sockaddr_in_t active_addr, tx_addr;
+        mnet_socket_t active = loopback_udp(&active_addr);
+        mnet_socket_t tx = loopback_udp(&tx_addr);
+
+        if (sockets && opened == idle &&
+            mnet_socket_is_valid(active) && mnet_socket_is_valid(tx) &&
+            mnet_loop_add(&loop, active, mnet_loop_in, NULL) == mnet_ok)
+        {
+            // one datagram per round trip through the loop, the idle
+            //  sockets only add whatever the backend costs per socket.
+            uint8_t byte = 0;
+            mnet_loop_event_t events[16];
+            int ok = 1;
+
+            const uint64_t start = mnet_time_ns();
+            for (int i = 0; i < rounds && ok; i++)
+            {
+                ok = mnet_sendto(tx, &byte, 1, mnet_msg_default,
+                                 MNET_SOCKADDR(active_addr), (mnet_socklen_t)sizeof(active_addr)) == 1 &&
+                     mnet_loop_wait(&loop, events, 16, 1000) == 1 &&
+                     mnet_recvfrom(active, &byte, 1, mnet_msg_default, NULL, NULL) == 1;
+            }
+
+            if (ok)
+            {
+                char name[64];
+                snprintf(name, sizeof(name), "loop_wait_idle_%d", idle);
+                report(name, seconds_since(start) * 1e9 / rounds, "ns/op");
+            }
+        }
+
+        mnet_close(active);
+        mnet_close(tx);
+        for (int i = 0; i < opened; i++) mnet_close(sockets[i]);
+        free(sockets);
+        mnet_loop_destroy(&loop);
+    }
+}
+
+
+// ================================================
+//            MAIN
+//
+
+
+typedef struct bench
+{
+    const char* name;
+    void        (*run)(void);
+} bench_t;
+
+static const bench_t benches[] =
+{
+    { "tcp_echo",       bench_tcp_echo },
+    { "tcp_accept",     bench_tcp_accept },
+    { "udp_pps",        bench_udp_pps },
+    { "loop_scaling",   bench_loop_scaling },
+};
+
+int main(int argc, char** argv)
+{
+    const char* filter = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0) quick = 1;
+        else filter = argv[i];
+    }
+
+    if (mnet_initialize() != 0)
+    {
+        fprintf(stderr, "mnet_initialize() failed\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+    {
+        if (filter && !strstr(benches[i].name, filter)) continue;
+        fprintf(stderr, "%s\n", benches[i].name);
+        benches[i].run();
+    }
+
+    mnet_cleanup();
+
+    printf("{\n");
+    printf("  \"version\": \"%d.%d\",\n", MNET_VERSION_MAJOR, MNET_VERSION_MINOR);
+    printf("  \"quick\": %s,\n", quick ? "true" : "false");
+    printf("  \"results\": [\n");
+    for (int i = 0; i < result_count; i++)
+    {
+        printf("    { \"name\": \"%s\", \"value\": %.3f, \"unit\": \"%s\" }%s\n",
+               results[i].name, results[i].value, results[i].unit, i + 1 < result_count ? "," : "");
+    }
+    printf("  ]\n}\n");
+    return 0;
+}
@@ -43,6 +43,15 @@ void server()
 
     printf("UDP server listening on port 9090...\n");
 
+    mnet_peer_table_t peers;
+    uint32_t next_session = 0;
+    if (mnet_peer_table_init(&peers, 0) != mnet_ok)
+    {
+        printf("Failed to create peer table\n");
+        mnet_close(server);
+        return;
+    }
+
     while (1)
     {
         char buffer[1024];
@@ -58,12 +67,23 @@ void server()
         {
             buffer[bytes] = '\0';  // Null terminate
 
-            char client_ip[MNET_IP_STRLEN];
-            const uint16_t client_port = mnet_addr_get_port((mnet_sockaddr_t*)&client_addr);
-            if (mnet_addr_ip_to_string((mnet_sockaddr_t*)&client_addr,
-                                   client_ip, sizeof(client_ip)) == mnet_ok)
+            mnet_endpoint_t client;
+            uint32_t session = 0;
+            const uint64_t now = mnet_time_ms();
+            if (mnet_endpoint_from_sockaddr(&client, (mnet_sockaddr_t*)&client_addr) == mnet_ok &&
+                !mnet_peer_table_find(&peers, &client, now, &session))
+            {
+                session = next_session++;
+                mnet_peer_table_insert(&peers, &client, session, now);
+            }
+
+            // forget clients that went quiet for a minute.
+            mnet_peer_table_evict(&peers, now, 60000, 64, NULL, NULL);
+
+            char client_str[MNET_ADDR_STRLEN];
+            if (mnet_endpoint_to_string(&client, client_str, sizeof(client_str)) >= 0)
             {
-                printf("Received from %s:%u: %s\n", client_ip, client_port, buffer);
+                printf("Received from %s (session %u): %s\n", client_str, session, buffer);
             }
 
             mnet_sendto(server, buffer, (size_t)bytes, mnet_msg_default,
@@ -76,6 +96,7 @@ void server()
         }
     }
 
+    mnet_peer_table_destroy(&peers);
     mnet_close(server);
 }
 
@@ -26,8 +26,6 @@
 #define MNET_VERSION_STRING \
     MNET_STRINGIFY_1(MNET_VERSION_MAJOR) "." MNET_STRINGIFY_1(MNET_VERSION_MINOR)
 
-#include <stdint.h>
-
 // ================================================
 // PLATFORM DETECTION
 //
@@ -40,6 +38,18 @@
 #   error PLATFORM_NOT_SUPPORTED
 #endif
 
+#if defined(__linux__)
+#   define MNET_LINUX
+#   ifndef _GNU_SOURCE
+#       define _GNU_SOURCE
+#   endif
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
 // ================================================
 // PLATFORM
 //
@@ -49,6 +59,7 @@
 #   include <winsock2.h>
 #   include <ws2tcpip.h>
 #   include <windows.h>
+#   include <stdio.h>
 
     typedef SOCKET mnet_socket_t;
 #   define MNET_INVALID_SOCKET INVALID_SOCKET
@@ -67,12 +78,41 @@
 #   include <fcntl.h>
 #   include <errno.h>
 #   include <poll.h>
+#   include <sys/mman.h>
+#   include <time.h>
+#   include <stdio.h>
+#   include <limits.h>
+#   include <pthread.h>
+#   ifdef MNET_LINUX
+#       include <sched.h>
+#       include <sys/epoll.h>
+#       include <netinet/udp.h>
+#       include <linux/errqueue.h>
+#       include <linux/net_tstamp.h>
+#       include <sys/sendfile.h>
+#       include <sys/syscall.h>
+#       include <sys/eventfd.h>
+#       include <linux/filter.h>
+#       ifdef MNET_IO_URING
+#           include <linux/io_uring.h>
+#           ifndef IORING_RECV_MULTISHOT
+                // headers older than 6.0 lack multishot recv and buffer rings,
+                //  mnet_uring uses the mnet_poll fallback.
+#               undef MNET_IO_URING
+#           endif
+#       endif
+#   endif
 
     typedef int mnet_socket_t;
 #   define MNET_INVALID_SOCKET (-1)
     typedef struct iovec mnet_iovec_t;
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define MNET_SSE2
+#   include <emmintrin.h>
+#endif
+
 #define MNET_IPV4_STRLEN        INET_ADDRSTRLEN
 #define MNET_IPV6_STRLEN        INET6_ADDRSTRLEN
 #define MNET_IP_STRLEN          INET6_ADDRSTRLEN
@@ -94,6 +134,19 @@ typedef socklen_t               mnet_socklen_t;
 
 #define MNET_SOCKADDR(sockaddr_in) ((const mnet_sockaddr_t*)&(sockaddr_in))
 
+// define MNET_INLINE (in every file including mnet.h) to get the trivial
+//  wrappers (byte order, iovec accessors, ...) as static inline functions
+//  from the header, so they fold away in packet loops instead of being calls.
+#ifdef MNET_INLINE
+#   if defined(_MSC_VER)
+#       define MNET_INLINE_API static __inline
+#   else
+#       define MNET_INLINE_API static inline
+#   endif
+#else
+#   define MNET_INLINE_API
+#endif
+
 
 
 // ================================================
@@ -184,7 +237,13 @@ typedef enum
     mnet_msg_default    = mnet_msg_none,
     mnet_msg_peek       = MSG_PEEK,
     mnet_msg_dontroute  = MSG_DONTROUTE,
-    mnet_msg_waitall    = MSG_WAITALL
+    mnet_msg_waitall    = MSG_WAITALL,
+#ifdef MSG_NOSIGNAL
+    mnet_msg_nosignal   = MSG_NOSIGNAL
+#else
+    mnet_msg_nosignal   = 0
+#endif
+    // don't raise SIGPIPE when the peer is gone. (no-op where unsupported)
 } mnet_msg_flags_t;
 
 typedef enum
@@ -307,8 +366,8 @@ mnet_result_t mnet_close(mnet_socket_t sock);
 // ----------------------------------------------------------------
 // check if a socket handle is valid.
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, mnet_error on failure.
-mnet_result_t mnet_socket_is_valid(mnet_socket_t sock);
+// returns: 1 if valid, 0 otherwise.
+MNET_INLINE_API mnet_result_t mnet_socket_is_valid(mnet_socket_t sock);
 
 
 // ================================================
@@ -375,6 +434,7 @@ mnet_result_t mnet_shutdown(mnet_socket_t sock, mnet_shutdown_code_t how);
 //
 // buf: data to send.
 // len: number of bytes to send. (shouldn't be more than the buffers size)
+//  at most 2^31 - 1 bytes are sent per call, so the count fits the result.
 // flags: flags to send with.
 // ----------------------------------------------------------------
 // returns:
@@ -391,6 +451,7 @@ int mnet_send(
 //
 // buf: local buffer to move data into.
 // len: maximum bytes to receive. (shouldn't be more than the buffers size)
+//  at most 2^31 - 1 bytes are received per call.
 // flags: flags to receive with.
 // ----------------------------------------------------------------
 // returns:
@@ -410,39 +471,40 @@ int mnet_recv(
 // base: pointer to buffer.
 // len: length of buffer.
 // ----------------------------------------------------------------
-void    mnet_iovec_init(mnet_iovec_t* iov, void* base, size_t len);
+MNET_INLINE_API void    mnet_iovec_init(mnet_iovec_t* iov, void* base, size_t len);
 
 // ----------------------------------------------------------------
 // get pointer to the base pointer.
 // ----------------------------------------------------------------
-void**  mnet_iovec_base(const mnet_iovec_t* iov);
+MNET_INLINE_API void**  mnet_iovec_base(const mnet_iovec_t* iov);
 
 // ----------------------------------------------------------------
 // get base pointer.
 // ----------------------------------------------------------------
 // returns: just the base.
-void*   mnet_iovec_get_base(mnet_iovec_t iov);
+MNET_INLINE_API void*   mnet_iovec_get_base(mnet_iovec_t iov);
 
 // ----------------------------------------------------------------
 // set base pointer.
 // ----------------------------------------------------------------
-void    mnet_iovec_set_base(mnet_iovec_t* iov, void* base);
+MNET_INLINE_API void    mnet_iovec_set_base(mnet_iovec_t* iov, void* base);
 
 // ----------------------------------------------------------------
 // get len.
 // ----------------------------------------------------------------
-size_t mnet_iovec_get_len(mnet_iovec_t iov);
+MNET_INLINE_API size_t mnet_iovec_get_len(mnet_iovec_t iov);
 
 // ----------------------------------------------------------------
 // set len.
 // ----------------------------------------------------------------
-void    mnet_iovec_set_len(mnet_iovec_t* iov, size_t len);
+MNET_INLINE_API void    mnet_iovec_set_len(mnet_iovec_t* iov, size_t len);
 
 // ----------------------------------------------------------------
 // send multiple buffers in a single call. (vectored I/O)
 //
 // iov: array of buffer descriptors.
-// iovcnt: number of buffers in array.
+// iovcnt: number of buffers in array. (buffers past 2^31 - 1 bytes
+//  in total are left for the next call)
 // flags: flags to send with.
 // ----------------------------------------------------------------
 // returns:
@@ -457,7 +519,8 @@ int mnet_sendv(
 // receive into multiple buffers in a single call. (vectored I/O)
 //
 // iov: array of buffer descriptors.
-// iovcnt: number of buffers in array.
+// iovcnt: number of buffers in array. (at most 2^31 - 1 bytes in
+//  total are received per call)
 // flags: flags to receive with.
 // ----------------------------------------------------------------
 // returns:
@@ -512,6 +575,478 @@ int mnet_recvfrom(
                 mnet_sockaddr_t* src_addr,
                 mnet_socklen_t* addrlen);
 
+// ----------------------------------------------------------------
+// one datagram of a batched send/receive.
+// ----------------------------------------------------------------
+typedef struct mnet_mmsg
+{
+    void*               buf;
+    // data to send, or buffer to receive into.
+
+    size_t              len;
+    // send: bytes to send. recv: size of buf.
+
+    mnet_sockaddr_t*    addr;
+    // send: destination address.
+    // recv: [out] senders address. (can be NULL)
+
+    mnet_socklen_t      addrlen;
+    // send: sizeof addr structure.
+    // recv: [in/out] sizeof addr structure, updated with actual size.
+
+    int                 bytes;
+    // [out] bytes sent/received for this datagram.
+} mnet_mmsg_t;
+
+#define MNET_MMSG_BATCH 64
+
+// ----------------------------------------------------------------
+// send many datagrams in as few calls as possible. (UDP)
+//  (uses sendmmsg on linux, one mnet_sendto per datagram elsewhere)
+//
+// msgs: datagrams to send, bytes is filled in for each one sent.
+// count: number of elements in msgs.
+// flags: flags to send with.
+// ----------------------------------------------------------------
+// returns: number of datagrams sent, or -1 on error.
+//  (sending stops at the first datagram that fails)
+int mnet_sendmmsg(
+                mnet_socket_t sock,
+                mnet_mmsg_t* msgs,
+                int count,
+                mnet_msg_flags_t flags);
+
+// ----------------------------------------------------------------
+// receive many datagrams in as few calls as possible. (UDP)
+//  (uses recvmmsg on linux, one mnet_recvfrom per datagram elsewhere)
+//
+// only waits for the first datagram (if the socket is blocking),
+//  then drains what is already queued without blocking.
+//
+// msgs: buffers to receive into, bytes/addr/addrlen are filled in
+//  for each datagram received.
+// count: number of elements in msgs.
+// flags: flags to receive with.
+// ----------------------------------------------------------------
+// returns: number of datagrams received, or -1 on error.
+int mnet_recvmmsg(
+                mnet_socket_t sock,
+                mnet_mmsg_t* msgs,
+                int count,
+                mnet_msg_flags_t flags);
+
+// ----------------------------------------------------------------
+// send one large buffer as many datagrams of segment_size bytes. (UDP)
+//  (the last datagram may be shorter)
+//
+// uses UDP segmentation offload (UDP_SEGMENT) where the kernel
+//  supports it, so the stack is walked once per ~64KB instead of
+//  once per datagram. falls back to mnet_sendmmsg otherwise.
+//
+// buf: data to send.
+// len: total number of bytes to send.
+// segment_size: payload bytes per datagram.
+// flags: flags to send with.
+// dest_addr: destination address to send to.
+// addrlen: sizeof of dest_addr structure.
+// ----------------------------------------------------------------
+// returns: number of bytes sent, or -1 on error.
+//  (only whole datagrams are counted)
+int mnet_sendto_gso(
+                mnet_socket_t sock,
+                const void* buf,
+                size_t len,
+                uint16_t segment_size,
+                mnet_msg_flags_t flags,
+                const mnet_sockaddr_t* dest_addr,
+                mnet_socklen_t addrlen);
+
+// ----------------------------------------------------------------
+// let the kernel coalesce received datagrams from the same
+//  flow into one buffer. (UDP_GRO)
+//
+// when enabled, receive with mnet_recvfrom_gro.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if not supported.
+mnet_result_t mnet_set_udp_gro(mnet_socket_t sock, int enable);
+
+#define MNET_GRO_BUFFER_SIZE 65535
+
+// ----------------------------------------------------------------
+// receive a datagram or a coalesced GRO super-packet. (UDP)
+//
+// buf: buffer to receive into. (MNET_GRO_BUFFER_SIZE to fit any)
+// len: size of buf.
+// flags: flags to receive with.
+// src_addr: [out] senders address.             (can be NULL)
+// addrlen: [out] sizeof src_addr structure.    (can be NULL)
+// segment_size: [out] size of each coalesced datagram,
+//  equal to the return value for a single datagram.
+//  split the buffer with mnet_gro_split.
+// ----------------------------------------------------------------
+// returns: number of bytes received, or -1 on error.
+int mnet_recvfrom_gro(
+                mnet_socket_t sock,
+                void* buf,
+                size_t len,
+                mnet_msg_flags_t flags,
+                mnet_sockaddr_t* src_addr,
+                mnet_socklen_t* addrlen,
+                uint16_t* segment_size);
+
+// ----------------------------------------------------------------
+// split a received super-packet back into its datagrams.
+//  (no copy, the iovecs point into buf)
+//
+// buf: data from mnet_recvfrom_gro.
+// bytes: return value of mnet_recvfrom_gro.
+// segment_size: segment_size from mnet_recvfrom_gro.
+// out: [out] one iovec per datagram.
+// max_out: size of out array.
+// ----------------------------------------------------------------
+// returns: number of datagrams written to out.
+int mnet_gro_split(
+                void* buf,
+                int bytes,
+                uint16_t segment_size,
+                mnet_iovec_t* out,
+                int max_out);
+
+
+// ================================================
+//                 ZERO-COPY SEND
+//
+// sends that pin the user buffer instead of copying it into the
+//  kernel. (SO_ZEROCOPY + MSG_ZEROCOPY on linux)
+//
+// every send of at least one byte gets the next id (counting
+//  from 0), the buffer must not be modified or freed until a
+//  completion covering that id is reaped with mnet_zerocopy_reap.
+//
+// where zero-copy is not available the sends copy as usual and
+//  complete immediately, so the same code works everywhere.
+//
+// NOTE: only worth it for large sends (~10KB+), small sends
+//  are cheaper to copy than to pin and notify.
+// NOTE: completions share the error queue with tx timestamps, a
+//  socket can't have both. (see mnet_set_timestamping)
+//
+
+
+typedef struct mnet_zerocopy
+{
+    mnet_socket_t   sock;
+    int             enabled;    // 1 if the kernel accepted SO_ZEROCOPY.
+    uint32_t        next_id;    // id of the next successful send.
+    uint32_t        reaped_id;  // fallback: next id to report complete.
+} mnet_zerocopy_t;
+
+typedef struct mnet_zerocopy_range
+{
+    uint32_t        first;      // first completed send id.
+    uint32_t        last;       // last completed send id. (inclusive)
+    int             copied;     // 1 if the kernel copied the data anyway.
+} mnet_zerocopy_range_t;
+
+// ----------------------------------------------------------------
+// enable zero-copy sends on a socket. (TCP, or UDP on newer kernels)
+//
+// zc: [out] per socket send state.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+//  falls back to copying sends if the kernel lacks SO_ZEROCOPY,
+//  or tx timestamps are enabled on the socket.
+mnet_result_t mnet_zerocopy_init(mnet_zerocopy_t* zc, mnet_socket_t sock);
+
+// ----------------------------------------------------------------
+// send without copying buf. (see mnet_send)
+//
+// id: [out] id of this send, to match with completions. (can be NULL)
+// ----------------------------------------------------------------
+// returns:
+//  ( >= 0 )    count of bytes send.
+//  ( < 0 )     error. (mnet_enobufs: reap completions and retry)
+int mnet_zerocopy_send(
+                mnet_zerocopy_t* zc,
+                const void* buf,
+                size_t len,
+                mnet_msg_flags_t flags,
+                uint32_t* id);
+
+// ----------------------------------------------------------------
+// send multiple buffers without copying them. (see mnet_sendv)
+//
+// id: [out] id of this send, to match with completions. (can be NULL)
+// ----------------------------------------------------------------
+// returns:
+//  ( >= 0 )    count of bytes send.
+//  ( < 0 )     error. (mnet_enobufs: reap completions and retry)
+int mnet_zerocopy_sendv(
+                mnet_zerocopy_t* zc,
+                const mnet_iovec_t* iov,
+                int iovcnt,
+                mnet_msg_flags_t flags,
+                uint32_t* id);
+
+// ----------------------------------------------------------------
+// collect send completions from the socket error queue.
+//  (never blocks, readiness shows up as mnet_pollerr/mnet_loop_err)
+//
+// ranges: [out] completed send ids.
+// max_ranges: size of ranges array.
+// ----------------------------------------------------------------
+// returns: number of ranges written, or -1 on error.
+int mnet_zerocopy_reap(
+                mnet_zerocopy_t* zc,
+                mnet_zerocopy_range_t* ranges,
+                int max_ranges);
+
+// ----------------------------------------------------------------
+// check if a send id lies within a completed range.
+// ----------------------------------------------------------------
+// returns: 1 if id is covered, 0 otherwise.
+int mnet_zerocopy_range_has(const mnet_zerocopy_range_t* range, uint32_t id);
+
+
+// ================================================
+//              PACKET TIMESTAMPS
+//
+// the time the kernel (or the NIC) saw a packet, instead of the
+//  time the application got around to reading it. (SO_TIMESTAMPING
+//  on linux, SO_TIMESTAMPNS / SO_TIMESTAMP where that is missing)
+//
+// software times are wall clock (compare with mnet_time_wall_ns),
+//  hardware times come from the NIC clock and are only reported if
+//  timestamping was enabled on the device. (SIOCSHWTSTAMP, e.g. by
+//  ptp4l or hwstamp_ctl, mnet does not configure the device)
+//
+// NOTE: transmit timestamps share the socket error queue with
+//  zero-copy completions, don't use both on one socket.
+//
+
+typedef enum mnet_timestamp_flags
+{
+    mnet_timestamp_rx_software  = 0x01,     // kernel receive time.
+    mnet_timestamp_rx_hardware  = 0x02,     // NIC receive time.
+    mnet_timestamp_tx_software  = 0x04,     // time the packet left the stack.
+    mnet_timestamp_tx_hardware  = 0x08      // time the NIC sent the packet.
+} mnet_timestamp_flags_t;
+
+typedef struct mnet_timestamp
+{
+    uint64_t    software_ns;    // kernel time. (0 if not reported)
+    uint64_t    hardware_ns;    // NIC time. (0 if not reported)
+} mnet_timestamp_t;
+
+typedef struct mnet_tx_timestamp
+{
+    uint32_t            id;
+    // send the timestamp belongs to, counting from 0 when enabled.
+    // UDP: datagram number. TCP: offset of the last byte of the send.
+
+    mnet_timestamp_t    ts;
+} mnet_tx_timestamp_t;
+
+// ----------------------------------------------------------------
+// enable packet timestamps on a socket.
+//
+// flags: mnet_timestamp_flags_t bits, 0 disables timestamps.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if not supported.
+//  (software receive timestamps use the best option available)
+//  tx timestamps fail on a socket with zero-copy sends enabled.
+mnet_result_t mnet_set_timestamping(mnet_socket_t sock, int flags);
+
+// ----------------------------------------------------------------
+// receive data with its receive timestamp. (UDP, or TCP with
+//  NULL src_addr, the time is that of the last segment read)
+//
+// buf: buffer to receive into.
+// len: maximum bytes to receive.
+// flags: flags to receive with.
+// src_addr: [out] senders address.             (can be NULL)
+// addrlen: [out] sizeof src_addr structure.    (can be NULL)
+// ts: [out] receive time, zero where not reported.
+// ----------------------------------------------------------------
+// returns: number of bytes received, or -1 on error.
+int mnet_recvfrom_ts(
+                mnet_socket_t sock,
+                void* buf,
+                size_t len,
+                mnet_msg_flags_t flags,
+                mnet_sockaddr_t* src_addr,
+                mnet_socklen_t* addrlen,
+                mnet_timestamp_t* ts);
+
+// ----------------------------------------------------------------
+// collect transmit timestamps from the socket error queue.
+//  (never blocks, readiness shows up as mnet_pollerr/mnet_loop_err)
+//
+// out: [out] one entry per timestamped send.
+// max_out: size of out array.
+// ----------------------------------------------------------------
+// returns: number of entries written, or -1 on error.
+int mnet_timestamp_reap_tx(
+                mnet_socket_t sock,
+                mnet_tx_timestamp_t* out,
+                int max_out);
+
+
+// ================================================
+//              BUSY POLLING
+//
+// low latency receive: spin on non-blocking receives for up to
+//  spin_us before blocking in mnet_poll, so data arriving within
+//  the budget is picked up without a wakeup. the kernel is asked
+//  to busy poll the device queue too. (SO_BUSY_POLL and
+//  SO_PREFER_BUSY_POLL on linux, raising SO_BUSY_POLL above the
+//  net.core.busy_read sysctl needs CAP_NET_ADMIN)
+//
+// NOTE: spinning burns a core, compare spin_hits with yields and
+//  spin_ns in the stats to tune spin_us.
+// NOTE: a busy poll state must only be used by one thread.
+//
+
+typedef struct mnet_busy_poll_stats
+{
+    uint64_t    spin_hits;      // receives that got data while spinning.
+    uint64_t    yields;         // receives that used up the budget and blocked.
+    uint64_t    empty_polls;    // non-blocking receives that found nothing.
+    uint64_t    spin_ns;        // time spent spinning.
+} mnet_busy_poll_stats_t;
+
+typedef struct mnet_busy_poll
+{
+    mnet_socket_t           sock;
+    uint64_t                spin_ns;    // spin budget per receive.
+    int                     kernel;     // 1 if the kernel accepted SO_BUSY_POLL.
+    mnet_busy_poll_stats_t  stats;
+} mnet_busy_poll_t;
+
+// ----------------------------------------------------------------
+// set up busy polling on a socket.
+//
+// bp: [out] busy poll state.
+// spin_us: spin budget per receive in microseconds. (0 = don't spin)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+//  (spins in user space only if the kernel refuses busy polling)
+mnet_result_t mnet_busy_poll_init(mnet_busy_poll_t* bp, mnet_socket_t sock, uint32_t spin_us);
+
+// ----------------------------------------------------------------
+// receive, spinning before blocking. (see mnet_recv)
+//
+// timeout_ms: time to block after the spin budget ran out. (-1 = forever)
+// ----------------------------------------------------------------
+// returns:
+//  ( > 0 )     count of bytes received.
+//  ( == 0 )    gracefull disconnect.
+//  ( < 0 )     error. (mnet_etimedout if nothing arrived in time)
+int mnet_busy_poll_recv(
+                mnet_busy_poll_t* bp,
+                void* buf,
+                size_t len,
+                mnet_msg_flags_t flags,
+                int timeout_ms);
+
+// ----------------------------------------------------------------
+// receive a datagram, spinning before blocking. (see mnet_recvfrom)
+//
+// timeout_ms: time to block after the spin budget ran out. (-1 = forever)
+// ----------------------------------------------------------------
+// returns: number of bytes received, or -1 on error.
+//  (mnet_etimedout if nothing arrived in time)
+int mnet_busy_poll_recvfrom(
+                mnet_busy_poll_t* bp,
+                void* buf,
+                size_t len,
+                mnet_msg_flags_t flags,
+                mnet_sockaddr_t* src_addr,
+                mnet_socklen_t* addrlen,
+                int timeout_ms);
+
+
+// ================================================
+//             FILE TRANSFER & RELAY
+//
+// move bulk data between files and sockets, or between two
+//  sockets, without copying it through user space.
+//  (sendfile/splice on linux, a read/send loop elsewhere)
+//
+
+
+#ifdef MNET_WINDOWS
+    typedef HANDLE mnet_file_t;
+#else
+    typedef int mnet_file_t;
+#endif
+
+#define MNET_RELAY_BUFFER_SIZE 65536
+
+typedef struct mnet_relay
+{
+#ifdef MNET_LINUX
+    int         pipe_rd;
+    int         pipe_wr;
+#else
+    uint8_t*    buf;
+    size_t      start;
+#endif
+    size_t      pending;
+    // bytes read from the source but not yet written to the
+    //  destination, wait for the destination to be writable.
+} mnet_relay_t;
+
+// ----------------------------------------------------------------
+// send part of a file over a connected socket. (TCP)
+//
+// file: open file to read from.
+// offset: [in/out] file position to start at, advanced by the
+//  number of bytes sent. (the file's own position is not used)
+// count: maximum number of bytes to send.
+// ----------------------------------------------------------------
+// returns:
+//  ( > 0 )     count of bytes send, may be less than count.
+//  ( == 0 )    end of file.
+//  ( < 0 )     error.
+int64_t mnet_sendfile(
+                mnet_socket_t sock,
+                mnet_file_t file,
+                int64_t* offset,
+                size_t count);
+
+// ----------------------------------------------------------------
+// create a relay for forwarding one direction of a proxied stream.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_relay_init(mnet_relay_t* relay);
+
+// ----------------------------------------------------------------
+// destroy a relay. (the sockets are NOT closed)
+// ----------------------------------------------------------------
+void mnet_relay_destroy(mnet_relay_t* relay);
+
+// ----------------------------------------------------------------
+// forward data from one socket to another. (splice on linux)
+//
+// first flushes bytes still pending, then moves up to max bytes.
+//  meant for nonblocking sockets, call again when from is readable
+//  (or to is writable while relay->pending is non zero).
+//
+// from: socket to read from.
+// to: socket to write to.
+// max: maximum bytes to read from 'from' in this call.
+// ----------------------------------------------------------------
+// returns:
+//  ( > 0 )     count of bytes written to 'to'.
+//  ( == 0 )    'from' was closed and nothing is pending.
+//  ( < 0 )     error. (mnet_ewouldblock if nothing could move)
+int64_t mnet_relay(
+                mnet_relay_t* relay,
+                mnet_socket_t from,
+                mnet_socket_t to,
+                size_t max);
+
 
 // ================================================
 //                  SOCKET OPTIONS
@@ -566,6 +1101,16 @@ mnet_result_t mnet_set_blocking(mnet_socket_t sock, int do_block);
 
 mnet_result_t mnet_set_reuseaddr(mnet_socket_t sock, int do_reuse);
 
+// ----------------------------------------------------------------
+// let several sockets bind the same address and port. (SO_REUSEPORT)
+//  the kernel spreads incoming connections/datagrams over them.
+//
+// NOTE: must be set on every socket before bind.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure or if the
+//  platform has no SO_REUSEPORT. (windows)
+mnet_result_t mnet_set_reuseport(mnet_socket_t sock, int do_reuse);
+
 // ----------------------------------------------------------------
 // get the number of bytes available to read without blocking.
 //
@@ -599,847 +1144,11005 @@ int mnet_poll(mnet_pollfd_t* fds, int nfds, int timeout);
 // event: event to check for (mnet_pollin, mnet_pollout, etc.)
 // ----------------------------------------------------------------
 // returns: 1 if event is set, 0 otherwise.
-int mnet_pollfd_has_event(const mnet_pollfd_t* pfd, short event);
+MNET_INLINE_API int mnet_pollfd_has_event(const mnet_pollfd_t* pfd, short event);
 
 
 // ================================================
-//           ADDRESS AND NAME RESOLUTION
+//             EVENT LOOP (READINESS)
+//
+// scalable replacement for rebuilding and scanning an
+//  mnet_pollfd_t array on every wakeup.
+//  uses epoll on linux, and falls back to mnet_poll elsewhere.
+//
+// only the ready sockets are returned from mnet_loop_wait,
+//  the cost of a wakeup does not grow with idle sockets. (epoll)
 //
+// NOTE: the mnet_poll fallback is O(n) per wait, does not support
+//  mnet_loop_edge (treated as level triggered) and is not thread-safe.
+//
+
+
+#ifndef MNET_LOOP_MAX_FD
+#   define MNET_LOOP_MAX_FD         (1 << 20)
+#endif
+
+#define MNET_LOOP_PAGE_SIZE         4096
+#define MNET_LOOP_PAGE_COUNT        ((MNET_LOOP_MAX_FD + MNET_LOOP_PAGE_SIZE - 1) / MNET_LOOP_PAGE_SIZE)
+#define MNET_LOOP_WAIT_BATCH        256
+
+typedef enum mnet_loop_events
+{
+    mnet_loop_in        = 0x01,
+    // readable, or a pending connection on a listening socket.
+
+    mnet_loop_out       = 0x02,
+    // writable, or a nonblocking connect finished.
+
+    mnet_loop_err       = 0x04,
+    // OUTPUT
+    // error condition. (always reported)
+
+    mnet_loop_hup       = 0x08,
+    // OUTPUT
+    // peer hung up. (always reported)
+
+    mnet_loop_edge      = 0x10,
+    // INPUT
+    // edge triggered, only report changes in readiness.
+    //  the socket must be drained until mnet_ewouldblock.
+
+    mnet_loop_oneshot   = 0x20
+    // INPUT
+    // disarm after one event, re-arm with mnet_loop_mod.
+    //  lets multiple threads wait on the same loop without
+    //  two of them handling the same socket at once.
+} mnet_loop_events_t;
+
+typedef struct mnet_loop_event
+{
+    mnet_socket_t   sock;
+    uint32_t        events;     // mnet_loop_events_t flags.
+    void*           udata;      // as given to mnet_loop_add/mnet_loop_mod.
+} mnet_loop_event_t;
 
+typedef struct mnet_loop
+{
+    struct mnet_timer_wheel* timers;
+    // see mnet_loop_set_timers. (can be NULL)
+
+#ifdef MNET_LINUX
+    int             epfd;
+    void**          pages[MNET_LOOP_PAGE_COUNT];
+    // udata per fd, pages are allocated on first use
+    //  and never move so waiters can read them lock free.
+#else
+    mnet_pollfd_t*  fds;
+    void**          udata;
+    uint32_t*       flags;
+    int             count;
+    int             capacity;
+#endif
+} mnet_loop_t;
 
 // ----------------------------------------------------------------
-// get the local address its bound to.
+// create an event loop.
 //
-// addr: output buffer for the address.
-// addrlen: pointer to buffer size. (updated with actual size)
+// loop: [out] loop to initialize.
 // ----------------------------------------------------------------
 // returns: mnet_ok on success, mnet_error on failure.
-int mnet_getsockname(
-            mnet_socket_t sock,
-            mnet_sockaddr_t* addr,
-            mnet_socklen_t* addrlen);
+mnet_result_t mnet_loop_init(mnet_loop_t* loop);
 
 // ----------------------------------------------------------------
-// get the remote address it's connected to.
+// destroy an event loop.
 //
-// addr: output buffer for the address.
-// addrlen: pointer to buffer size. (updated with actual size)
+// NOTE: registered sockets are NOT closed.
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, mnet_error on failure.
-int mnet_getpeername(
-                mnet_socket_t sock,
-                mnet_sockaddr_t* addr,
-                mnet_socklen_t* addrlen);
-
-// ----------------------------------------------------------------
-// resolve hostname to IP addresses. (DNS lookup)
-//
-// node: hostname or IP address string. (e.g., "google.com")
-// service: service name or port string. (e.g., "http" or "80")
-// hints: optional hints for resolution. (can be NULL)
-// res: [out] result list. (must be freed with mnet_freeaddrinfo)
-// ----------------------------------------------------------------
-// returns: mnet_ok on success, error code on failure.
-int mnet_getaddrinfo(
-                const char* node,
-                const char* service,
-                const struct addrinfo* hints,
-                struct addrinfo** res);
+void mnet_loop_destroy(mnet_loop_t* loop);
 
 // ----------------------------------------------------------------
-// free address info returned by mnet_getaddrinfo.
+// register a socket with the loop.
 //
-// res: address info to free.
+// events: mnet_loop_events_t flags. (in, out, edge, oneshot)
+// udata: user pointer returned with every event. (can be NULL)
 // ----------------------------------------------------------------
-void mnet_freeaddrinfo(struct addrinfo* res);
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_loop_add(
+                mnet_loop_t* loop,
+                mnet_socket_t sock,
+                uint32_t events,
+                void* udata);
 
 // ----------------------------------------------------------------
-// get name information from a socket address. (reverse DNS)
+// change the events and udata of a registered socket.
 //
-// addr: socket address to convert.
-// addrlen: size of address.
-// host: [out] hostname buffer.     (can be NULL)
-// hostlen: size of host buffer.
-// serv: [out] service name buffer. (can be NULL)
-// servlen: size of service buffer.
-// flags: control flags.
+// also re-arms a socket registered with mnet_loop_oneshot.
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, error code on failure.
-int mnet_getnameinfo(
-                const mnet_sockaddr_t* addr,
-                mnet_socklen_t addrlen,
-                char* host,
-                mnet_socklen_t hostlen,
-                char* serv,
-                mnet_socklen_t servlen,
-                int flags);
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_loop_mod(
+                mnet_loop_t* loop,
+                mnet_socket_t sock,
+                uint32_t events,
+                void* udata);
 
 // ----------------------------------------------------------------
-// convert ascii string IP to binary form.
+// unregister a socket from the loop.
 //
-// af: the address family.
-// src: ascii form.
-// dst: binary form.
+// should be called before closing the socket.
 // ----------------------------------------------------------------
 // returns: mnet_ok on success, mnet_error on failure.
-int mnet_inet_pton(mnet_address_family_t af, const char* src, void* dst);
+mnet_result_t mnet_loop_del(mnet_loop_t* loop, mnet_socket_t sock);
 
 // ----------------------------------------------------------------
-// convert binary IP to ascii string form.
+// wait for registered sockets to become ready.
 //
-// af: the address family.
-// src: binary form.
-// dst: ascii form buffer. (at least INET_ADDRSTRLEN or INET6_ADDRSTRLEN)
-// size: size of dst buffer.
+// events: [out] array receiving only the ready sockets.
+// max_events: size of events array.
+// timeout: timeout in milliseconds.
+//  (-1 = block forever, 0 = return immediately)
+//
+// with a timer wheel attached the due timers run first, and the
+//  wait ends early at the next deadline. (see mnet_loop_set_timers)
 // ----------------------------------------------------------------
-// returns: pointer to dst on success, NULL on error.
-const char* mnet_inet_ntop(mnet_address_family_t af, const void* src, char* dst, mnet_socklen_t size);
+// returns: number of ready sockets, 0 on timeout, -1 on error.
+int mnet_loop_wait(
+                mnet_loop_t* loop,
+                mnet_loop_event_t* events,
+                int max_events,
+                int timeout);
 
 
 // ================================================
-//              ADDRESS UTILITIES
+//            TIMER WHEEL
+//
+// hierarchical timing wheel for idle timeouts, keepalives and
+//  resend deadlines. starting and cancelling a timer is O(1) and
+//  does not allocate, the timer is embedded in the user's struct.
+//
+// 5 levels of 64 slots with a 1 ms tick. level 0 holds the next
+//  64 ms, each level above covers 64 times more. timers move down
+//  a level when their slot comes up, so an idle wheel is not
+//  touched at all until the nearest timer is due.
 //
+// attach a wheel to an mnet_loop with mnet_loop_set_timers and
+//  mnet_loop_wait shortens its timeout to the next deadline and
+//  runs the due timers.
+//
+// NOTE: a wheel is not thread-safe, use it from the loop's thread.
+//
+
+
+#define MNET_TIMER_LEVELS       5
+#define MNET_TIMER_SLOT_BITS    6
+#define MNET_TIMER_SLOTS        (1 << MNET_TIMER_SLOT_BITS)
 
+typedef struct mnet_timer mnet_timer_t;
+typedef struct mnet_timer_wheel mnet_timer_wheel_t;
+
+typedef void (*mnet_timer_callback_t)(mnet_timer_wheel_t* wheel, mnet_timer_t* timer, void* udata);
+
+struct mnet_timer
+{
+    mnet_timer_t*           next;
+    mnet_timer_t**          pprev;      // NULL while not pending.
+    uint64_t                expires;    // deadline in mnet_time_ms time.
+    int                     slot;       // level * MNET_TIMER_SLOTS + slot, -1 if already due.
+    mnet_timer_callback_t   callback;
+    void*                   udata;
+};
+
+struct mnet_timer_wheel
+{
+    uint64_t                now;        // last processed tick.
+    size_t                  count;
+    mnet_timer_t*           expired;
+    mnet_timer_t*           slots[MNET_TIMER_LEVELS][MNET_TIMER_SLOTS];
+    uint64_t                occupied[MNET_TIMER_LEVELS];
+    // one bit per non-empty slot.
+};
 
 // ----------------------------------------------------------------
-// get address family of a socket address.
+// set up a timer wheel.
 //
-// addr: pointer to address.
-// af: pointer to address family.
+// wheel: [out] wheel to initialize.
+// now_ms: current time. (mnet_time_ms)
 // ----------------------------------------------------------------
-// returns: mnet_address_family_t.
-mnet_result_t mnet_get_family(
-    const mnet_sockaddr_t* addr,
-    mnet_address_family_t* af);
+void mnet_timer_wheel_init(mnet_timer_wheel_t* wheel, uint64_t now_ms);
 
 // ----------------------------------------------------------------
-// convert socket address IP to string representation.
-//  (e.g. "192.168.1.1"/"2001:db8:85a3:0:0:8a2e:370:7334"
+// set up a timer, must be done once before it is started.
 //
-// addr: socket address (IPv4 or IPv6).
-// ip_buf: [out] buffer for IP string.
-// ip_buf_size: size of ip_buf.
+// callback: called when the timer expires, the timer is no longer
+//  pending at that point and may be started again from inside.
+// udata: user pointer passed to the callback. (can be NULL)
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, mnet_error on failure.
-int mnet_addr_ip_to_string(
-            const mnet_sockaddr_t* addr,
-            char ip_buf[],
-            size_t ip_buf_size);
+void mnet_timer_init(mnet_timer_t* timer, mnet_timer_callback_t callback, void* udata);
 
 // ----------------------------------------------------------------
-// convert socket address to string representation.
-//  (e.g. "192.168.1.1:80"/"2001:db8:85a3:0:0:8a2e:370:7334]:8001"
+// start (or restart) a timer.
 //
-// addr: socket address (IPv4 or IPv6).
-// ip_buf: [out] buffer for IP string.
-// ip_buf_size: size of ip_buf.
+// expires_ms: deadline in mnet_time_ms time, a deadline in the
+//  past fires with the next mnet_timer_wheel_advance.
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, mnet_error on failure.
-int mnet_addr_to_string(
-            const mnet_sockaddr_t* addr,
-            char ip_buf[],
-            size_t ip_buf_size,
-            uint16_t port);
+void mnet_timer_start(mnet_timer_wheel_t* wheel, mnet_timer_t* timer, uint64_t expires_ms);
 
 // ----------------------------------------------------------------
-// get port from socket address.
+// stop a pending timer. (no-op if it is not pending)
+// ----------------------------------------------------------------
+void mnet_timer_cancel(mnet_timer_wheel_t* wheel, mnet_timer_t* timer);
+
+// ----------------------------------------------------------------
+// check if a timer is started and has not fired yet.
+// ----------------------------------------------------------------
+// returns: 1 if pending, 0 otherwise.
+int mnet_timer_pending(const mnet_timer_t* timer);
+
+// ----------------------------------------------------------------
+// move the wheel forward and call the callbacks of due timers.
 //
-// addr: socket address.
+// now_ms: current time. (mnet_time_ms)
 // ----------------------------------------------------------------
-// returns: port in host byte order, or 0 on error.
-uint16_t mnet_addr_get_port(const mnet_sockaddr_t* addr);
+// returns: number of timers fired.
+int mnet_timer_wheel_advance(mnet_timer_wheel_t* wheel, uint64_t now_ms);
 
 // ----------------------------------------------------------------
-// set port on socket address.
+// get the time until the next timer may be due.
+//  (a timer further than 64 ms away can wake up early, to be
+//  moved down the wheel)
 //
-// addr: socket address.
-// port: port in host byte order.
+// now_ms: current time. (mnet_time_ms)
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, mnet_error on failure.
-int mnet_addr_set_port(mnet_sockaddr_t* addr, uint16_t port);
+// returns: milliseconds, 0 if one is due, -1 if none are pending.
+int mnet_timer_wheel_timeout(const mnet_timer_wheel_t* wheel, uint64_t now_ms);
+
+// ----------------------------------------------------------------
+// attach a timer wheel to an event loop. (NULL to detach)
+//
+// mnet_loop_wait then runs the due timers before it blocks, and
+//  never blocks past the next deadline.
+// ----------------------------------------------------------------
+void mnet_loop_set_timers(mnet_loop_t* loop, mnet_timer_wheel_t* wheel);
+
 
 // ================================================
-//              BYTE ORDER CONVERSION
+//            COROUTINES
+//
+// stackless coroutines for connection handlers. a handler is a
+//  plain function that reads like blocking code, but every
+//  mnet_co_* call that would block suspends it into the
+//  scheduler's event loop instead. (protothread style: a switch
+//  on the line the handler stopped at, no stack per coroutine)
+//
+// static mnet_co_status_t echo(mnet_co_t* co)
+// {
+//     conn_t* c = co->udata;
+//     MNET_CO_BEGIN(co);
+//     for (;;)
+//     {
+//         MNET_CO_AWAIT(co, c->n, mnet_co_recv(co, c->sock, c->buf, sizeof(c->buf), 0));
+//         if (c->n <= 0) break;
+//         MNET_CO_AWAIT(co, c->n, mnet_co_send(co, c->sock, c->buf, (size_t)c->n, 0));
+//         if (c->n < 0) break;
+//     }
+//     mnet_co_close(co, c->sock);
+//     free(c);
+//     MNET_CO_END(co);
+// }
 //
+// a coroutine is ~100 bytes embedded in the user's struct, the
+//  scheduler does not allocate per coroutine.
+//
+// NOTE: local variables do not survive a suspension, keep state
+//  in udata. only one MNET_CO_* macro per source line.
+// NOTE: sockets used with mnet_co_* must be non-blocking.
+//  (mnet_set_blocking(sock, 0), mnet_co_accept does it for you)
+// NOTE: a scheduler is not thread-safe, run one per thread.
+//
+
+
+#define MNET_CO_WAIT    (-2)
+// returned by mnet_co_* calls that suspended, MNET_CO_AWAIT
+//  returns to the scheduler on it and retries the call on resume.
+
+typedef enum mnet_co_status
+{
+    mnet_co_suspended   = 0,    // waiting, resumed by the scheduler.
+    mnet_co_done        = 1     // finished, never resumed again.
+} mnet_co_status_t;
+
+typedef struct mnet_co mnet_co_t;
+typedef struct mnet_co_sched mnet_co_sched_t;
+
+typedef mnet_co_status_t (*mnet_co_fn_t)(mnet_co_t* co);
+
+struct mnet_co
+{
+    mnet_co_fn_t        fn;
+    void*               udata;
+    mnet_co_sched_t*    sched;
+    mnet_co_t*          next;           // ready queue.
+    size_t              progress;       // bytes of the current mnet_co_send done.
+    mnet_timer_t        timer;          // mnet_co_sleep.
+    mnet_socket_t       wait_sock;      // socket waited on.
+    mnet_socket_t       reg_sock;       // last socket registered with the loop.
+    int                 line;           // where to resume, 0 = start.
+    uint8_t             wait_events;    // mnet_loop_events_t waited for.
+    uint8_t             reg_events;     // mnet_loop_events_t registered for reg_sock.
+    uint8_t             flags;
+};
+
+struct mnet_co_sched
+{
+    mnet_loop_t         loop;
+    mnet_timer_wheel_t  timers;
+    mnet_co_t*          ready_head;
+    mnet_co_t*          ready_tail;
+    size_t              count;          // coroutines not done yet.
+};
 
 // ----------------------------------------------------------------
-// convert 16-bit value from host to network byte order.
+// start of a coroutine body, right after the declarations.
 // ----------------------------------------------------------------
-uint16_t mnet_htons(uint16_t hostshort);
+#define MNET_CO_BEGIN(co)   switch ((co)->line) { case 0:
 
 // ----------------------------------------------------------------
-// convert 16-bit value from network to host byte order.
+// end of a coroutine body. (also returns mnet_co_done)
 // ----------------------------------------------------------------
-uint16_t mnet_ntohs(uint16_t netshort);
+#define MNET_CO_END(co)     } return mnet_co_done
 
 // ----------------------------------------------------------------
-// convert 32-bit value from host to network byte order.
+// run op, suspending and running it again while it returns
+//  MNET_CO_WAIT. result receives its final return value.
 // ----------------------------------------------------------------
-uint32_t mnet_htonl(uint32_t hostlong);
+#define MNET_CO_AWAIT(co, result, op)                               \
+    do                                                              \
+    {                                                               \
+        (co)->line = __LINE__;                                      \
+        if (0) { case __LINE__:; }                                  \
+        if (((result) = (op)) == MNET_CO_WAIT)                      \
+            return mnet_co_suspended;                               \
+    } while (0)
 
 // ----------------------------------------------------------------
-// convert 32-bit value from network to host byte order.
+// let the other ready coroutines run, then continue.
 // ----------------------------------------------------------------
-uint32_t mnet_ntohl(uint32_t netlong);
+#define MNET_CO_YIELD(co)                                           \
+    do                                                              \
+    {                                                               \
+        (co)->line = __LINE__;                                      \
+        mnet_co_ready(co);                                          \
+        return mnet_co_suspended;                                   \
+        case __LINE__:;                                             \
+    } while (0)
 
-// ================================================
-//                  ERROR HANDLING
-//
+// ----------------------------------------------------------------
+// set up a scheduler. (creates its event loop and timer wheel)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_co_sched_init(mnet_co_sched_t* sched);
 
 // ----------------------------------------------------------------
-// get the last error for this thread.
+// destroy a scheduler.
+//
+// NOTE: coroutines that are not done are dropped, their sockets
+//  are NOT closed.
 // ----------------------------------------------------------------
-mnet_error_t mnet_get_platform_error(void);
+void mnet_co_sched_destroy(mnet_co_sched_t* sched);
 
+// ----------------------------------------------------------------
+// start a coroutine, it first runs on the next mnet_co_sched_run_once.
+//
+// co: coroutine, usually embedded in udata. (must stay valid until done)
+// fn: handler function.
+// udata: user pointer, available as co->udata. (can be NULL)
+// ----------------------------------------------------------------
+void mnet_co_spawn(mnet_co_sched_t* sched, mnet_co_t* co, mnet_co_fn_t fn, void* udata);
 
 // ----------------------------------------------------------------
-// human readable ascii string representing the error code.
+// wait for events once and run every coroutine that became ready.
 //
-// NOTE: this is NOT thread-safe use mnet_error_string_r(...)
-//  for multithreaded environments.
+// timeout_ms: time to wait if none are ready. (-1 = forever)
 // ----------------------------------------------------------------
-// returns: the string , DO NOT FREE.
-const char* mnet_error_string(mnet_error_t error_code);
+// returns: number of coroutines resumed, -1 on error.
+int mnet_co_sched_run_once(mnet_co_sched_t* sched, int timeout_ms);
 
 // ----------------------------------------------------------------
-// human readable ascii string representing the error code.
+// run until every coroutine is done.
 // ----------------------------------------------------------------
-void mnet_error_string_r(mnet_error_t error_code, char* buf, size_t bufsize);
+// returns: mnet_ok when all are done, mnet_error on failure.
+mnet_result_t mnet_co_sched_run(mnet_co_sched_t* sched);
 
+// ----------------------------------------------------------------
+// queue a suspended coroutine to run again. (see MNET_CO_YIELD)
+// ----------------------------------------------------------------
+void mnet_co_ready(mnet_co_t* co);
 
-// ================================================
-//              ADDRESS CREATORS
-//
+// ----------------------------------------------------------------
+// receive data. (see mnet_recv)
+// ----------------------------------------------------------------
+// returns: as mnet_recv, or MNET_CO_WAIT if nothing is there yet.
+int mnet_co_recv(mnet_co_t* co, mnet_socket_t sock, void* buf, size_t len, mnet_msg_flags_t flags);
 
 // ----------------------------------------------------------------
-// create an IPv4 address structure.
+// send all of buf. (see mnet_send)
 //
-// addr: [out] address structure.
-// ip: IP address string.
-//  (e.g. "129.168.1.1", or NULL/"0.0.0.0" for INADDR_ANY)
-// port: port, host byte order.
+// NOTE: buf and len must stay the same while it waits.
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, mnet_error on failure.
-int mnet_addr_ipv4(     mnet_sockaddr_in_t *    addr, const char* ip,   uint16_t port);
+// returns: len once everything is sent, -1 on error,
+//  or MNET_CO_WAIT if the socket buffer is full.
+int mnet_co_send(mnet_co_t* co, mnet_socket_t sock, const void* buf, size_t len, mnet_msg_flags_t flags);
 
 // ----------------------------------------------------------------
-// create an IPv6 address structure.
+// accept a connection, the new socket is made non-blocking.
+//  (see mnet_accept)
 //
-// addr: [out] address structure.
-// ip: IP address string.
-//  (e.g. "::1" or NULL/"::" for in6addr_any)
-// port: port, host byte order.
+// client: [out] accepted socket.
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, mnet_error on failure.
-int mnet_addr_ipv6(     mnet_sockaddr_in6_t*    addr, const char* ip,   uint16_t port);
+// returns: mnet_ok on success, mnet_error on failure,
+//  or MNET_CO_WAIT if no connection is pending.
+int mnet_co_accept(
+                mnet_co_t* co,
+                mnet_socket_t sock,
+                mnet_socket_t* client,
+                mnet_sockaddr_t* addr,
+                mnet_socklen_t* addrlen);
 
 // ----------------------------------------------------------------
-// create an IPv4 address structure. (INADDR_ANY)
-//
-// addr: [out] address structure.
-// port: port, host byte order.
+// wait for ms milliseconds, counted from the first call.
+//  (an early resume with mnet_co_ready does not restart the wait)
 // ----------------------------------------------------------------
-// returns: mnet_ok on success, mnet_error on failure.
-int mnet_addr_any_ipv4( mnet_sockaddr_in_t *    addr,                   uint16_t port);
+// returns: mnet_ok when the time is up, MNET_CO_WAIT before.
+int mnet_co_sleep(mnet_co_t* co, uint32_t ms);
 
 // ----------------------------------------------------------------
-// create an IPv6 address structure. (in6addr_any)
-//
-// addr: [out] address structure.
-// port: port, host byte order.
+// unregister a socket from the scheduler and close it.
 // ----------------------------------------------------------------
 // returns: mnet_ok on success, mnet_error on failure.
-int mnet_addr_any_ipv6( mnet_sockaddr_in6_t*    addr,                   uint16_t port);
-
-#endif//MNET_MNET_H
-
-///////////////////////////////////////
-//              SOURCE
-///////////////////////////////////////
-#ifdef MNET_SOURCE
+mnet_result_t mnet_co_close(mnet_co_t* co, mnet_socket_t sock);
 
 
 // ================================================
-// INITIALIZATION & CLEANUP
+//            COMPLETION I/O (IO_URING)
+//
+// submit/complete API for the data transfer functions.
+//  operations are queued without a syscall and handed to the
+//  kernel in one batch by mnet_uring_submit/mnet_uring_wait.
+//
+// backed by io_uring when mnet is built with MNET_IO_URING and
+//  the kernel supports it (5.11+, provided buffers need 5.19+,
+//  mnet_uring_recv_multishot needs 6.0+).
+//  otherwise the same API is served by a mnet_poll based fallback
+//  that performs the operations once their socket is ready.
+//
+// NOTE: a ring must only be used by one thread.
+// NOTE: buffers, iovecs and addresses passed in must stay valid
+//  until the operation completes.
 //
 
 
-mnet_result_t mnet_initialize(void)
+typedef enum mnet_uring_cqe_flags
 {
-#ifdef MNET_WINDOWS
+    mnet_uring_cqe_more     = 0x01,
+    // multishot operation is still armed, more completions follow.
 
-    WSADATA wsa_data;
-    return WSAStartup(MAKEWORD(2, 2), &wsa_data);
+    mnet_uring_cqe_buffer   = 0x02
+    // a provided buffer was consumed, see buf_id.
+} mnet_uring_cqe_flags_t;
 
-#elif MNET_UNIX
+typedef struct mnet_uring_cqe
+{
+    void*       udata;      // as given when the operation was queued.
+    int         res;
+    // ( >= 0 )    result of the operation. (bytes, or accepted socket)
+    // ( < 0 )     negated error code. (e.g. -mnet_econnreset)
 
-    return 0
+    uint32_t    flags;      // mnet_uring_cqe_flags_t.
+    uint16_t    buf_id;     // provided buffer holding the data.
+} mnet_uring_cqe_t;
 
+typedef struct mnet_uring_op
+{
+    uint8_t                 type;
+    uint8_t                 multishot;
+    int                     msg_flags;
+    mnet_socket_t           sock;
+    void*                   buf;
+    size_t                  len;
+    mnet_iovec_t*           iov;
+    int                     iovcnt;
+    mnet_sockaddr_t*        addr;
+    mnet_socklen_t*         addrlen;
+    void*                   udata;
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    struct msghdr           msg;
 #endif
-}
+} mnet_uring_op_t;
 
-mnet_result_t mnet_cleanup(void)
+typedef struct mnet_uring
 {
-#ifdef MNET_WINDOWS
-    WSACleanup();
+    int                     native;
+    // 1 = kernel io_uring, 0 = mnet_poll fallback.
+
+    mnet_uring_op_t*        ops;
+    uint32_t*               free_ops;
+    uint32_t                free_op_count;
+    uint32_t                op_capacity;
+
+    uint8_t*                bufs;
+    uint32_t                buf_size;
+    uint16_t                buf_count;
+
+    // fallback state.
+    uint32_t*               pending;
+    uint32_t                pending_count;
+    mnet_pollfd_t*          pfds;
+    mnet_uring_cqe_t*       cqes;
+    uint32_t                cq_head;
+    uint32_t                cq_count;
+    uint16_t*               free_bufs;
+    uint16_t                free_buf_count;
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    int                     ring_fd;
+    void*                   sq_map;
+    size_t                  sq_map_size;
+    void*                   cq_map;
+    size_t                  cq_map_size;
+    struct io_uring_sqe*    sqes;
+    size_t                  sqes_size;
+    uint32_t*               sq_head;
+    uint32_t*               sq_tail;
+    uint32_t*               sq_array;
+    uint32_t                sq_mask;
+    uint32_t                sq_entries;
+    uint32_t                sq_local_tail;
+    uint32_t*               cq_head_ptr;
+    uint32_t*               cq_tail_ptr;
+    uint32_t                cq_mask;
+    struct io_uring_cqe*    cq_cqes;
+    struct io_uring_buf*    buf_ring;
+    size_t                  buf_ring_size;
 #endif
-    return mnet_ok;
-}
+} mnet_uring_t;
 
-
-// ================================================
-//       CORE SOCKET CREATION AND MANAGEMENT
+// ----------------------------------------------------------------
+// create a completion ring.
 //
+// ring: [out] ring to initialize.
+// entries: submission queue size, also bounds operations in flight.
+//  (rounded up to a power of 2)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+//  falls back to mnet_poll when io_uring is unavailable,
+//  see mnet_uring_is_native.
+mnet_result_t mnet_uring_init(mnet_uring_t* ring, uint32_t entries);
 
+// ----------------------------------------------------------------
+// destroy a completion ring.
+//
+// NOTE: operations still in flight are cancelled by the kernel,
+//  sockets are NOT closed.
+// ----------------------------------------------------------------
+void mnet_uring_destroy(mnet_uring_t* ring);
 
-mnet_socket_t mnet_socket(
-    const mnet_address_family_t domain,
-    const mnet_socket_type_t    type,
-    const mnet_protocol_t       protocol)
-{
-    return socket((int)domain, (int)type, (int)protocol);
-}
+// ----------------------------------------------------------------
+// check which backend a ring uses.
+// ----------------------------------------------------------------
+// returns: 1 if backed by kernel io_uring, 0 if by the fallback.
+int mnet_uring_is_native(const mnet_uring_t* ring);
 
-mnet_result_t mnet_close(mnet_socket_t sock)
-{
-#ifdef MNET_WINDOWS
-    return closesocket(sock);
-#elif defined(MNET_UNIX)
-    return close(sock);
-#endif
-}
+// ----------------------------------------------------------------
+// set up the provided buffers used by mnet_uring_recv_multishot.
+//
+// count: number of buffers. (power of 2, max 32768)
+// size: size of each buffer in bytes.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_uring_setup_buffers(mnet_uring_t* ring, uint16_t count, uint32_t size);
 
-mnet_result_t mnet_socket_is_valid(mnet_socket_t sock)
-{
-    return sock != MNET_INVALID_SOCKET;
-}
+// ----------------------------------------------------------------
+// get a provided buffer by id. (from mnet_uring_cqe_t.buf_id)
+// ----------------------------------------------------------------
+// returns: pointer to the buffer, NULL on error.
+void* mnet_uring_buffer(const mnet_uring_t* ring, uint16_t buf_id);
 
+// ----------------------------------------------------------------
+// hand a provided buffer back once its data is consumed.
+// ----------------------------------------------------------------
+void mnet_uring_recycle_buffer(mnet_uring_t* ring, uint16_t buf_id);
 
-// ================================================
-//         CONNECTION MANAGEMENT (TCP)
+// ----------------------------------------------------------------
+// queue operations. (no syscall)
 //
+// same arguments as mnet_send/mnet_recv/mnet_sendv/mnet_recvv/
+//  mnet_accept/mnet_connect, plus udata returned in the completion.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if too many are in flight.
+//  (mnet_enobufs: too many completions unreaped, reap and retry)
+mnet_result_t mnet_uring_send(
+                mnet_uring_t* ring,
+                mnet_socket_t sock,
+                const void* buf,
+                size_t len,
+                mnet_msg_flags_t flags,
+                void* udata);
 
+mnet_result_t mnet_uring_recv(
+                mnet_uring_t* ring,
+                mnet_socket_t sock,
+                void* buf,
+                size_t len,
+                mnet_msg_flags_t flags,
+                void* udata);
 
-mnet_result_t mnet_bind(mnet_socket_t sock, const mnet_sockaddr_t* addr, mnet_socklen_t addrlen)
+mnet_result_t mnet_uring_sendv(
+                mnet_uring_t* ring,
+                mnet_socket_t sock,
+                const mnet_iovec_t* iov,
+                int iovcnt,
+                mnet_msg_flags_t flags,
+                void* udata);
+
+mnet_result_t mnet_uring_recvv(
+                mnet_uring_t* ring,
+                mnet_socket_t sock,
+                mnet_iovec_t* iov,
+                int iovcnt,
+                mnet_msg_flags_t flags,
+                void* udata);
+
+mnet_result_t mnet_uring_accept(
+                mnet_uring_t* ring,
+                mnet_socket_t sock,
+                mnet_sockaddr_t* addr,
+                mnet_socklen_t* addrlen,
+                void* udata);
+
+mnet_result_t mnet_uring_connect(
+                mnet_uring_t* ring,
+                mnet_socket_t sock,
+                const mnet_sockaddr_t* addr,
+                mnet_socklen_t addrlen,
+                void* udata);
+
+// ----------------------------------------------------------------
+// queue an accept that keeps completing for every new connection.
+//  (completions carry mnet_uring_cqe_more while still armed)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if too many are in flight.
+mnet_result_t mnet_uring_accept_multishot(
+                mnet_uring_t* ring,
+                mnet_socket_t sock,
+                void* udata);
+
+// ----------------------------------------------------------------
+// queue a recv that keeps completing into provided buffers.
+//  (see mnet_uring_setup_buffers)
+//
+// every completion names the filled buffer in buf_id, which must be
+//  returned with mnet_uring_recycle_buffer. running out of buffers
+//  ends the multishot with -mnet_enobufs.
+//
+// NOTE: kernels before 6.0 have provided buffers but no multishot
+//  recv, the native ring then completes it with -EINVAL.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if too many are in flight.
+mnet_result_t mnet_uring_recv_multishot(
+                mnet_uring_t* ring,
+                mnet_socket_t sock,
+                void* udata);
+
+// ----------------------------------------------------------------
+// hand all queued operations to the kernel. (one syscall)
+// ----------------------------------------------------------------
+// returns: number of operations submitted, -1 on error.
+int mnet_uring_submit(mnet_uring_t* ring);
+
+// ----------------------------------------------------------------
+// submit queued operations and wait for completions.
+//
+// cqes: [out] array of completions.
+// max_cqes: size of cqes array.
+// timeout: timeout in milliseconds.
+//  (-1 = block forever, 0 = return immediately)
+// ----------------------------------------------------------------
+// returns: number of completions, 0 on timeout, -1 on error.
+int mnet_uring_wait(
+                mnet_uring_t* ring,
+                mnet_uring_cqe_t* cqes,
+                int max_cqes,
+                int timeout);
+
+
+// ================================================
+//           ADDRESS AND NAME RESOLUTION
+//
+
+
+// ----------------------------------------------------------------
+// get the local address its bound to.
+//
+// addr: output buffer for the address.
+// addrlen: pointer to buffer size. (updated with actual size)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_getsockname(
+            mnet_socket_t sock,
+            mnet_sockaddr_t* addr,
+            mnet_socklen_t* addrlen);
+
+// ----------------------------------------------------------------
+// get the remote address it's connected to.
+//
+// addr: output buffer for the address.
+// addrlen: pointer to buffer size. (updated with actual size)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_getpeername(
+                mnet_socket_t sock,
+                mnet_sockaddr_t* addr,
+                mnet_socklen_t* addrlen);
+
+// ----------------------------------------------------------------
+// resolve hostname to IP addresses. (DNS lookup)
+//
+// node: hostname or IP address string. (e.g., "google.com")
+// service: service name or port string. (e.g., "http" or "80")
+// hints: optional hints for resolution. (can be NULL)
+// res: [out] result list. (must be freed with mnet_freeaddrinfo)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, error code on failure.
+int mnet_getaddrinfo(
+                const char* node,
+                const char* service,
+                const struct addrinfo* hints,
+                struct addrinfo** res);
+
+// ----------------------------------------------------------------
+// free address info returned by mnet_getaddrinfo.
+//
+// res: address info to free.
+// ----------------------------------------------------------------
+void mnet_freeaddrinfo(struct addrinfo* res);
+
+// ----------------------------------------------------------------
+// get name information from a socket address. (reverse DNS)
+//
+// addr: socket address to convert.
+// addrlen: size of address.
+// host: [out] hostname buffer.     (can be NULL)
+// hostlen: size of host buffer.
+// serv: [out] service name buffer. (can be NULL)
+// servlen: size of service buffer.
+// flags: control flags.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, error code on failure.
+int mnet_getnameinfo(
+                const mnet_sockaddr_t* addr,
+                mnet_socklen_t addrlen,
+                char* host,
+                mnet_socklen_t hostlen,
+                char* serv,
+                mnet_socklen_t servlen,
+                int flags);
+
+// ----------------------------------------------------------------
+// convert ascii string IP to binary form.
+//
+// af: the address family.
+// src: ascii form.
+// dst: binary form.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_inet_pton(mnet_address_family_t af, const char* src, void* dst);
+
+// ----------------------------------------------------------------
+// convert binary IP to ascii string form.
+//
+// af: the address family.
+// src: binary form.
+// dst: ascii form buffer. (at least INET_ADDRSTRLEN or INET6_ADDRSTRLEN)
+// size: size of dst buffer.
+// ----------------------------------------------------------------
+// returns: pointer to dst on success, NULL on error.
+const char* mnet_inet_ntop(mnet_address_family_t af, const void* src, char* dst, mnet_socklen_t size);
+
+
+// ================================================
+//              ADDRESS UTILITIES
+//
+
+
+// ----------------------------------------------------------------
+// get address family of a socket address.
+//
+// addr: pointer to address.
+// af: pointer to address family.
+// ----------------------------------------------------------------
+// returns: mnet_address_family_t.
+mnet_result_t mnet_get_family(
+    const mnet_sockaddr_t* addr,
+    mnet_address_family_t* af);
+
+// ----------------------------------------------------------------
+// convert socket address IP to string representation.
+//  (e.g. "192.168.1.1"/"2001:db8:85a3::8a2e:370:7334"
+//
+// addr: socket address (IPv4 or IPv6).
+// ip_buf: [out] buffer for IP string.
+// ip_buf_size: size of ip_buf.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_addr_ip_to_string(
+            const mnet_sockaddr_t* addr,
+            char ip_buf[],
+            size_t ip_buf_size);
+
+// ----------------------------------------------------------------
+// convert socket address to string representation.
+//  (e.g. "192.168.1.1:80"/"[2001:db8:85a3::8a2e:370:7334]:8001"
+//
+// addr: socket address (IPv4 or IPv6).
+// ip_buf: [out] buffer for IP string.
+// ip_buf_size: size of ip_buf. (MNET_ADDR_STRLEN is enough)
+// port: port to append, host byte order.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_addr_to_string(
+            const mnet_sockaddr_t* addr,
+            char ip_buf[],
+            size_t ip_buf_size,
+            uint16_t port);
+
+// ----------------------------------------------------------------
+// get port from socket address.
+//
+// addr: socket address.
+// ----------------------------------------------------------------
+// returns: port in host byte order, or 0 on error.
+MNET_INLINE_API uint16_t mnet_addr_get_port(const mnet_sockaddr_t* addr);
+
+// ----------------------------------------------------------------
+// set port on socket address.
+//
+// addr: socket address.
+// port: port in host byte order.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_addr_set_port(mnet_sockaddr_t* addr, uint16_t port);
+
+// ================================================
+//              ENDPOINTS
+//
+// mnet_endpoint_t is a compact (20 byte) IPv4/IPv6 address + port,
+//  for keying per-peer state without a 128 byte sockaddr_storage.
+//  it is zero padded, so endpoints can be hashed and compared as
+//  plain bytes.
+//
+// the parse and format routines below are hand-written and do not
+//  go through inet_pton/inet_ntop. (no locale, no allocations)
+//
+// NOTE: IPv6 scope ids are not kept.
+//
+
+
+#define MNET_ENDPOINT_IPV4      4
+#define MNET_ENDPOINT_IPV6      6
+
+typedef struct mnet_endpoint
+{
+    uint8_t     addr[16];   // network byte order, IPv4 uses the first 4 bytes.
+    uint16_t    port;       // host byte order.
+    uint8_t     family;     // MNET_ENDPOINT_IPV4/MNET_ENDPOINT_IPV6, 0 if unset.
+    uint8_t     reserved;   // always 0.
+} mnet_endpoint_t;
+
+// ----------------------------------------------------------------
+// convert a socket address to an endpoint.
+//
+// ep: [out] endpoint.
+// addr: IPv4 or IPv6 socket address.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_endpoint_from_sockaddr(mnet_endpoint_t* ep, const mnet_sockaddr_t* addr);
+
+// ----------------------------------------------------------------
+// convert an endpoint to a socket address.
+//
+// out: [out] socket address.
+// ----------------------------------------------------------------
+// returns: sizeof the written address structure, 0 on error.
+mnet_socklen_t mnet_endpoint_to_sockaddr(const mnet_endpoint_t* ep, mnet_sockaddr_storage* out);
+
+// ----------------------------------------------------------------
+// hash an endpoint. (all 64 bits are mixed)
+// ----------------------------------------------------------------
+uint64_t mnet_endpoint_hash(const mnet_endpoint_t* ep);
+
+// ----------------------------------------------------------------
+// compare two endpoints.
+// ----------------------------------------------------------------
+// returns: 1 if equal, 0 otherwise.
+int mnet_endpoint_equal(const mnet_endpoint_t* a, const mnet_endpoint_t* b);
+
+// ----------------------------------------------------------------
+// parse an endpoint string.
+//  (e.g. "192.168.1.1:80", "[2001:db8::1]:80", or without the port,
+//  "192.168.1.1"/"2001:db8::1", which leaves port 0)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_endpoint_parse(mnet_endpoint_t* ep, const char* str);
+
+// ----------------------------------------------------------------
+// format an endpoint as "ip:port" or "[ip6]:port".
+//
+// buf: [out] buffer for the string. (MNET_ADDR_STRLEN is enough)
+// size: size of buf.
+// ----------------------------------------------------------------
+// returns: string length, or -1 if buf is too small.
+int mnet_endpoint_to_string(const mnet_endpoint_t* ep, char* buf, size_t size);
+
+// ----------------------------------------------------------------
+// parse a dotted decimal IPv4 address.
+//
+// src: string, does not need to be null-terminated.
+// len: string length.
+// out: [out] address in network byte order.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_ipv4_parse(const char* src, size_t len, uint8_t out[4]);
+
+// ----------------------------------------------------------------
+// parse a textual IPv6 address. (with "::" and a trailing
+//  dotted IPv4 part, no scope id)
+//
+// src: string, does not need to be null-terminated.
+// len: string length.
+// out: [out] address in network byte order.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_ipv6_parse(const char* src, size_t len, uint8_t out[16]);
+
+// ----------------------------------------------------------------
+// format an IPv4 address. (dst needs MNET_IPV4_STRLEN bytes)
+// ----------------------------------------------------------------
+// returns: string length.
+int mnet_ipv4_format(const uint8_t addr[4], char* dst);
+
+// ----------------------------------------------------------------
+// format an IPv6 address in RFC 5952 form, the longest run of
+//  zero groups becomes "::". (dst needs MNET_IPV6_STRLEN bytes)
+// ----------------------------------------------------------------
+// returns: string length.
+int mnet_ipv6_format(const uint8_t addr[16], char* dst);
+
+// ================================================
+//              BYTE ORDER CONVERSION
+//
+
+// ----------------------------------------------------------------
+// convert 16-bit value from host to network byte order.
+// ----------------------------------------------------------------
+MNET_INLINE_API uint16_t mnet_htons(uint16_t hostshort);
+
+// ----------------------------------------------------------------
+// convert 16-bit value from network to host byte order.
+// ----------------------------------------------------------------
+MNET_INLINE_API uint16_t mnet_ntohs(uint16_t netshort);
+
+// ----------------------------------------------------------------
+// convert 32-bit value from host to network byte order.
+// ----------------------------------------------------------------
+MNET_INLINE_API uint32_t mnet_htonl(uint32_t hostlong);
+
+// ----------------------------------------------------------------
+// convert 32-bit value from network to host byte order.
+// ----------------------------------------------------------------
+MNET_INLINE_API uint32_t mnet_ntohl(uint32_t netlong);
+
+// ================================================
+//                      TIME
+//
+
+// ----------------------------------------------------------------
+// monotonic clock in nanoseconds. (unrelated to wall time)
+// ----------------------------------------------------------------
+uint64_t mnet_time_ns(void);
+
+// ----------------------------------------------------------------
+// monotonic clock in milliseconds. (unrelated to wall time)
+// ----------------------------------------------------------------
+uint64_t mnet_time_ms(void);
+
+// ----------------------------------------------------------------
+// wall clock in nanoseconds since 1970. (same clock as the
+//  software packet timestamps)
+// ----------------------------------------------------------------
+uint64_t mnet_time_wall_ns(void);
+
+// ================================================
+//                  ERROR HANDLING
+//
+
+// ----------------------------------------------------------------
+// get the last error for this thread.
+// ----------------------------------------------------------------
+mnet_error_t mnet_get_platform_error(void);
+
+
+// ----------------------------------------------------------------
+// human readable ascii string representing the error code.
+//
+// NOTE: this is NOT thread-safe use mnet_error_string_r(...)
+//  for multithreaded environments.
+// ----------------------------------------------------------------
+// returns: the string , DO NOT FREE.
+const char* mnet_error_string(mnet_error_t error_code);
+
+// ----------------------------------------------------------------
+// human readable ascii string representing the error code.
+// ----------------------------------------------------------------
+void mnet_error_string_r(mnet_error_t error_code, char* buf, size_t bufsize);
+
+
+// ================================================
+//              ADDRESS CREATORS
+//
+
+// ----------------------------------------------------------------
+// create an IPv4 address structure.
+//
+// addr: [out] address structure.
+// ip: IP address string.
+//  (e.g. "129.168.1.1", or NULL/"0.0.0.0" for INADDR_ANY)
+// port: port, host byte order.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_addr_ipv4(     mnet_sockaddr_in_t *    addr, const char* ip,   uint16_t port);
+
+// ----------------------------------------------------------------
+// create an IPv6 address structure.
+//
+// addr: [out] address structure.
+// ip: IP address string.
+//  (e.g. "::1" or NULL/"::" for in6addr_any)
+// port: port, host byte order.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_addr_ipv6(     mnet_sockaddr_in6_t*    addr, const char* ip,   uint16_t port);
+
+// ----------------------------------------------------------------
+// create an IPv4 address structure. (INADDR_ANY)
+//
+// addr: [out] address structure.
+// port: port, host byte order.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_addr_any_ipv4( mnet_sockaddr_in_t *    addr,                   uint16_t port);
+
+// ----------------------------------------------------------------
+// create an IPv6 address structure. (in6addr_any)
+//
+// addr: [out] address structure.
+// port: port, host byte order.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+int mnet_addr_any_ipv6( mnet_sockaddr_in6_t*    addr,                   uint16_t port);
+
+// ================================================
+//                  THREADS
+//
+// minimal portable threads for the multi-threaded parts of mnet.
+//
+
+
+#ifdef MNET_WINDOWS
+    typedef HANDLE      mnet_thread_t;
+#else
+    typedef pthread_t   mnet_thread_t;
+#endif
+
+// ----------------------------------------------------------------
+// start a thread.
+//
+// thread: [out] thread handle.
+// fn: thread function.
+// arg: passed to fn.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_thread_create(mnet_thread_t* thread, void (*fn)(void* arg), void* arg);
+
+// ----------------------------------------------------------------
+// wait for a thread to finish and release its handle.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_thread_join(mnet_thread_t thread);
+
+// ----------------------------------------------------------------
+// pin the calling thread to one CPU.
+//
+// cpu: CPU index. (0 to mnet_cpu_count() - 1)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure or if the
+//  platform has no affinity API.
+mnet_result_t mnet_thread_pin(int cpu);
+
+// ----------------------------------------------------------------
+// get the number of online CPUs.
+// ----------------------------------------------------------------
+// returns: number of CPUs, at least 1.
+int mnet_cpu_count(void);
+
+
+// ================================================
+//          INSTRUMENTATION
+//
+// optional counters for the data transfer wrappers, enabled by
+//  building with MNET_STATS (CMake option MNET_STATS). without it
+//  the wrappers are not touched at all and the functions below
+//  only report that stats are off.
+//
+// every thread counts into its own block, so the hot path is a
+//  few plain adds and one mnet_time_ns pair per call, no atomics.
+//  mnet_stats_snapshot sums the blocks of all threads.
+//
+// sockets below MNET_STATS_MAX_SOCKETS (handle value, / 4 on
+//  windows) also get per-socket counters, reset by mnet_socket and
+//  mnet_close. they are counted the same way by the thread using the
+//  socket, one cache line per socket, so sockets of different threads
+//  don't share lines. (a socket used by several threads at the same
+//  time can lose counts) calls on other sockets show up in
+//  mnet_stats_t.untracked.
+//
+// mnet_histogram_t is a log-linear (HDR style) histogram with 32
+//  sub-buckets per power of two, within ~3% of the recorded value.
+//  it is usable on its own, without MNET_STATS.
+//
+
+
+#ifndef MNET_STATS_MAX_SOCKETS
+#   define MNET_STATS_MAX_SOCKETS   (1 << 20)
+#endif
+
+#define MNET_HISTOGRAM_SUB_BITS     5
+#define MNET_HISTOGRAM_MAX_BITS     40      // values are clamped to 2^40 - 1. (~18 minutes in ns)
+#define MNET_HISTOGRAM_BUCKETS      ((MNET_HISTOGRAM_MAX_BITS - MNET_HISTOGRAM_SUB_BITS + 1) << MNET_HISTOGRAM_SUB_BITS)
+
+typedef enum mnet_op
+{
+    mnet_op_send        = 0,
+    mnet_op_recv        = 1,
+    mnet_op_sendto      = 2,
+    mnet_op_recvfrom    = 3,
+    mnet_op_sendv       = 4,
+    mnet_op_recvv       = 5,
+    mnet_op_count       = 6
+} mnet_op_t;
+
+typedef struct mnet_histogram
+{
+    uint64_t    count;
+    uint64_t    min;
+    uint64_t    max;
+    uint64_t    sum;
+    uint64_t    buckets[MNET_HISTOGRAM_BUCKETS];
+} mnet_histogram_t;
+
+typedef struct mnet_op_stats
+{
+    uint64_t    calls;
+    uint64_t    bytes;
+    uint64_t    wouldblock;     // failed with mnet_ewouldblock.
+    uint64_t    errors;         // failed otherwise.
+} mnet_op_stats_t;
+
+typedef struct mnet_stats
+{
+    mnet_op_stats_t     ops[mnet_op_count];
+    mnet_histogram_t    op_time[mnet_op_count];     // ns per call.
+    mnet_histogram_t    rtt;                        // ns, see mnet_stats_record_rtt.
+    uint64_t            untracked;
+    // calls on sockets without per-socket counters. (see MNET_STATS_MAX_SOCKETS)
+} mnet_stats_t;
+
+typedef struct mnet_socket_stats
+{
+    uint64_t    bytes_sent;
+    uint64_t    bytes_received;
+    uint64_t    sends;
+    uint64_t    receives;
+    uint64_t    wouldblock;
+    uint64_t    errors;
+} mnet_socket_stats_t;
+
+// ----------------------------------------------------------------
+// clear a histogram.
+// ----------------------------------------------------------------
+void mnet_histogram_init(mnet_histogram_t* hist);
+
+// ----------------------------------------------------------------
+// add a value to a histogram.
+// ----------------------------------------------------------------
+void mnet_histogram_record(mnet_histogram_t* hist, uint64_t value);
+
+// ----------------------------------------------------------------
+// add all values of src to dst.
+// ----------------------------------------------------------------
+void mnet_histogram_merge(mnet_histogram_t* dst, const mnet_histogram_t* src);
+
+// ----------------------------------------------------------------
+// get the value below which a percentage of the recorded values fall.
+//
+// percentile: 0 to 100. (e.g. 99.9)
+// ----------------------------------------------------------------
+// returns: highest value of the matching bucket, 0 if empty.
+uint64_t mnet_histogram_percentile(const mnet_histogram_t* hist, double percentile);
+
+// ----------------------------------------------------------------
+// get the mean of the recorded values.
+// ----------------------------------------------------------------
+// returns: mean, 0 if empty.
+double mnet_histogram_mean(const mnet_histogram_t* hist);
+
+// ----------------------------------------------------------------
+// sum the counters and histograms of all threads.
+//
+// out: [out] totals. (about 65KB, better not on a small stack)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if built without MNET_STATS.
+mnet_result_t mnet_stats_snapshot(mnet_stats_t* out);
+
+// ----------------------------------------------------------------
+// get the counters of one socket.
+//
+// out: [out] counters since the socket was created.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if built without
+//  MNET_STATS or the socket is not tracked.
+mnet_result_t mnet_stats_socket(mnet_socket_t sock, mnet_socket_stats_t* out);
+
+// ----------------------------------------------------------------
+// record a round trip time measured by the application.
+//  (mnet_rudp records its own samples here)
+//
+// ns: round trip time in nanoseconds.
+// ----------------------------------------------------------------
+void mnet_stats_record_rtt(uint64_t ns);
+
+
+// ================================================
+//          CROSS-THREAD QUEUE & WAKEUP
+//
+// hand work to a loop thread from any other thread.
+//
+// mnet_mpsc_t is a lock-free multi producer, single consumer
+//  queue of intrusive nodes. producers push with one atomic
+//  operation, the consumer takes everything queued at once.
+//
+// mnet_wakeup_t is a socket (eventfd on linux) that is registered
+//  in the loop and made readable by mnet_wakeup_signal. signals
+//  coalesce, one wakeup can flush any number of pushed nodes.
+//
+
+
+typedef struct mnet_mpsc_node
+{
+    struct mnet_mpsc_node*  next;
+} mnet_mpsc_node_t;
+// embed as the first member of the queued struct.
+
+typedef struct mnet_mpsc
+{
+    mnet_mpsc_node_t* volatile  head;   // newest first.
+} mnet_mpsc_t;
+
+typedef struct mnet_wakeup
+{
+    mnet_socket_t       rd;
+    mnet_socket_t       wr;         // same as rd for eventfd.
+    volatile uint32_t   pending;    // 1 while a signal is unread.
+} mnet_wakeup_t;
+
+// ----------------------------------------------------------------
+// set up an empty queue.
+// ----------------------------------------------------------------
+void mnet_mpsc_init(mnet_mpsc_t* queue);
+
+// ----------------------------------------------------------------
+// push a node. (any thread)
+// ----------------------------------------------------------------
+// returns: 1 if the queue was empty, 0 otherwise.
+int mnet_mpsc_push(mnet_mpsc_t* queue, mnet_mpsc_node_t* node);
+
+// ----------------------------------------------------------------
+// take all queued nodes. (consumer thread only)
+// ----------------------------------------------------------------
+// returns: the nodes in push order linked through next,
+//  or NULL if the queue is empty.
+mnet_mpsc_node_t* mnet_mpsc_take_all(mnet_mpsc_t* queue);
+
+// ----------------------------------------------------------------
+// create a wakeup socket.
+//
+// wakeup: [out] wakeup to initialize.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_wakeup_init(mnet_wakeup_t* wakeup);
+
+// ----------------------------------------------------------------
+// close a wakeup socket.
+//
+// NOTE: remove it from any loop first.
+// ----------------------------------------------------------------
+void mnet_wakeup_destroy(mnet_wakeup_t* wakeup);
+
+// ----------------------------------------------------------------
+// get the socket to register for mnet_loop_in.
+// ----------------------------------------------------------------
+// returns: socket, MNET_INVALID_SOCKET on error.
+mnet_socket_t mnet_wakeup_socket(const mnet_wakeup_t* wakeup);
+
+// ----------------------------------------------------------------
+// make the wakeup socket readable. (any thread)
+//
+// no-op if a signal is already pending.
+// ----------------------------------------------------------------
+void mnet_wakeup_signal(mnet_wakeup_t* wakeup);
+
+// ----------------------------------------------------------------
+// reset the wakeup socket after it became readable.
+//
+// NOTE: call before consuming the queued work, so a signal sent
+//  during that is not lost.
+// ----------------------------------------------------------------
+void mnet_wakeup_drain(mnet_wakeup_t* wakeup);
+
+
+// ================================================
+//                  WORKER POOL
+//
+// work-stealing thread pool for CPU heavy handler work, so it
+//  does not stall the other sockets of a loop thread.
+//
+// every worker owns a Chase-Lev deque. jobs submitted from inside
+//  a job go to the worker's own deque (LIFO, cache warm), idle
+//  workers steal the oldest jobs from the others. jobs submitted
+//  from other threads go through a shared MPSC injection queue.
+//
+// a finished job is posted back to a mnet_pool_port_t and its done
+//  callback runs on the thread owning that port, typically the I/O
+//  thread that submitted it. (see mnet_tcp_server_offload)
+//
+
+
+#define MNET_POOL_DEQUE_SIZE    4096
+#define MNET_POOL_MAX_THREADS   256
+
+typedef struct mnet_job mnet_job_t;
+
+typedef struct mnet_pool_port
+{
+    mnet_mpsc_t         queue;
+    mnet_wakeup_t*      wakeup;
+} mnet_pool_port_t;
+
+struct mnet_job
+{
+    mnet_mpsc_node_t    node;
+    void                (*run)(mnet_job_t* job);
+    // runs on a pool worker.
+
+    void                (*done)(mnet_job_t* job);
+    // runs on the port's thread after run finished. (can be NULL)
+
+    mnet_pool_port_t*   port;
+};
+// embed as the first member of a struct carrying the job's data.
+
+typedef struct mnet_pool mnet_pool_t;
+
+typedef struct mnet_pool_worker
+{
+    volatile int64_t    top;
+    volatile int64_t    bottom;
+    mnet_job_t**        jobs;       // MNET_POOL_DEQUE_SIZE slots.
+    mnet_thread_t       thread;
+    mnet_pool_t*        pool;
+    uint32_t            rng;
+    int                 started;
+} mnet_pool_worker_t;
+
+struct mnet_pool
+{
+    mnet_pool_worker_t* workers;
+    int                 count;
+    mnet_mpsc_t         inject;
+    volatile int        running;
+    volatile uint32_t   sleepers;
+#ifdef MNET_WINDOWS
+    CRITICAL_SECTION    lock;
+    CONDITION_VARIABLE  cond;
+#else
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+#endif
+};
+
+// ----------------------------------------------------------------
+// start a worker pool.
+//
+// pool: [out] pool to initialize.
+// threads: number of workers. (0 = one per CPU)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_pool_init(mnet_pool_t* pool, int threads);
+
+// ----------------------------------------------------------------
+// stop and join the workers.
+//
+// NOTE: jobs that did not start yet are dropped without done.
+// ----------------------------------------------------------------
+void mnet_pool_destroy(mnet_pool_t* pool);
+
+// ----------------------------------------------------------------
+// run a job on the pool. (any thread, including pool workers)
+//
+// job: job with run (and optionally done) set, must stay valid
+//  until done is called, or until run returns without a port.
+// port: where the finished job is posted. (NULL for none)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_pool_submit(mnet_pool_t* pool, mnet_job_t* job, mnet_pool_port_t* port);
+
+// ----------------------------------------------------------------
+// set up a port for finished jobs.
+//
+// wakeup: signalled when a job is posted, register its socket
+//  in the owning thread's loop. (not owned)
+// ----------------------------------------------------------------
+void mnet_pool_port_init(mnet_pool_port_t* port, mnet_wakeup_t* wakeup);
+
+// ----------------------------------------------------------------
+// call done for all finished jobs. (port owning thread only)
+//
+// NOTE: drain the wakeup first. (mnet_wakeup_drain)
+// ----------------------------------------------------------------
+// returns: number of jobs completed.
+int mnet_pool_port_dispatch(mnet_pool_port_t* port);
+
+
+// ================================================
+//                  BUFFER POOL
+//
+// fixed size network buffers carved from large slabs, so the
+//  receive/send paths do not call malloc/free per message.
+//
+// buffers come in size classes, each thread keeps a small cache
+//  per class so alloc/release are lock free in steady state.
+//  buffers are refcounted and can be released on any thread.
+//
+
+
+#define MNET_BUFPOOL_MAX_CLASSES    8
+#define MNET_BUFPOOL_MAX_POOLS      16
+#define MNET_BUFPOOL_CACHE_MAX      64
+#define MNET_BUFPOOL_CACHE_BATCH    32
+#define MNET_BUF_HEADER_SIZE        64
+
+typedef enum mnet_bufpool_flags
+{
+    mnet_bufpool_default    = 0,
+
+    mnet_bufpool_hugepages  = 0x01
+    // back slabs with huge pages where available, cuts TLB misses
+    //  for large pools. falls back to normal pages.
+} mnet_bufpool_flags_t;
+
+typedef struct mnet_buf
+{
+    struct mnet_bufpool*    pool;
+    struct mnet_buf*        next;
+    volatile uint32_t       refcount;
+    uint32_t                size_class;
+    uint32_t                capacity;   // usable bytes in the buffer.
+    uint32_t                len;        // free for the user, e.g. bytes filled.
+} mnet_buf_t;
+// the data follows the header at MNET_BUF_HEADER_SIZE (cache line aligned).
+
+typedef struct mnet_bufpool_class
+{
+    uint32_t                size;
+    uint32_t                free_count;
+    mnet_buf_t*             free_list;
+} mnet_bufpool_class_t;
+
+typedef struct mnet_bufpool
+{
+    mnet_bufpool_class_t    classes[MNET_BUFPOOL_MAX_CLASSES];
+    uint32_t                class_count;
+    uint32_t                flags;
+    uint32_t                id;
+    int                     slot;       // thread cache slot, -1 if none.
+    volatile int            lock;
+    void*                   slabs;
+} mnet_bufpool_t;
+
+// ----------------------------------------------------------------
+// create a buffer pool.
+//
+// pool: [out] pool to initialize.
+// sizes: ascending buffer sizes, one per class.
+//  (NULL for 256, 1K, 2K, 4K, 16K, 64K)
+// class_count: number of elements in sizes. (max MNET_BUFPOOL_MAX_CLASSES)
+// flags: mnet_bufpool_flags_t.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_bufpool_init(
+                mnet_bufpool_t* pool,
+                const uint32_t* sizes,
+                int class_count,
+                uint32_t flags);
+
+// ----------------------------------------------------------------
+// destroy a buffer pool and all of its memory.
+//
+// NOTE: no thread may use the pool or its buffers anymore.
+// ----------------------------------------------------------------
+void mnet_bufpool_destroy(mnet_bufpool_t* pool);
+
+// ----------------------------------------------------------------
+// hand the calling thread's cached buffers back to the pool.
+//  (call before a thread that used the pool exits)
+// ----------------------------------------------------------------
+void mnet_bufpool_flush_thread(mnet_bufpool_t* pool);
+
+// ----------------------------------------------------------------
+// get a buffer of at least size bytes. (refcount 1, len 0)
+// ----------------------------------------------------------------
+// returns: buffer, or NULL if size is too large or out of memory.
+mnet_buf_t* mnet_buf_alloc(mnet_bufpool_t* pool, size_t size);
+
+// ----------------------------------------------------------------
+// take an extra reference, e.g. before handing to another thread.
+// ----------------------------------------------------------------
+void mnet_buf_retain(mnet_buf_t* buf);
+
+// ----------------------------------------------------------------
+// drop a reference, the last one returns the buffer to the pool.
+// ----------------------------------------------------------------
+void mnet_buf_release(mnet_buf_t* buf);
+
+// ----------------------------------------------------------------
+// get pointer to the buffer data.
+// ----------------------------------------------------------------
+void* mnet_buf_data(mnet_buf_t* buf);
+
+// ----------------------------------------------------------------
+// point an iovec straight into a pooled buffer.
+//
+// iov: [out] iovec to initialize.
+// offset: byte offset into the buffer data.
+// len: length, clamped to the buffer capacity.
+// ----------------------------------------------------------------
+void mnet_buf_iovec(mnet_buf_t* buf, mnet_iovec_t* iov, size_t offset, size_t len);
+
+
+// ================================================
+//              MIRRORED RING BUFFER
+//
+// stream buffer whose pages are mapped twice back to back, so
+//  both the readable data and the free space are always one
+//  contiguous span, even when they wrap the end of the ring.
+//
+// framed TCP data can be parsed in place and mnet_recv/mnet_recvv
+//  fill the ring directly, without compaction memmoves.
+//
+
+
+typedef struct mnet_ring
+{
+    uint8_t*    base;
+    size_t      size;       // capacity in bytes. (page multiple)
+    size_t      head;       // read offset, in [0, size).
+    size_t      used;       // readable bytes.
+#ifdef MNET_WINDOWS
+    HANDLE      mapping;
+#endif
+} mnet_ring_t;
+
+// ----------------------------------------------------------------
+// create a mirrored ring buffer.
+//
+// ring: [out] ring to initialize.
+// min_size: capacity, rounded up to the page size.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_ring_init(mnet_ring_t* ring, size_t min_size);
+
+// ----------------------------------------------------------------
+// unmap a ring buffer.
+// ----------------------------------------------------------------
+void mnet_ring_destroy(mnet_ring_t* ring);
+
+// ----------------------------------------------------------------
+// get the readable data. (contiguous, mnet_ring_readable bytes)
+// ----------------------------------------------------------------
+void* mnet_ring_read_ptr(const mnet_ring_t* ring);
+
+// ----------------------------------------------------------------
+// get the free space. (contiguous, mnet_ring_writable bytes)
+// ----------------------------------------------------------------
+void* mnet_ring_write_ptr(const mnet_ring_t* ring);
+
+// ----------------------------------------------------------------
+// get the number of readable bytes.
+// ----------------------------------------------------------------
+size_t mnet_ring_readable(const mnet_ring_t* ring);
+
+// ----------------------------------------------------------------
+// get the number of free bytes.
+// ----------------------------------------------------------------
+size_t mnet_ring_writable(const mnet_ring_t* ring);
+
+// ----------------------------------------------------------------
+// mark len bytes written at mnet_ring_write_ptr as readable.
+// ----------------------------------------------------------------
+void mnet_ring_commit(mnet_ring_t* ring, size_t len);
+
+// ----------------------------------------------------------------
+// drop len bytes from the front of the readable data.
+// ----------------------------------------------------------------
+void mnet_ring_consume(mnet_ring_t* ring, size_t len);
+
+// ----------------------------------------------------------------
+// describe the free space as iovecs for mnet_recvv.
+//
+// iov: [out] array of at least 2 iovecs.
+// ----------------------------------------------------------------
+// returns: number of iovecs used. (0 if full, 1 thanks to the mirror)
+int mnet_ring_write_iovecs(const mnet_ring_t* ring, mnet_iovec_t iov[2]);
+
+// ----------------------------------------------------------------
+// describe the readable data as iovecs for mnet_sendv.
+//
+// iov: [out] array of at least 2 iovecs.
+// ----------------------------------------------------------------
+// returns: number of iovecs used. (0 if empty, 1 thanks to the mirror)
+int mnet_ring_read_iovecs(const mnet_ring_t* ring, mnet_iovec_t iov[2]);
+
+// ----------------------------------------------------------------
+// receive straight into the free space and commit it.
+// ----------------------------------------------------------------
+// returns: same as mnet_recv. (mnet_enobufs if the ring is full)
+int mnet_ring_recv(mnet_ring_t* ring, mnet_socket_t sock, mnet_msg_flags_t flags);
+
+// ----------------------------------------------------------------
+// send straight from the readable data and consume what was sent.
+// ----------------------------------------------------------------
+// returns: same as mnet_send.
+int mnet_ring_send(mnet_ring_t* ring, mnet_socket_t sock, mnet_msg_flags_t flags);
+
+
+// ================================================
+//              PEER TABLE
+//
+// open-addressing hash map from mnet_endpoint_t to a session index,
+//  for finding the session of every datagram by its source address.
+//
+// swiss table layout: one control byte per slot holds 7 bits of the
+//  hash (or empty/deleted), probed 16 slots at a time. (one SSE2
+//  compare per group where available) only slots whose control byte
+//  matches are compared in full, so a lookup touches one 16 byte
+//  control group and usually a single 32 byte entry.
+//
+// every entry remembers when it was last seen, mnet_peer_table_evict
+//  removes idle peers a bounded number of slots at a time.
+//
+// NOTE: not thread-safe.
+//
+
+
+#define MNET_PEER_GROUP     16
+
+typedef struct mnet_peer_entry
+{
+    mnet_endpoint_t     ep;
+    uint32_t            session;
+    uint64_t            last_seen_ms;
+} mnet_peer_entry_t;
+
+typedef struct mnet_peer_table
+{
+    uint8_t*            ctrl;           // capacity control bytes.
+    mnet_peer_entry_t*  entries;
+    size_t              capacity;       // power of two, at least MNET_PEER_GROUP.
+    size_t              count;
+    size_t              growth_left;    // inserts until a rehash.
+    size_t              cursor;         // next slot mnet_peer_table_evict looks at.
+} mnet_peer_table_t;
+
+typedef void (*mnet_peer_evict_callback_t)(const mnet_endpoint_t* ep, uint32_t session, void* udata);
+
+// ----------------------------------------------------------------
+// set up an empty table.
+//
+// table: [out] table to initialize.
+// expected: number of peers to size for. (0 = small, grows on demand)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_peer_table_init(mnet_peer_table_t* table, size_t expected);
+
+// ----------------------------------------------------------------
+// free the table.
+// ----------------------------------------------------------------
+void mnet_peer_table_destroy(mnet_peer_table_t* table);
+
+// ----------------------------------------------------------------
+// find the session of a peer and mark it as seen.
+//
+// ep: peer endpoint.
+// now_ms: current time, stored as last seen. (0 = leave it as is)
+// session: [out] session index. (can be NULL)
+// ----------------------------------------------------------------
+// returns: 1 if found, 0 otherwise.
+int mnet_peer_table_find(mnet_peer_table_t* table, const mnet_endpoint_t* ep, uint64_t now_ms, uint32_t* session);
+
+// ----------------------------------------------------------------
+// add a peer, or replace the session of an existing one.
+//
+// now_ms: current time, stored as last seen.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure. (no memory)
+mnet_result_t mnet_peer_table_insert(
+                mnet_peer_table_t* table,
+                const mnet_endpoint_t* ep,
+                uint32_t session,
+                uint64_t now_ms);
+
+// ----------------------------------------------------------------
+// remove a peer.
+//
+// session: [out] session index it had. (can be NULL)
+// ----------------------------------------------------------------
+// returns: 1 if removed, 0 if not found.
+int mnet_peer_table_remove(mnet_peer_table_t* table, const mnet_endpoint_t* ep, uint32_t* session);
+
+// ----------------------------------------------------------------
+// remove peers not seen for idle_ms, looking at up to max_slots
+//  slots from where the last call stopped. (call it every tick
+//  with a small budget instead of sweeping the whole table)
+//
+// now_ms: current time.
+// idle_ms: idle time after which a peer is removed.
+// max_slots: slots to look at. (capacity = full sweep)
+// callback: called with every removed peer. (can be NULL)
+// udata: passed to callback.
+// ----------------------------------------------------------------
+// returns: number of peers removed.
+size_t mnet_peer_table_evict(
+                mnet_peer_table_t* table,
+                uint64_t now_ms,
+                uint64_t idle_ms,
+                size_t max_slots,
+                mnet_peer_evict_callback_t callback,
+                void* udata);
+
+
+// ================================================
+//              MESSAGE FRAMING
+//
+// splits a TCP byte stream into messages: length prefixed
+//  (u16, u32 in network byte order, or LEB128 varint), fixed size,
+//  or ended by a delimiter byte. (searched 16 bytes at a time)
+//
+// frames are views into the receive buffer, nothing is copied
+//  unless a partial frame has to move to the front of the buffer
+//  to make room. (with a mnet_ring, parse its read span directly
+//  and nothing is ever copied)
+//
+// an optional CRC32C of the payload follows it on the wire, in
+//  network byte order. (SSE4.2 / ARMv8 CRC instructions when the
+//  CPU has them)
+//
+// send side: mnet_framer_header + payload + mnet_framer_trailer,
+//  e.g. as three iovecs for mnet_sendv.
+//
+
+
+#define MNET_FRAME_HEADER_MAX   10      // longest length prefix. (varint)
+#define MNET_FRAME_TRAILER_MAX  5       // CRC32C and/or delimiter.
+
+#ifndef MNET_FRAME_DEFAULT_MAX
+#   define MNET_FRAME_DEFAULT_MAX   (16 * 1024 * 1024)
+    // largest payload of a framer without buffer or limit.
+#endif
+
+typedef enum mnet_frame_mode
+{
+    mnet_frame_u16          = 0,    // 2 byte length prefix.
+    mnet_frame_u32          = 1,    // 4 byte length prefix.
+    mnet_frame_varint       = 2,    // 1-10 byte LEB128 length prefix.
+    mnet_frame_fixed        = 3,    // every payload has the same size.
+    mnet_frame_delimiter    = 4     // payload ends at a delimiter byte.
+} mnet_frame_mode_t;
+
+typedef struct mnet_frame
+{
+    const uint8_t*  data;       // payload, points into the buffer.
+    size_t          len;        // payload bytes.
+    size_t          wire_len;   // bytes the whole frame took in the stream.
+} mnet_frame_t;
+
+typedef struct mnet_framer
+{
+    mnet_frame_mode_t   mode;
+    size_t              param;      // fixed size or delimiter byte.
+    size_t              max_frame;  // largest payload accepted.
+    int                 crc32c;     // 1 if frames carry a CRC32C.
+    size_t              scanned;    // delimiter mode: bytes already searched.
+
+    uint8_t*            buf;        // receive buffer. (NULL = parse only)
+    size_t              size;
+    size_t              start;      // first unparsed byte.
+    size_t              end;        // end of received data.
+} mnet_framer_t;
+
+// ----------------------------------------------------------------
+// create a framer.
+//
+// framer: [out] framer to initialize.
+// mode: mnet_frame_mode_t.
+// param: payload size (fixed), delimiter byte (delimiter),
+//  or largest payload accepted (length prefixes, 0 = no limit
+//  besides the buffer, MNET_FRAME_DEFAULT_MAX without one).
+// buffer_size: receive buffer for mnet_framer_recv, must fit the
+//  largest frame. (0 = no buffer, only mnet_framer_parse is used)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_framer_init(
+                mnet_framer_t* framer,
+                mnet_frame_mode_t mode,
+                size_t param,
+                size_t buffer_size);
+
+// ----------------------------------------------------------------
+// free the receive buffer.
+// ----------------------------------------------------------------
+void mnet_framer_destroy(mnet_framer_t* framer);
+
+// ----------------------------------------------------------------
+// expect (and write) a CRC32C after every payload.
+//  (not supported in delimiter mode)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_framer_set_crc32c(mnet_framer_t* framer, int enable);
+
+// ----------------------------------------------------------------
+// find the first frame in data.
+//
+// data: received bytes, starting at a frame. (pass the same start
+//  again until a frame is returned, the delimiter search resumes
+//  where it left off)
+// len: number of bytes in data.
+// frame: [out] the frame, pointing into data.
+// ----------------------------------------------------------------
+// returns:
+//  ( 1 )   frame found, drop frame->wire_len bytes from data.
+//  ( 0 )   frame incomplete, receive more.
+//  ( -1 )  malformed frame. (too large, bad varint or CRC mismatch)
+int mnet_framer_parse(
+                mnet_framer_t* framer,
+                const void* data,
+                size_t len,
+                mnet_frame_t* frame);
+
+// ----------------------------------------------------------------
+// receive into the framer's buffer.
+//
+// NOTE: frames returned by mnet_framer_next are only valid until
+//  the next call, the unparsed data may be moved to the front.
+// ----------------------------------------------------------------
+// returns: same as mnet_recv. (mnet_enobufs if a frame does not fit)
+int mnet_framer_recv(mnet_framer_t* framer, mnet_socket_t sock, mnet_msg_flags_t flags);
+
+// ----------------------------------------------------------------
+// get the next complete frame from the framer's buffer.
+//
+// frame: [out] the frame, pointing into the buffer.
+// ----------------------------------------------------------------
+// returns: as mnet_framer_parse, the frame is already dropped.
+int mnet_framer_next(mnet_framer_t* framer, mnet_frame_t* frame);
+
+// ----------------------------------------------------------------
+// encode the bytes that go before a payload.
+//
+// len: payload bytes.
+// header: [out] MNET_FRAME_HEADER_MAX bytes.
+// ----------------------------------------------------------------
+// returns: header length, 0 for none, -1 if len can't be framed.
+int mnet_framer_header(const mnet_framer_t* framer, size_t len, uint8_t* header);
+
+// ----------------------------------------------------------------
+// encode the bytes that go after a payload.
+//
+// payload: the payload, for the CRC32C.
+// len: payload bytes.
+// trailer: [out] MNET_FRAME_TRAILER_MAX bytes.
+// ----------------------------------------------------------------
+// returns: trailer length, 0 for none.
+int mnet_framer_trailer(const mnet_framer_t* framer, const void* payload, size_t len, uint8_t* trailer);
+
+// ----------------------------------------------------------------
+// compute or continue a CRC32C. (Castagnoli, as in iSCSI/ext4)
+//
+// crc: 0 to start, or the previous result to continue.
+// ----------------------------------------------------------------
+// returns: the CRC of everything so far.
+uint32_t mnet_crc32c(uint32_t crc, const void* data, size_t len);
+
+
+// ================================================
+//              WRITE QUEUE
+//
+// per connection output queue. writes are only queued, and
+//  mnet_writeq_flush sends everything queued with as few
+//  mnet_sendv calls as possible. (up to MNET_WRITEQ_IOV_MAX buffers
+//  each) short writes and mnet_ewouldblock are picked up where
+//  they stopped by the next flush.
+//
+// small writes are copied into MNET_WRITEQ_BLOCK_SIZE blocks, so
+//  a burst of tiny messages turns into one buffer and one syscall.
+//  large buffers can be queued by reference instead of copied.
+//
+// byte counts are 64 bit, a single mnet_sendv is capped at
+//  MNET_WRITEQ_MAX_SEND so its int result can't overflow.
+//
+
+
+#define MNET_WRITEQ_BLOCK_SIZE  16384
+#define MNET_WRITEQ_MAX_SEND    (1u << 30)
+
+#ifdef IOV_MAX
+#   define MNET_WRITEQ_IOV_MAX  (IOV_MAX < 1024 ? IOV_MAX : 1024)
+#else
+#   define MNET_WRITEQ_IOV_MAX  1024
+#endif
+
+typedef void (*mnet_writeq_done_t)(void* udata);
+
+typedef struct mnet_writeq_entry
+{
+    const uint8_t*      data;       // unsent bytes.
+    size_t              len;
+    uint8_t*            block;      // copy block, NULL for a reference.
+    size_t              block_size;
+    mnet_writeq_done_t  done;       // reference: called once sent or dropped.
+    void*               udata;
+} mnet_writeq_entry_t;
+
+typedef struct mnet_writeq
+{
+    mnet_writeq_entry_t*    entries;    // ring, capacity is a power of 2.
+    uint32_t                capacity;
+    uint32_t                head;
+    uint32_t                count;
+    uint8_t*                spare;      // emptied block kept for the next write.
+
+    uint64_t                pending;    // bytes queued and not sent yet.
+    uint64_t                sent;       // bytes sent.
+    uint64_t                writes;     // writes queued.
+    uint64_t                syscalls;   // mnet_sendv calls made.
+} mnet_writeq_t;
+
+// ----------------------------------------------------------------
+// set up an empty queue. (allocates on the first write)
+// ----------------------------------------------------------------
+void mnet_writeq_init(mnet_writeq_t* queue);
+
+// ----------------------------------------------------------------
+// free a queue, unsent data is dropped.
+//  (done is called for the dropped references)
+// ----------------------------------------------------------------
+void mnet_writeq_destroy(mnet_writeq_t* queue);
+
+// ----------------------------------------------------------------
+// queue a copy of data.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+//  (nothing is queued on failure)
+mnet_result_t mnet_writeq_write(mnet_writeq_t* queue, const void* data, size_t len);
+
+// ----------------------------------------------------------------
+// queue data without copying it.
+//
+// done: called once data is sent, or dropped by destroy,
+//  data must stay valid until then. (can be NULL)
+// udata: passed to done.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+//  (done is not called on failure)
+mnet_result_t mnet_writeq_write_ref(
+                mnet_writeq_t* queue,
+                const void* data,
+                size_t len,
+                mnet_writeq_done_t done,
+                void* udata);
+
+// ----------------------------------------------------------------
+// send as much of the queue as the socket takes.
+//
+// flags: flags to send with. (e.g. mnet_msg_nosignal)
+// ----------------------------------------------------------------
+// returns:
+//  ( 0 )   everything sent.
+//  ( 1 )   data left, flush again when the socket is writable.
+//  ( -1 )  error.
+int mnet_writeq_flush(mnet_writeq_t* queue, mnet_socket_t sock, mnet_msg_flags_t flags);
+
+// ----------------------------------------------------------------
+// get the number of bytes not sent yet.
+// ----------------------------------------------------------------
+uint64_t mnet_writeq_pending(const mnet_writeq_t* queue);
+
+
+// ================================================
+//            TCP SERVER (HIGH LEVEL)
+//
+// owns the listening socket and all connections, drives them
+//  from an mnet_loop and reports them through callbacks.
+//
+// connections are nonblocking, accepted in batches and stored in
+//  a table indexed by mnet_conn_id_t. ids carry a generation so a
+//  stale id of a closed (and reused) slot is rejected.
+//
+// every connection gets an input buffer (data not consumed by
+//  on_data is kept for the next call) and an output buffer
+//  (whatever the socket does not take right away is sent later).
+//
+
+
+#define MNET_TCP_ACCEPT_BATCH       64
+#define MNET_TCP_EVENT_BATCH        256
+#define MNET_TCP_READ_SIZE          16384
+#define MNET_TCP_MAX_INPUT          (1024 * 1024)
+
+typedef uint64_t mnet_conn_id_t;
+#define MNET_INVALID_CONN ((mnet_conn_id_t)0)
+
+typedef struct mnet_tcp_server mnet_tcp_server_t;
+
+typedef struct mnet_tcp_callbacks
+{
+    void    (*on_open)(mnet_tcp_server_t* server, mnet_conn_id_t conn, void* user);
+    // new connection accepted. (can be NULL)
+
+    size_t  (*on_data)(mnet_tcp_server_t* server, mnet_conn_id_t conn,
+                       const void* data, size_t len, void* user);
+    // data received, returns how many bytes were consumed.
+    //  the rest stays buffered and is passed again with the next data.
+
+    void    (*on_close)(mnet_tcp_server_t* server, mnet_conn_id_t conn, void* user);
+    // connection closed, by either side. (can be NULL)
+    //  the id is still valid inside this callback.
+} mnet_tcp_callbacks_t;
+
+typedef struct mnet_tcp_conn
+{
+    mnet_socket_t           sock;
+    uint32_t                generation;
+    uint32_t                next_free;
+    int                     closing;
+    int                     want_write;
+    uint8_t*                in_buf;
+    size_t                  in_len;
+    size_t                  in_cap;
+    int                     flush_pending;
+    mnet_writeq_t           out;
+    mnet_sockaddr_storage   addr;
+    void*                   udata;
+} mnet_tcp_conn_t;
+
+struct mnet_tcp_server
+{
+    mnet_socket_t           listener;
+    mnet_loop_t             loop;
+    mnet_tcp_callbacks_t    callbacks;
+    void*                   user;
+    mnet_tcp_conn_t*        conns;
+    uint32_t                capacity;
+    uint32_t                count;
+    uint32_t                free_head;
+    size_t                  max_input;
+    // connections buffering more than this without on_data
+    //  consuming it are closed. (default MNET_TCP_MAX_INPUT)
+
+    mnet_conn_id_t*         flushes;
+    uint32_t                flush_count;
+    uint32_t                flush_cap;
+    int                     dispatching;
+    // sends made from callbacks are only queued, and flushed once
+    //  per connection after all events of a poll are handled.
+
+    mnet_mpsc_t             commands;
+    mnet_wakeup_t           wakeup;
+    // sends and closes posted from other threads.
+
+    mnet_pool_port_t        jobs;
+    // offloaded jobs coming back from a mnet_pool.
+};
+
+// ----------------------------------------------------------------
+// create a server listening on addr.
+//
+// server: [out] server to initialize.
+// addr: local address to listen on.
+// addrlen: sizeof addr structure.
+// callbacks: connection callbacks, copied. (on_data is required)
+// user: passed to every callback.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_tcp_server_init(
+                mnet_tcp_server_t* server,
+                const mnet_sockaddr_t* addr,
+                mnet_socklen_t addrlen,
+                const mnet_tcp_callbacks_t* callbacks,
+                void* user);
+
+// ----------------------------------------------------------------
+// close all connections and the listening socket.
+//  (on_close is called for each open connection)
+// ----------------------------------------------------------------
+void mnet_tcp_server_destroy(mnet_tcp_server_t* server);
+
+// ----------------------------------------------------------------
+// wait for socket activity and dispatch the callbacks.
+//
+// timeout: timeout in milliseconds.
+//  (-1 = block forever, 0 = return immediately)
+// ----------------------------------------------------------------
+// returns: number of socket events handled, 0 on timeout, -1 on error.
+int mnet_tcp_server_poll(mnet_tcp_server_t* server, int timeout);
+
+// ----------------------------------------------------------------
+// send data on a connection.
+//
+// sends as much as the socket takes right away and buffers the
+//  rest, which is flushed once the socket is writable again.
+//  (sends from inside a callback are buffered and go out together
+//  in one mnet_sendv once the poll has handled all its events)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if conn is invalid.
+mnet_result_t mnet_tcp_server_send(
+                mnet_tcp_server_t* server,
+                mnet_conn_id_t conn,
+                const void* data,
+                size_t len);
+
+// ----------------------------------------------------------------
+// close a connection once its buffered output is sent.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if conn is invalid.
+mnet_result_t mnet_tcp_server_close(mnet_tcp_server_t* server, mnet_conn_id_t conn);
+
+// ----------------------------------------------------------------
+// get the socket of a connection.
+// ----------------------------------------------------------------
+// returns: socket, or MNET_INVALID_SOCKET if conn is invalid.
+mnet_socket_t mnet_tcp_server_socket(const mnet_tcp_server_t* server, mnet_conn_id_t conn);
+
+// ----------------------------------------------------------------
+// get the peer address of a connection.
+// ----------------------------------------------------------------
+// returns: address, or NULL if conn is invalid.
+const mnet_sockaddr_t* mnet_tcp_server_peer(const mnet_tcp_server_t* server, mnet_conn_id_t conn);
+
+// ----------------------------------------------------------------
+// attach a user pointer to a connection.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if conn is invalid.
+mnet_result_t mnet_tcp_server_set_udata(mnet_tcp_server_t* server, mnet_conn_id_t conn, void* udata);
+
+// ----------------------------------------------------------------
+// get the user pointer of a connection.
+// ----------------------------------------------------------------
+// returns: user pointer, or NULL if conn is invalid.
+void* mnet_tcp_server_get_udata(const mnet_tcp_server_t* server, mnet_conn_id_t conn);
+
+// ----------------------------------------------------------------
+// queue a send from any thread, it is performed by the thread
+//  polling the server. (copies data)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+//  (an id that is invalid by the time it runs is ignored)
+mnet_result_t mnet_tcp_server_post_send(
+                mnet_tcp_server_t* server,
+                mnet_conn_id_t conn,
+                const void* data,
+                size_t len);
+
+// ----------------------------------------------------------------
+// queue a close from any thread. (after previously posted sends)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_tcp_server_post_close(mnet_tcp_server_t* server, mnet_conn_id_t conn);
+
+// ----------------------------------------------------------------
+// interrupt a blocking mnet_tcp_server_poll from any thread.
+// ----------------------------------------------------------------
+void mnet_tcp_server_wakeup(mnet_tcp_server_t* server);
+
+// ----------------------------------------------------------------
+// run a job on a worker pool and call its done on the thread
+//  polling this server, where it can send the result.
+//
+// NOTE: all offloaded jobs must be done before the server is
+//  destroyed.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_tcp_server_offload(mnet_tcp_server_t* server, mnet_pool_t* pool, mnet_job_t* job);
+
+
+// ================================================
+//            RELIABLE UDP CHANNELS (HIGH LEVEL)
+//
+// message channels over one UDP socket, without TCP's
+//  head-of-line blocking between channels.
+//
+// every datagram carries a packet sequence number plus an ack of
+//  the latest received sequence and a 32 bit field of the ones
+//  before it (selective ack). reliable messages are resent when
+//  their packet is not acked within an RTT based timeout.
+//
+// one mnet_rudp_t per remote peer, any number of them can share
+//  a socket. the application receives datagrams itself and hands
+//  those of a peer to mnet_rudp_on_packet.
+//
+// NOTE: a message must fit in one datagram. (mtu - 13 bytes)
+//
+
+
+#define MNET_RUDP_MAX_CHANNELS      8
+#define MNET_RUDP_WINDOW            256
+#define MNET_RUDP_MAX_PACKET_MSGS   32
+#define MNET_RUDP_DEFAULT_MTU       1200
+#define MNET_RUDP_MAX_MTU           1472
+#define MNET_RUDP_PACKET_HEADER     8
+#define MNET_RUDP_MESSAGE_HEADER    5
+
+typedef enum mnet_channel_type
+{
+    mnet_channel_reliable_ordered       = 0,
+    // resent until acked, delivered exactly once and in send order.
+
+    mnet_channel_reliable_unordered     = 1,
+    // resent until acked, delivered exactly once as soon as it arrives.
+
+    mnet_channel_unreliable_sequenced   = 2
+    // sent once, messages older than the newest delivered are dropped.
+} mnet_channel_type_t;
+
+typedef struct mnet_rudp_msg
+{
+    struct mnet_rudp_msg*   next;
+    uint8_t                 channel;
+    uint16_t                id;
+    uint16_t                len;
+    uint8_t                 data[];
+} mnet_rudp_msg_t;
+
+typedef struct mnet_rudp_slot
+{
+    mnet_rudp_msg_t*        msg;
+    uint64_t                sent_ms;
+    uint8_t                 sends;
+} mnet_rudp_slot_t;
+
+typedef struct mnet_rudp_channel
+{
+    uint8_t                 type;
+    uint16_t                send_next;
+    uint16_t                send_oldest;
+    uint16_t                recv_next;
+    int                     has_recv;
+    mnet_rudp_slot_t*       send_window;
+    mnet_rudp_msg_t**       recv_window;    // ordered: out of order messages.
+    uint8_t*                recv_seen;      // unordered: delivered ids.
+    mnet_rudp_msg_t*        unreliable_head;
+    mnet_rudp_msg_t*        unreliable_tail;
+} mnet_rudp_channel_t;
+
+typedef struct mnet_rudp_sent_packet
+{
+    uint16_t                seq;
+    uint8_t                 valid;
+    uint8_t                 resent;
+    uint8_t                 count;
+    uint64_t                sent_ms;
+    uint8_t                 channels[MNET_RUDP_MAX_PACKET_MSGS];
+    uint16_t                ids[MNET_RUDP_MAX_PACKET_MSGS];
+} mnet_rudp_sent_packet_t;
+
+typedef struct mnet_rudp_stats
+{
+    uint64_t                packets_sent;
+    uint64_t                packets_received;
+    uint64_t                packets_acked;
+    uint64_t                resends;
+    double                  rtt_ms;     // smoothed round trip time.
+    double                  rto_ms;     // current resend timeout.
+} mnet_rudp_stats_t;
+
+typedef struct mnet_rudp
+{
+    mnet_socket_t               sock;
+    mnet_sockaddr_storage       addr;
+    mnet_socklen_t              addrlen;
+    uint16_t                    mtu;
+
+    mnet_rudp_channel_t         channels[MNET_RUDP_MAX_CHANNELS];
+    int                         channel_count;
+
+    uint16_t                    send_seq;
+    uint16_t                    remote_seq;
+    uint32_t                    remote_bits;
+    int                         has_remote;
+    int                         ack_pending;
+    mnet_rudp_sent_packet_t*    sent;
+
+    double                      rttvar_ms;
+    uint64_t                    last_recv_ms;
+    mnet_rudp_stats_t           stats;
+
+    mnet_rudp_msg_t*            delivery_head;
+    mnet_rudp_msg_t*            delivery_tail;
+} mnet_rudp_t;
+
+// ----------------------------------------------------------------
+// set up the channel state for one remote peer.
+//
+// peer: [out] peer to initialize.
+// sock: UDP socket to send on. (not owned)
+// addr: address of the remote peer.
+// addrlen: sizeof addr structure.
+// channels: type of every channel, the index is the channel id.
+// channel_count: number of channels. (max MNET_RUDP_MAX_CHANNELS)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_rudp_init(
+                mnet_rudp_t* peer,
+                mnet_socket_t sock,
+                const mnet_sockaddr_t* addr,
+                mnet_socklen_t addrlen,
+                const mnet_channel_type_t* channels,
+                int channel_count);
+
+// ----------------------------------------------------------------
+// free all queued and unacked messages of a peer.
+// ----------------------------------------------------------------
+void mnet_rudp_destroy(mnet_rudp_t* peer);
+
+// ----------------------------------------------------------------
+// set the largest datagram sent to this peer.
+//  (messages already queued are sent as they are)
+//
+// mtu: datagram size, 13 to MNET_RUDP_MAX_MTU bytes.
+//  (MNET_RUDP_DEFAULT_MTU after mnet_rudp_init)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if out of range.
+mnet_result_t mnet_rudp_set_mtu(mnet_rudp_t* peer, uint16_t mtu);
+
+// ----------------------------------------------------------------
+// queue a message, it goes out with the next mnet_rudp_update.
+//
+// channel: channel id.
+// data: message payload.
+// len: payload size. (at most mtu - 13 bytes, mtu is capped at
+//  MNET_RUDP_MAX_MTU)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if too large, or the
+//  reliable window is full (MNET_RUDP_WINDOW messages unacked).
+mnet_result_t mnet_rudp_send(
+                mnet_rudp_t* peer,
+                uint8_t channel,
+                const void* data,
+                size_t len);
+
+// ----------------------------------------------------------------
+// process a datagram received from this peer.
+//
+// now_ms: current time. (mnet_time_ms)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error if malformed.
+mnet_result_t mnet_rudp_on_packet(
+                mnet_rudp_t* peer,
+                const void* data,
+                size_t len,
+                uint64_t now_ms);
+
+// ----------------------------------------------------------------
+// send queued messages, resend timed out ones and send acks.
+//
+// now_ms: current time. (mnet_time_ms)
+// ----------------------------------------------------------------
+// returns: number of datagrams sent, or -1 on error.
+int mnet_rudp_update(mnet_rudp_t* peer, uint64_t now_ms);
+
+// ----------------------------------------------------------------
+// get the time until mnet_rudp_update has work to do.
+//  (usable as a loop timeout)
+// ----------------------------------------------------------------
+// returns: milliseconds, 0 for now, -1 if nothing is pending.
+int mnet_rudp_next_update(const mnet_rudp_t* peer, uint64_t now_ms);
+
+// ----------------------------------------------------------------
+// pop the next delivered message.
+//
+// channel: [out] channel it arrived on. (can be NULL)
+// buf: buffer to copy the message into.
+// len: size of buf.
+// ----------------------------------------------------------------
+// returns:
+//  ( > 0 )     message size.
+//  ( == 0 )    no message. (empty messages are delivered as 0 too,
+//              check mnet_rudp_pending)
+//  ( < 0 )     buf is too small, the message stays queued.
+int mnet_rudp_receive(
+                mnet_rudp_t* peer,
+                uint8_t* channel,
+                void* buf,
+                size_t len);
+
+// ----------------------------------------------------------------
+// check if mnet_rudp_receive has a message.
+// ----------------------------------------------------------------
+// returns: 1 if a message is waiting, 0 otherwise.
+int mnet_rudp_pending(const mnet_rudp_t* peer);
+
+
+// ================================================
+//            TCP REACTOR (MULTI-THREADED)
+//
+// runs one mnet_tcp_server per worker thread. every worker owns
+//  its own listening socket bound with SO_REUSEPORT, its own loop
+//  and connections, so the kernel load balances new connections
+//  and no state is shared between the workers.
+//
+// with mnet_reactor_steer_cpu a connection is handed to the worker
+//  pinned to the CPU that received it (SO_ATTACH_REUSEPORT_CBPF,
+//  SO_INCOMING_CPU), so a flow stays on one core end to end.
+//  this needs exactly one worker per CPU, with any other thread
+//  count steering is left off and the kernel hashes flows instead.
+//
+// callbacks run on the worker threads, the server passed to them
+//  is the worker's shard and must only be used from that thread.
+//
+// NOTE: needs SO_REUSEPORT for more than one worker. (not windows)
+//
+
+
+typedef enum mnet_reactor_flags
+{
+    mnet_reactor_pin_cpu    = 0x01,
+    // pin worker N to CPU N. (modulo mnet_cpu_count)
+
+    mnet_reactor_steer_cpu  = 0x02
+    // deliver connections to the worker of the receiving CPU. (linux)
+    //  implies mnet_reactor_pin_cpu. ignored unless there is one
+    //  worker per CPU, the flag is cleared in reactor->flags then.
+} mnet_reactor_flags_t;
+
+typedef struct mnet_tcp_reactor mnet_tcp_reactor_t;
+
+typedef struct mnet_tcp_reactor_worker
+{
+    mnet_tcp_server_t       server;
+    mnet_thread_t           thread;
+    mnet_tcp_reactor_t*     reactor;
+    int                     cpu;        // -1 if not pinned.
+    int                     started;
+} mnet_tcp_reactor_worker_t;
+
+struct mnet_tcp_reactor
+{
+    mnet_tcp_reactor_worker_t*  workers;
+    int                         count;
+    uint32_t                    flags;
+    volatile int                running;
+};
+
+// ----------------------------------------------------------------
+// create the listening sockets and loops of all workers.
+//
+// reactor: [out] reactor to initialize.
+// addr: address to listen on.
+// addrlen: sizeof addr structure.
+// callbacks: connection callbacks, called on the worker threads.
+// user: user pointer passed to all callbacks.
+// threads: number of workers. (0 = one per CPU)
+// flags: mnet_reactor_flags_t.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_tcp_reactor_init(
+                mnet_tcp_reactor_t* reactor,
+                const mnet_sockaddr_t* addr,
+                mnet_socklen_t addrlen,
+                const mnet_tcp_callbacks_t* callbacks,
+                void* user,
+                int threads,
+                uint32_t flags);
+
+// ----------------------------------------------------------------
+// start the worker threads.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+//  (workers that did start are stopped again)
+mnet_result_t mnet_tcp_reactor_start(mnet_tcp_reactor_t* reactor);
+
+// ----------------------------------------------------------------
+// stop and join the worker threads.
+// ----------------------------------------------------------------
+void mnet_tcp_reactor_stop(mnet_tcp_reactor_t* reactor);
+
+// ----------------------------------------------------------------
+// stop the workers and close all connections and listeners.
+// ----------------------------------------------------------------
+void mnet_tcp_reactor_destroy(mnet_tcp_reactor_t* reactor);
+
+// ----------------------------------------------------------------
+// get the server shard of a worker.
+//
+// NOTE: only safe to use from that worker, or while stopped.
+// ----------------------------------------------------------------
+// returns: server, or NULL if index is out of range.
+mnet_tcp_server_t* mnet_tcp_reactor_server(mnet_tcp_reactor_t* reactor, int index);
+
+
+// ================================================
+//            ASYNC DNS RESOLVER
+//
+// non-blocking replacement for mnet_getaddrinfo. queries are sent
+//  over UDP from the resolver's own socket, which is registered in
+//  the caller's loop, so a slow lookup never blocks the thread.
+//
+// names are looked up in order: IP literal, hosts file, cache,
+//  then the nameservers from resolv.conf. (retried and rotated
+//  with the timeout and attempts options given there)
+//
+// answers are cached for their TTL in a mnet_dns_cache_t, which
+//  is thread-safe and can be shared by the resolvers of several
+//  loop threads. failed lookups are cached for a short while too.
+//
+// NOTE: a resolver must only be used by one thread.
+// NOTE: only nameservers of the first listed address family are used.
+//
+
+
+#ifndef MNET_RESOLV_CONF_PATH
+#   define MNET_RESOLV_CONF_PATH    "/etc/resolv.conf"
+#endif
+
+#ifndef MNET_HOSTS_PATH
+#   ifdef MNET_WINDOWS
+#       define MNET_HOSTS_PATH      "C:\\Windows\\System32\\drivers\\etc\\hosts"
+#   else
+#       define MNET_HOSTS_PATH      "/etc/hosts"
+#   endif
+#endif
+
+#define MNET_DNS_MAX_NAME           253
+#define MNET_DNS_MAX_ADDRS          8
+#define MNET_DNS_MAX_SERVERS        3
+#define MNET_DNS_CACHE_BUCKETS      1024
+#define MNET_DNS_CACHE_MAX          8192
+#define MNET_DNS_NEGATIVE_TTL       30
+
+typedef enum mnet_dns_family
+{
+    mnet_dns_ipv4   = 0x01,     // A records.
+    mnet_dns_ipv6   = 0x02,     // AAAA records.
+    mnet_dns_any    = 0x03      // both, ipv4 addresses first.
+} mnet_dns_family_t;
+
+typedef enum mnet_dns_status
+{
+    mnet_dns_ok         = 0,
+    mnet_dns_not_found  = 1,    // name does not exist, or has no addresses.
+    mnet_dns_timeout    = 2,    // no nameserver answered.
+    mnet_dns_failed     = 3     // bad name, server failure or no memory.
+} mnet_dns_status_t;
+
+typedef struct mnet_dns_result
+{
+    mnet_dns_status_t       status;
+    int                     count;
+    uint32_t                ttl;        // seconds left in the cache.
+    mnet_sockaddr_storage   addrs[MNET_DNS_MAX_ADDRS];
+    mnet_socklen_t          addrlens[MNET_DNS_MAX_ADDRS];
+} mnet_dns_result_t;
+
+typedef struct mnet_dns_cache_entry
+{
+    struct mnet_dns_cache_entry*    next;
+    uint64_t                        expires_ms;
+    uint8_t                         family;
+    uint8_t                         status;
+    uint8_t                         count;
+    uint8_t                         ipv6[MNET_DNS_MAX_ADDRS];
+    uint8_t                         addrs[MNET_DNS_MAX_ADDRS][16];
+    char                            name[MNET_DNS_MAX_NAME + 1];
+} mnet_dns_cache_entry_t;
+
+typedef struct mnet_dns_cache
+{
+    mnet_dns_cache_entry_t*     buckets[MNET_DNS_CACHE_BUCKETS];
+    size_t                      count;
+    volatile int                lock;
+} mnet_dns_cache_t;
+
+typedef struct mnet_resolver mnet_resolver_t;
+
+typedef void (*mnet_dns_callback_t)(
+                mnet_resolver_t* resolver,
+                const char* name,
+                const mnet_dns_result_t* result,
+                void* udata);
+
+typedef struct mnet_dns_request mnet_dns_request_t;
+
+typedef struct mnet_dns_host
+{
+    char*       name;
+    uint8_t     ipv6;
+    uint8_t     addr[16];
+} mnet_dns_host_t;
+
+struct mnet_resolver
+{
+    mnet_socket_t           sock;
+    mnet_sockaddr_storage   servers[MNET_DNS_MAX_SERVERS];
+    mnet_socklen_t          server_lens[MNET_DNS_MAX_SERVERS];
+    int                     server_count;
+    int                     timeout_ms;     // per attempt.
+    int                     attempts;
+
+    mnet_dns_host_t*        hosts;
+    int                     host_count;
+
+    mnet_dns_cache_t*       cache;
+    int                     owns_cache;
+
+    mnet_dns_request_t*     requests;
+    uint32_t                rng;
+};
+
+// ----------------------------------------------------------------
+// set up an empty cache.
+// ----------------------------------------------------------------
+void mnet_dns_cache_init(mnet_dns_cache_t* cache);
+
+// ----------------------------------------------------------------
+// free all cached entries.
+// ----------------------------------------------------------------
+void mnet_dns_cache_destroy(mnet_dns_cache_t* cache);
+
+// ----------------------------------------------------------------
+// create a resolver from the system configuration.
+//  (MNET_RESOLV_CONF_PATH and MNET_HOSTS_PATH, missing files are
+//  fine, the nameserver then defaults to 127.0.0.1)
+//
+// resolver: [out] resolver to initialize.
+// cache: shared cache. (NULL = private cache)
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_resolver_init(mnet_resolver_t* resolver, mnet_dns_cache_t* cache);
+
+// ----------------------------------------------------------------
+// destroy a resolver.
+//
+// NOTE: pending lookups are dropped without calling their callback.
+//  remove mnet_resolver_socket from the loop first.
+// ----------------------------------------------------------------
+void mnet_resolver_destroy(mnet_resolver_t* resolver);
+
+// ----------------------------------------------------------------
+// replace the nameservers from resolv.conf with a single one.
+//
+// addr: nameserver address. (port included, usually 53)
+// addrlen: sizeof addr structure.
+// ----------------------------------------------------------------
+// returns: mnet_ok on success, mnet_error on failure.
+mnet_result_t mnet_resolver_set_nameserver(
+                mnet_resolver_t* resolver,
+                const mnet_sockaddr_t* addr,
+                mnet_socklen_t addrlen);
+
+// ----------------------------------------------------------------
+// start a lookup.
+//
+// name: host name or IP literal.
+// port: port set in every result address. (host byte order)
+// family: mnet_dns_family_t.
+// callback: called once with the result, always from
+//  mnet_resolver_process. (answers from a literal, the hosts file
+//  or the cache are delivered by the next call, mnet_resolver_timeout
+//  returns 0 while one is waiting)
+// udata: passed to callback.
+// ----------------------------------------------------------------
+// returns: mnet_ok if the lookup started (or finished),
+//  mnet_error on failure. (callback is not called)
+mnet_result_t mnet_resolver_resolve(
+                mnet_resolver_t* resolver,
+                const char* name,
+                uint16_t port,
+                mnet_dns_family_t family,
+                mnet_dns_callback_t callback,
+                void* udata);
+
+// ----------------------------------------------------------------
+// get the socket to register for mnet_loop_in.
+// ----------------------------------------------------------------
+// returns: socket, MNET_INVALID_SOCKET on error.
+mnet_socket_t mnet_resolver_socket(const mnet_resolver_t* resolver);
+
+// ----------------------------------------------------------------
+// read answers, resend timed out queries and call the callbacks
+//  of finished lookups. call when the socket is readable and when
+//  mnet_resolver_timeout expires.
+//
+// now_ms: current time. (mnet_time_ms)
+// ----------------------------------------------------------------
+// returns: number of lookups finished.
+int mnet_resolver_process(mnet_resolver_t* resolver, uint64_t now_ms);
+
+// ----------------------------------------------------------------
+// get the time until mnet_resolver_process has to resend.
+// ----------------------------------------------------------------
+// returns: milliseconds, 0 for now, -1 if no lookup is pending.
+int mnet_resolver_timeout(const mnet_resolver_t* resolver, uint64_t now_ms);
+
+// ================================================
+//            INLINE WRAPPERS
+//
+// bodies of the MNET_INLINE_API functions. compiled once into the
+//  library, or into every file including mnet.h with MNET_INLINE.
+//
+
+#if defined(MNET_INLINE) || defined(MNET_SOURCE)
+
+MNET_INLINE_API uint16_t mnet_htons(uint16_t hostshort)
+{
+    return htons(hostshort);
+}
+
+MNET_INLINE_API uint16_t mnet_ntohs(uint16_t netshort)
+{
+    return ntohs(netshort);
+}
+
+MNET_INLINE_API uint32_t mnet_htonl(uint32_t hostlong)
+{
+    return htonl(hostlong);
+}
+
+MNET_INLINE_API uint32_t mnet_ntohl(uint32_t netlong)
+{
+    return ntohl(netlong);
+}
+
+MNET_INLINE_API mnet_result_t mnet_socket_is_valid(mnet_socket_t sock)
+{
+    return sock != MNET_INVALID_SOCKET;
+}
+
+MNET_INLINE_API void mnet_iovec_init(mnet_iovec_t* iov, void* base, size_t len)
+{
+    if (!iov) return;
+
+#ifdef MNET_WINDOWS
+    iov->buf = (char*)base;
+    iov->len = (ULONG)len;
+#elif defined(MNET_UNIX)
+    iov->iov_base = base;
+    iov->iov_len = len;
+#endif
+}
+
+MNET_INLINE_API void** mnet_iovec_base(
+    const mnet_iovec_t* iov)
+{
+#ifdef MNET_WINDOWS
+    return (void**)(&iov->buf);
+#elif defined(MNET_UNIX)
+    return (void**)(&iov->iov_base);
+#endif
+}
+
+MNET_INLINE_API void* mnet_iovec_get_base(
+    const mnet_iovec_t iov)
+{
+#ifdef MNET_WINDOWS
+    return (void*)iov.buf;
+#elif defined(MNET_UNIX)
+    return iov.iov_base;
+#endif
+}
+
+MNET_INLINE_API void mnet_iovec_set_base(
+    mnet_iovec_t* iov,
+    void* base)
+{
+#ifdef MNET_WINDOWS
+    iov->buf = (char*)base;
+#elif defined(MNET_UNIX)
+    iov->iov_base = base;
+#endif
+}
+
+MNET_INLINE_API size_t mnet_iovec_get_len(
+    const mnet_iovec_t iov)
+{
+#ifdef MNET_WINDOWS
+    return (size_t)iov.len;
+#elif defined(MNET_UNIX)
+    return iov.iov_len;
+#endif
+}
+
+MNET_INLINE_API void mnet_iovec_set_len(mnet_iovec_t* iov, size_t len)
+{
+#ifdef MNET_WINDOWS
+    iov->len = (u_long)len;
+#elif defined(MNET_UNIX)
+    iov->iov_len = len;
+#endif
+}
+
+MNET_INLINE_API int mnet_pollfd_has_event(const mnet_pollfd_t* pfd, short event)
+{
+    if (!pfd) return 0;
+    return (pfd->revents & event) != 0;
+}
+
+MNET_INLINE_API uint16_t mnet_addr_get_port(const mnet_sockaddr_t* addr)
+{
+    if (!addr) return 0;
+
+    if (addr->sa_family == AF_INET)
+    {
+        const mnet_sockaddr_in_t* addr_in = (const mnet_sockaddr_in_t*)addr;
+        return mnet_ntohs(addr_in->sin_port);
+    }
+    else if (addr->sa_family == AF_INET6)
+    {
+        const mnet_sockaddr_in6_t* addr_in6 = (const mnet_sockaddr_in6_t*)addr;
+        return mnet_ntohs(addr_in6->sin6_port);
+    }
+
+    return 0;
+}
+
+#endif
+
+
+#endif//MNET_MNET_H
+
+///////////////////////////////////////
+//              SOURCE
+///////////////////////////////////////
+#ifdef MNET_SOURCE
+
+
+// hooks of the data transfer wrappers, see INSTRUMENTATION.
+#ifdef MNET_STATS
+    static void mnet_stats_record(mnet_op_t op, mnet_socket_t sock, int result, uint64_t start_ns);
+    static void mnet_stats_socket_reset(mnet_socket_t sock);
+#   define MNET_STATS_BEGIN()               const uint64_t mnet_stats_start = mnet_time_ns()
+#   define MNET_STATS_END(op, sock, result) mnet_stats_record(op, sock, result, mnet_stats_start)
+#   define MNET_STATS_RESET(sock)           mnet_stats_socket_reset(sock)
+#else
+#   define MNET_STATS_BEGIN()               ((void)0)
+#   define MNET_STATS_END(op, sock, result) ((void)0)
+#   define MNET_STATS_RESET(sock)           ((void)0)
+#endif
+
+
+// ================================================
+// INITIALIZATION & CLEANUP
+//
+
+
+mnet_result_t mnet_initialize(void)
+{
+#ifdef MNET_WINDOWS
+
+    WSADATA wsa_data;
+    return WSAStartup(MAKEWORD(2, 2), &wsa_data);
+
+#elif defined(MNET_UNIX)
+
+    return mnet_ok;
+
+#endif
+}
+
+mnet_result_t mnet_cleanup(void)
+{
+#ifdef MNET_WINDOWS
+    WSACleanup();
+#endif
+    return mnet_ok;
+}
+
+
+// ================================================
+//       CORE SOCKET CREATION AND MANAGEMENT
+//
+
+
+mnet_socket_t mnet_socket(
+    const mnet_address_family_t domain,
+    const mnet_socket_type_t    type,
+    const mnet_protocol_t       protocol)
+{
+    const mnet_socket_t sock = socket((int)domain, (int)type, (int)protocol);
+    MNET_STATS_RESET(sock);
+    return sock;
+}
+
+mnet_result_t mnet_close(mnet_socket_t sock)
+{
+    MNET_STATS_RESET(sock);
+#ifdef MNET_WINDOWS
+    return closesocket(sock);
+#elif defined(MNET_UNIX)
+    return close(sock);
+#endif
+}
+
+
+
+// ================================================
+//         CONNECTION MANAGEMENT (TCP)
+//
+
+
+mnet_result_t mnet_bind(mnet_socket_t sock, const mnet_sockaddr_t* addr, mnet_socklen_t addrlen)
+{
+    return bind(sock, addr, addrlen);
+}
+
+mnet_result_t mnet_listen(mnet_socket_t sock, int backlog)
+{
+    return listen(sock, backlog);
+}
+
+mnet_socket_t mnet_accept(mnet_socket_t sock, struct sockaddr *addr, mnet_socklen_t *addrlen)
+{
+    const mnet_socket_t conn = accept(sock, addr, addrlen);
+    MNET_STATS_RESET(conn);
+    return conn;
+}
+
+mnet_result_t mnet_connect(mnet_socket_t sock, const struct sockaddr *addr, mnet_socklen_t addrlen)
+{
+    return connect(sock, addr, addrlen);
+}
+
+mnet_result_t mnet_shutdown(mnet_socket_t sock, mnet_shutdown_code_t how)
+{
+    return shutdown(sock, (int)how);
+}
+
+
+// ================================================
+//               DATA TRANSFER (TCP)
+//
+
+
+// largest transfer per call, the byte count has to fit the int result.
+#define MNET_IO_MAX ((size_t)0x7FFFFFFF)
+
+// trims an iovec array to MNET_IO_MAX bytes, returns the count to use.
+//  a single buffer that is too large is sent from a clamped copy.
+static int mnet_iov_clamp(const mnet_iovec_t** iov, int iovcnt, mnet_iovec_t* clamped)
+{
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++)
+    {
+        const size_t len = mnet_iovec_get_len((*iov)[i]);
+        if (len <= MNET_IO_MAX - total)
+        {
+            total += len;
+            continue;
+        }
+
+        if (total > 0) return i;
+
+        *clamped = (*iov)[i];
+        mnet_iovec_set_len(clamped, MNET_IO_MAX);
+        *iov = clamped;
+        return 1;
+    }
+    return iovcnt;
+}
+
+int mnet_send(mnet_socket_t sock, const void *buf, size_t len, mnet_msg_flags_t flags)
+{
+    if (len > MNET_IO_MAX) len = MNET_IO_MAX;
+    MNET_STATS_BEGIN();
+#ifdef MNET_WINDOWS
+    const int result = send(sock, (const char*)buf, (int)len, (int)flags);
+#elif defined(MNET_UNIX)
+    const int result = (int)send(sock, buf, len, (int)flags);
+#endif
+    MNET_STATS_END(mnet_op_send, sock, result);
+    return result;
+}
+
+int mnet_recv(mnet_socket_t sock, void *buf, size_t len, mnet_msg_flags_t flags)
+{
+    if (len > MNET_IO_MAX) len = MNET_IO_MAX;
+    MNET_STATS_BEGIN();
+#ifdef MNET_WINDOWS
+    const int result = recv(sock, (char*)buf, (int)len, (int)flags);
+#elif defined(MNET_UNIX)
+    const int result = (int)recv(sock, buf, len, (int)flags);
+#endif
+    MNET_STATS_END(mnet_op_recv, sock, result);
+    return result;
+}
+
+int mnet_sendv(mnet_socket_t sock, const mnet_iovec_t* iov, int iovcnt, mnet_msg_flags_t flags)
+{
+    if (!iov || iovcnt <= 0) return -1;
+
+    mnet_iovec_t clamped;
+    iovcnt = mnet_iov_clamp(&iov, iovcnt, &clamped);
+    MNET_STATS_BEGIN();
+
+#ifdef MNET_WINDOWS
+
+    DWORD sent = 0;
+    const int result = WSASend(sock, (LPWSABUF)iov, (DWORD)iovcnt, &sent, (DWORD)flags, NULL, NULL) == 0 ? (int)sent : -1;
+
+#elif defined(MNET_UNIX)
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec*)iov;
+    msg.msg_iovlen = (size_t)iovcnt;
+
+    const int result = (int)sendmsg(sock, &msg, (int)flags);
+
+#endif
+
+    MNET_STATS_END(mnet_op_sendv, sock, result);
+    return result;
+}
+
+int mnet_recvv(mnet_socket_t sock, mnet_iovec_t* iov, int iovcnt, mnet_msg_flags_t flags)
+{
+    if (!iov || iovcnt <= 0) return -1;
+
+    mnet_iovec_t clamped;
+    const mnet_iovec_t* bufs = iov;
+    iovcnt = mnet_iov_clamp(&bufs, iovcnt, &clamped);
+    iov = (mnet_iovec_t*)bufs;
+    MNET_STATS_BEGIN();
+
+#ifdef MNET_WINDOWS
+
+    DWORD received = 0;
+    DWORD flags_dword = (DWORD)flags;
+    const int result = WSARecv(sock, (LPWSABUF)iov, (DWORD)iovcnt, &received, &flags_dword, NULL, NULL) == 0 ? (int)received : -1;
+
+#elif defined(MNET_UNIX)
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec*)iov;
+    msg.msg_iovlen = (size_t)iovcnt;
+
+    const int result = (int)recvmsg(sock, &msg, (int)flags);
+
+#endif
+
+    MNET_STATS_END(mnet_op_recvv, sock, result);
+    return result;
+}
+
+
+// ================================================
+//                DATA TRANSFER (UDP)
+//
+
+
+int mnet_sendto(mnet_socket_t sock, const void* buf, size_t len, mnet_msg_flags_t flags,
+                const mnet_sockaddr_t* dest_addr, mnet_socklen_t addrlen)
+{
+    MNET_STATS_BEGIN();
+#ifdef MNET_WINDOWS
+    const int result = sendto(sock, (const char*)buf, (int)len, (int)flags, dest_addr, addrlen);
+#elif defined(MNET_UNIX)
+    const int result = (int)sendto(sock, buf, len, (int)flags, dest_addr, addrlen);
+#endif
+    MNET_STATS_END(mnet_op_sendto, sock, result);
+    return result;
+}
+
+int mnet_recvfrom(mnet_socket_t sock, void* buf, size_t len, mnet_msg_flags_t flags,
+                  mnet_sockaddr_t* src_addr, mnet_socklen_t* addrlen)
+{
+    MNET_STATS_BEGIN();
+#ifdef MNET_WINDOWS
+    const int result = recvfrom(sock, (char*)buf, (int)len, (int)flags, src_addr, addrlen);
+#elif defined(MNET_UNIX)
+    const int result = (int)recvfrom(sock, buf, len, (int)flags, src_addr, addrlen);
+#endif
+    MNET_STATS_END(mnet_op_recvfrom, sock, result);
+    return result;
+}
+
+#ifdef MNET_LINUX
+
+static void mnet_mmsg_to_hdr(mnet_mmsg_t* msg, struct mmsghdr* hdr, struct iovec* iov)
+{
+    iov->iov_base = msg->buf;
+    iov->iov_len = msg->len;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->msg_hdr.msg_iov = iov;
+    hdr->msg_hdr.msg_iovlen = 1;
+    hdr->msg_hdr.msg_name = msg->addr;
+    hdr->msg_hdr.msg_namelen = msg->addr ? msg->addrlen : 0;
+}
+
+int mnet_sendmmsg(mnet_socket_t sock, mnet_mmsg_t* msgs, int count, mnet_msg_flags_t flags)
+{
+    if (!msgs || count <= 0) return -1;
+
+    struct mmsghdr hdrs[MNET_MMSG_BATCH];
+    struct iovec iovs[MNET_MMSG_BATCH];
+    int total = 0;
+
+    while (total < count)
+    {
+        const int batch = count - total < MNET_MMSG_BATCH ? count - total : MNET_MMSG_BATCH;
+        for (int i = 0; i < batch; i++)
+            mnet_mmsg_to_hdr(&msgs[total + i], &hdrs[i], &iovs[i]);
+
+        const int sent = sendmmsg(sock, hdrs, (unsigned int)batch, (int)flags);
+        if (sent < 0) return total > 0 ? total : -1;
+
+        for (int i = 0; i < sent; i++)
+            msgs[total + i].bytes = (int)hdrs[i].msg_len;
+
+        total += sent;
+        if (sent < batch) break;
+    }
+
+    return total;
+}
+
+int mnet_recvmmsg(mnet_socket_t sock, mnet_mmsg_t* msgs, int count, mnet_msg_flags_t flags)
+{
+    if (!msgs || count <= 0) return -1;
+
+    struct mmsghdr hdrs[MNET_MMSG_BATCH];
+    struct iovec iovs[MNET_MMSG_BATCH];
+    int total = 0;
+
+    while (total < count)
+    {
+        const int batch = count - total < MNET_MMSG_BATCH ? count - total : MNET_MMSG_BATCH;
+        for (int i = 0; i < batch; i++)
+            mnet_mmsg_to_hdr(&msgs[total + i], &hdrs[i], &iovs[i]);
+
+        // block for the first datagram at most, then only drain.
+        const int call_flags = (int)flags | (total == 0 ? MSG_WAITFORONE : MSG_DONTWAIT);
+
+        const int received = recvmmsg(sock, hdrs, (unsigned int)batch, call_flags, NULL);
+        if (received < 0) return total > 0 ? total : -1;
+
+        for (int i = 0; i < received; i++)
+        {
+            msgs[total + i].bytes = (int)hdrs[i].msg_len;
+            msgs[total + i].addrlen = hdrs[i].msg_hdr.msg_namelen;
+        }
+
+        total += received;
+        if (received < batch) break;
+    }
+
+    return total;
+}
+
+#else
+
+int mnet_sendmmsg(mnet_socket_t sock, mnet_mmsg_t* msgs, int count, mnet_msg_flags_t flags)
+{
+    if (!msgs || count <= 0) return -1;
+
+    for (int i = 0; i < count; i++)
+    {
+        const int sent = mnet_sendto(sock, msgs[i].buf, msgs[i].len, flags,
+                                     msgs[i].addr, msgs[i].addrlen);
+        if (sent < 0) return i > 0 ? i : -1;
+        msgs[i].bytes = sent;
+    }
+
+    return count;
+}
+
+int mnet_recvmmsg(mnet_socket_t sock, mnet_mmsg_t* msgs, int count, mnet_msg_flags_t flags)
+{
+    if (!msgs || count <= 0) return -1;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            // only drain what is already queued.
+            mnet_pollfd_t pfd;
+            pfd.fd = sock;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (mnet_poll(&pfd, 1, 0) <= 0) return i;
+        }
+
+        const int received = mnet_recvfrom(sock, msgs[i].buf, msgs[i].len, flags,
+                                           msgs[i].addr, msgs[i].addr ? &msgs[i].addrlen : NULL);
+        if (received < 0) return i > 0 ? i : -1;
+        msgs[i].bytes = received;
+    }
+
+    return count;
+}
+
+#endif
+
+// largest UDP payload that fits one IPv4 packet.
+#define MNET_GSO_MAX_BYTES      65507
+#define MNET_GSO_MAX_SEGMENTS   64
+
+static int mnet_sendto_segments(mnet_socket_t sock, const uint8_t* data, size_t len, uint16_t segment_size,
+                                mnet_msg_flags_t flags, const mnet_sockaddr_t* dest_addr, mnet_socklen_t addrlen)
+{
+    mnet_mmsg_t msgs[MNET_MMSG_BATCH];
+    size_t offset = 0;
+
+    while (offset < len)
+    {
+        int count = 0;
+        while (count < MNET_MMSG_BATCH && offset < len)
+        {
+            const size_t chunk = len - offset < segment_size ? len - offset : segment_size;
+            msgs[count].buf = (void*)(data + offset);
+            msgs[count].len = chunk;
+            msgs[count].addr = (mnet_sockaddr_t*)dest_addr;
+            msgs[count].addrlen = addrlen;
+            msgs[count].bytes = 0;
+            offset += chunk;
+            count++;
+        }
+
+        const int sent = mnet_sendmmsg(sock, msgs, count, flags);
+        if (sent < count)
+        {
+            size_t done = offset;
+            for (int i = (sent < 0 ? 0 : sent); i < count; i++) done -= msgs[i].len;
+            return done > 0 ? (int)done : -1;
+        }
+    }
+
+    return (int)len;
+}
+
+#ifdef MNET_LINUX
+
+#ifndef UDP_SEGMENT
+#   define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#   define UDP_GRO 104
+#endif
+
+static int mnet_gso_unsupported = 0;
+
+static int mnet_gso_send_once(mnet_socket_t sock, const void* buf, size_t len, uint16_t segment_size,
+                              mnet_msg_flags_t flags, const mnet_sockaddr_t* dest_addr, mnet_socklen_t addrlen)
+{
+    struct iovec iov;
+    iov.iov_base = (void*)buf;
+    iov.iov_len = len;
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = (void*)dest_addr;
+    msg.msg_namelen = addrlen;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+
+    return (int)sendmsg(sock, &msg, (int)flags);
+}
+
+int mnet_sendto_gso(mnet_socket_t sock, const void* buf, size_t len, uint16_t segment_size,
+                    mnet_msg_flags_t flags, const mnet_sockaddr_t* dest_addr, mnet_socklen_t addrlen)
+{
+    if (!buf || segment_size == 0) return -1;
+
+    const uint8_t* data = (const uint8_t*)buf;
+    if (len <= segment_size || __atomic_load_n(&mnet_gso_unsupported, __ATOMIC_RELAXED))
+        return mnet_sendto_segments(sock, data, len, segment_size, flags, dest_addr, addrlen);
+
+    size_t segments_per_call = MNET_GSO_MAX_BYTES / segment_size;
+    if (segments_per_call > MNET_GSO_MAX_SEGMENTS) segments_per_call = MNET_GSO_MAX_SEGMENTS;
+    if (segments_per_call < 2)
+        return mnet_sendto_segments(sock, data, len, segment_size, flags, dest_addr, addrlen);
+
+    const size_t max_chunk = segments_per_call * segment_size;
+    size_t offset = 0;
+
+    while (offset < len)
+    {
+        const size_t chunk = len - offset < max_chunk ? len - offset : max_chunk;
+
+        const int sent = mnet_gso_send_once(sock, data + offset, chunk, segment_size,
+                                            flags, dest_addr, addrlen);
+        if (sent < 0)
+        {
+            // only a kernel without UDP GSO turns it off for good. EINVAL
+            //  (segment above this path's MTU) and EIO (device without
+            //  checksum offload) depend on the destination, so only this
+            //  call falls back.
+            const int err = errno;
+            if (err == EINVAL || err == ENOPROTOOPT || err == EOPNOTSUPP || err == EIO)
+            {
+                if (err == ENOPROTOOPT || err == EOPNOTSUPP)
+                    __atomic_store_n(&mnet_gso_unsupported, 1, __ATOMIC_RELAXED);
+                const int rest = mnet_sendto_segments(sock, data + offset, len - offset, segment_size,
+                                                      flags, dest_addr, addrlen);
+                if (rest < 0) return offset > 0 ? (int)offset : -1;
+                return (int)(offset + (size_t)rest);
+            }
+
+            return offset > 0 ? (int)offset : -1;
+        }
+
+        offset += (size_t)sent;
+    }
+
+    return (int)len;
+}
+
+mnet_result_t mnet_set_udp_gro(mnet_socket_t sock, int enable)
+{
+    int optval = enable ? 1 : 0;
+    return setsockopt(sock, IPPROTO_UDP, UDP_GRO, &optval, sizeof(optval)) == 0 ? mnet_ok : mnet_error;
+}
+
+int mnet_recvfrom_gro(mnet_socket_t sock, void* buf, size_t len, mnet_msg_flags_t flags,
+                      mnet_sockaddr_t* src_addr, mnet_socklen_t* addrlen, uint16_t* segment_size)
+{
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = len;
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = src_addr;
+    msg.msg_namelen = (src_addr && addrlen) ? *addrlen : 0;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    const int received = (int)recvmsg(sock, &msg, (int)flags);
+    if (received < 0) return -1;
+
+    if (addrlen) *addrlen = msg.msg_namelen;
+
+    if (segment_size)
+    {
+        *segment_size = (uint16_t)received;
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                int gso_size = 0;
+                memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                if (gso_size > 0 && gso_size < received) *segment_size = (uint16_t)gso_size;
+            }
+        }
+    }
+
+    return received;
+}
+
+#else
+
+int mnet_sendto_gso(mnet_socket_t sock, const void* buf, size_t len, uint16_t segment_size,
+                    mnet_msg_flags_t flags, const mnet_sockaddr_t* dest_addr, mnet_socklen_t addrlen)
+{
+    if (!buf || segment_size == 0) return -1;
+    return mnet_sendto_segments(sock, (const uint8_t*)buf, len, segment_size, flags, dest_addr, addrlen);
+}
+
+mnet_result_t mnet_set_udp_gro(mnet_socket_t sock, int enable)
+{
+    (void)sock;
+    (void)enable;
+    return mnet_error;
+}
+
+int mnet_recvfrom_gro(mnet_socket_t sock, void* buf, size_t len, mnet_msg_flags_t flags,
+                      mnet_sockaddr_t* src_addr, mnet_socklen_t* addrlen, uint16_t* segment_size)
+{
+    const int received = mnet_recvfrom(sock, buf, len, flags, src_addr, addrlen);
+    if (received >= 0 && segment_size) *segment_size = (uint16_t)received;
+    return received;
+}
+
+#endif
+
+int mnet_gro_split(void* buf, int bytes, uint16_t segment_size, mnet_iovec_t* out, int max_out)
+{
+    if (!buf || !out || bytes <= 0 || max_out <= 0) return 0;
+
+    const size_t total = (size_t)bytes;
+    const size_t step = segment_size ? segment_size : total;
+    size_t offset = 0;
+    int count = 0;
+
+    while (offset < total && count < max_out)
+    {
+        const size_t chunk = total - offset < step ? total - offset : step;
+        mnet_iovec_init(&out[count++], (uint8_t*)buf + offset, chunk);
+        offset += chunk;
+    }
+
+    return count;
+}
+
+
+// ================================================
+//                 ZERO-COPY SEND
+//
+
+
+#ifdef MNET_LINUX
+#   ifndef SO_ZEROCOPY
+#       define SO_ZEROCOPY 60
+#   endif
+#   ifndef MSG_ZEROCOPY
+#       define MSG_ZEROCOPY 0x4000000
+#   endif
+#endif
+
+mnet_result_t mnet_zerocopy_init(mnet_zerocopy_t* zc, mnet_socket_t sock)
+{
+    if (!zc || sock == MNET_INVALID_SOCKET) return mnet_error;
+    memset(zc, 0, sizeof(*zc));
+    zc->sock = sock;
+
+#ifdef MNET_LINUX
+    // tx timestamps would be mixed into the completions.
+    unsigned int timestamping = 0;
+    socklen_t timestamping_len = sizeof(timestamping);
+    if (getsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, &timestamping_len) == 0
+     && (timestamping & (SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_HARDWARE)))
+        return mnet_ok;
+
+    int optval = 1;
+    zc->enabled = setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) == 0;
+#endif
+
+    return mnet_ok;
+}
+
+static int mnet_zerocopy_sent(mnet_zerocopy_t* zc, int sent, uint32_t* id)
+{
+    // only sends that went through take an id, the kernel
+    //  does not count empty ones.
+    if (sent > 0)
+    {
+        if (id) *id = zc->next_id;
+        zc->next_id++;
+    }
+    return sent;
+}
+
+int mnet_zerocopy_send(mnet_zerocopy_t* zc, const void* buf, size_t len, mnet_msg_flags_t flags, uint32_t* id)
+{
+    if (!zc) return -1;
+
+#ifdef MNET_LINUX
+    if (zc->enabled)
+        return mnet_zerocopy_sent(zc, (int)send(zc->sock, buf, len, (int)flags | MSG_ZEROCOPY), id);
+#endif
+
+    return mnet_zerocopy_sent(zc, mnet_send(zc->sock, buf, len, flags), id);
+}
+
+int mnet_zerocopy_sendv(mnet_zerocopy_t* zc, const mnet_iovec_t* iov, int iovcnt, mnet_msg_flags_t flags, uint32_t* id)
+{
+    if (!zc) return -1;
+
+#ifdef MNET_LINUX
+    if (zc->enabled)
+    {
+        if (!iov || iovcnt <= 0) return -1;
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = (struct iovec*)iov;
+        msg.msg_iovlen = (size_t)iovcnt;
+
+        return mnet_zerocopy_sent(zc, (int)sendmsg(zc->sock, &msg, (int)flags | MSG_ZEROCOPY), id);
+    }
+#endif
+
+    return mnet_zerocopy_sent(zc, mnet_sendv(zc->sock, iov, iovcnt, flags), id);
+}
+
+int mnet_zerocopy_reap(mnet_zerocopy_t* zc, mnet_zerocopy_range_t* ranges, int max_ranges)
+{
+    if (!zc || !ranges || max_ranges <= 0) return -1;
+
+#ifdef MNET_LINUX
+    if (zc->enabled)
+    {
+        int count = 0;
+
+        while (count < max_ranges)
+        {
+            union
+            {
+                char buf[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(mnet_sockaddr_storage))];
+                struct cmsghdr align;
+            } control;
+
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_control = control.buf;
+            msg.msg_controllen = sizeof(control.buf);
+
+            if (recvmsg(zc->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return count > 0 ? count : -1;
+            }
+
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg && count < max_ranges;
+                 cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                const int is_recverr = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                                    || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+                if (!is_recverr) continue;
+
+                struct sock_extended_err err;
+                memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+                if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) continue;
+
+                ranges[count].first = err.ee_info;
+                ranges[count].last = err.ee_data;
+                ranges[count].copied = (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+                count++;
+            }
+        }
+
+        return count;
+    }
+#endif
+
+    // copying sends are complete as soon as they return.
+    if (zc->reaped_id == zc->next_id) return 0;
+
+    ranges[0].first = zc->reaped_id;
+    ranges[0].last = zc->next_id - 1;
+    ranges[0].copied = 1;
+    zc->reaped_id = zc->next_id;
+    return 1;
+}
+
+int mnet_zerocopy_range_has(const mnet_zerocopy_range_t* range, uint32_t id)
+{
+    if (!range) return 0;
+
+    // ids wrap around, compare relative to the start of the range.
+    return id - range->first <= range->last - range->first;
+}
+
+
+// ================================================
+//              PACKET TIMESTAMPS
+//
+
+
+#ifdef MNET_LINUX
+#   ifndef SCM_TIMESTAMPING
+#       define SCM_TIMESTAMPING SO_TIMESTAMPING
+#   endif
+#   ifndef SCM_TIMESTAMPNS
+#       define SCM_TIMESTAMPNS SO_TIMESTAMPNS
+#   endif
+#endif
+
+#ifdef MNET_LINUX
+static uint64_t mnet_timespec_ns(const struct timespec* ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000000ull + (uint64_t)ts->tv_nsec;
+}
+#endif
+
+#ifdef MNET_UNIX
+static void mnet_timestamp_parse(struct msghdr* msg, mnet_timestamp_t* ts)
+{
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET) continue;
+
+#ifdef MNET_LINUX
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING)
+        {
+            // ts[0] software, ts[1] unused, ts[2] raw hardware.
+            struct scm_timestamping stamps;
+            memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            ts->software_ns = mnet_timespec_ns(&stamps.ts[0]);
+            ts->hardware_ns = mnet_timespec_ns(&stamps.ts[2]);
+        }
+        else if (cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            struct timespec stamp;
+            memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+            ts->software_ns = mnet_timespec_ns(&stamp);
+        }
+#elif defined(SO_TIMESTAMP)
+        if (cmsg->cmsg_type == SCM_TIMESTAMP)
+        {
+            struct timeval stamp;
+            memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+            ts->software_ns = (uint64_t)stamp.tv_sec * 1000000000ull + (uint64_t)stamp.tv_usec * 1000ull;
+        }
+#endif
+    }
+}
+#endif
+
+mnet_result_t mnet_set_timestamping(mnet_socket_t sock, int flags)
+{
+#ifdef MNET_LINUX
+    unsigned int optval = 0;
+    if (flags & mnet_timestamp_rx_software) optval |= SOF_TIMESTAMPING_RX_SOFTWARE;
+    if (flags & mnet_timestamp_rx_hardware) optval |= SOF_TIMESTAMPING_RX_HARDWARE;
+    if (flags & mnet_timestamp_tx_software) optval |= SOF_TIMESTAMPING_TX_SOFTWARE;
+    if (flags & mnet_timestamp_tx_hardware) optval |= SOF_TIMESTAMPING_TX_HARDWARE;
+
+    // report both clocks that were asked for. tx timestamps carry the
+    //  send id and leave the payload out of the error queue.
+    if (flags & (mnet_timestamp_rx_software | mnet_timestamp_tx_software))
+        optval |= SOF_TIMESTAMPING_SOFTWARE;
+    if (flags & (mnet_timestamp_rx_hardware | mnet_timestamp_tx_hardware))
+        optval |= SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (flags & (mnet_timestamp_tx_software | mnet_timestamp_tx_hardware))
+    {
+        optval |= SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+
+        // zero-copy completions share the error queue.
+        int zerocopy = 0;
+        socklen_t zerocopy_len = sizeof(zerocopy);
+        if (getsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &zerocopy, &zerocopy_len) == 0 && zerocopy)
+            return mnet_error;
+    }
+
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &optval, sizeof(optval)) == 0)
+        return mnet_ok;
+
+    // older kernels: software receive times only.
+    if (flags & ~mnet_timestamp_rx_software) return mnet_error;
+    int enable = 1;
+    return setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0 ? mnet_ok : mnet_error;
+#elif defined(MNET_UNIX) && defined(SO_TIMESTAMP)
+    if (flags & ~mnet_timestamp_rx_software) return mnet_error;
+    int enable = flags ? 1 : 0;
+    return setsockopt(sock, SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof(enable)) == 0 ? mnet_ok : mnet_error;
+#else
+    (void)sock;
+    return flags ? mnet_error : mnet_ok;
+#endif
+}
+
+int mnet_recvfrom_ts(mnet_socket_t sock, void* buf, size_t len, mnet_msg_flags_t flags,
+                     mnet_sockaddr_t* src_addr, mnet_socklen_t* addrlen, mnet_timestamp_t* ts)
+{
+    if (ts) memset(ts, 0, sizeof(*ts));
+
+#ifdef MNET_UNIX
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = len;
+
+    union
+    {
+        char buf[CMSG_SPACE(3 * sizeof(struct timespec))];
+        struct cmsghdr align;
+    } control;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = src_addr;
+    msg.msg_namelen = (src_addr && addrlen) ? *addrlen : 0;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    const int received = (int)recvmsg(sock, &msg, (int)flags);
+    if (received < 0) return -1;
+
+    if (addrlen) *addrlen = msg.msg_namelen;
+    if (ts) mnet_timestamp_parse(&msg, ts);
+    return received;
+#else
+    return mnet_recvfrom(sock, buf, len, flags, src_addr, addrlen);
+#endif
+}
+
+int mnet_timestamp_reap_tx(mnet_socket_t sock, mnet_tx_timestamp_t* out, int max_out)
+{
+    if (!out || max_out <= 0) return -1;
+
+#ifdef MNET_LINUX
+    int count = 0;
+
+    while (count < max_out)
+    {
+        union
+        {
+            char buf[CMSG_SPACE(sizeof(struct scm_timestamping))
+                   + CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(mnet_sockaddr_storage))];
+            struct cmsghdr align;
+        } control;
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return count > 0 ? count : -1;
+        }
+
+        // the timestamps and the send id come as two cmsgs of one message.
+        mnet_timestamp_t ts;
+        memset(&ts, 0, sizeof(ts));
+        int have_id = 0;
+        uint32_t id = 0;
+
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            const int is_recverr = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                                || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+            if (!is_recverr) continue;
+
+            struct sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_TIMESTAMPING) continue;
+
+            id = err.ee_data;
+            have_id = 1;
+        }
+
+        if (!have_id) continue;
+        mnet_timestamp_parse(&msg, &ts);
+
+        out[count].id = id;
+        out[count].ts = ts;
+        count++;
+    }
+
+    return count;
+#else
+    (void)sock;
+    return 0;
+#endif
+}
+
+
+// ================================================
+//              BUSY POLLING
+//
+
+
+#ifdef MNET_LINUX
+#   ifndef SO_BUSY_POLL
+#       define SO_BUSY_POLL 46
+#   endif
+#   ifndef SO_PREFER_BUSY_POLL
+#       define SO_PREFER_BUSY_POLL 69
+#   endif
+#endif
+
+mnet_result_t mnet_busy_poll_init(mnet_busy_poll_t* bp, mnet_socket_t sock, uint32_t spin_us)
+{
+    if (!bp || sock == MNET_INVALID_SOCKET) return mnet_error;
+    memset(bp, 0, sizeof(*bp));
+    bp->sock = sock;
+    bp->spin_ns = (uint64_t)spin_us * 1000ull;
+
+#ifdef MNET_LINUX
+    // the kernel polls the device queue inside our receives and polls.
+    int usec = (int)spin_us;
+    bp->kernel = spin_us > 0 && setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == 0;
+
+    // keep the device in busy poll mode instead of interrupts. (5.11+)
+    int prefer = 1;
+    if (bp->kernel) (void)setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer));
+#endif
+
+    return mnet_ok;
+}
+
+static int mnet_busy_poll_try(mnet_busy_poll_t* bp, void* buf, size_t len, mnet_msg_flags_t flags,
+                              mnet_sockaddr_t* src_addr, mnet_socklen_t* addrlen)
+{
+#ifdef MNET_WINDOWS
+    // no per call non-blocking flag, ask first.
+    mnet_pollfd_t pfd;
+    pfd.fd = bp->sock;
+    pfd.events = mnet_pollin;
+    pfd.revents = 0;
+    if (mnet_poll(&pfd, 1, 0) == 0)
+    {
+        WSASetLastError(WSAEWOULDBLOCK);
+        return -1;
+    }
+    return mnet_recvfrom(bp->sock, buf, len, flags, src_addr, addrlen);
+#elif defined(MNET_UNIX)
+    return mnet_recvfrom(bp->sock, buf, len, (mnet_msg_flags_t)((int)flags | MSG_DONTWAIT), src_addr, addrlen);
+#endif
+}
+
+static int mnet_busy_poll_wait(mnet_busy_poll_t* bp, void* buf, size_t len, mnet_msg_flags_t flags,
+                               mnet_sockaddr_t* src_addr, mnet_socklen_t* addrlen, int timeout_ms)
+{
+    if (!bp) return -1;
+
+    if (bp->spin_ns > 0)
+    {
+        const uint64_t start = mnet_time_ns();
+        uint64_t now = start;
+
+        do
+        {
+            const int received = mnet_busy_poll_try(bp, buf, len, flags, src_addr, addrlen);
+            if (received >= 0 || mnet_get_platform_error() != mnet_ewouldblock)
+            {
+                bp->stats.spin_ns += mnet_time_ns() - start;
+                if (received >= 0) bp->stats.spin_hits++;
+                return received;
+            }
+
+            bp->stats.empty_polls++;
+            now = mnet_time_ns();
+        } while (now - start < bp->spin_ns);
+
+        bp->stats.spin_ns += now - start;
+    }
+
+    bp->stats.yields++;
+
+    mnet_pollfd_t pfd;
+    pfd.fd = bp->sock;
+    pfd.events = mnet_pollin;
+    pfd.revents = 0;
+
+    const int ready = mnet_poll(&pfd, 1, timeout_ms);
+    if (ready < 0) return -1;
+    if (ready == 0)
+    {
+#ifdef MNET_WINDOWS
+        WSASetLastError(WSAETIMEDOUT);
+#elif defined(MNET_UNIX)
+        errno = ETIMEDOUT;
+#endif
+        return -1;
+    }
+
+    return mnet_busy_poll_try(bp, buf, len, flags, src_addr, addrlen);
+}
+
+int mnet_busy_poll_recv(mnet_busy_poll_t* bp, void* buf, size_t len, mnet_msg_flags_t flags, int timeout_ms)
+{
+    return mnet_busy_poll_wait(bp, buf, len, flags, NULL, NULL, timeout_ms);
+}
+
+int mnet_busy_poll_recvfrom(mnet_busy_poll_t* bp, void* buf, size_t len, mnet_msg_flags_t flags,
+                            mnet_sockaddr_t* src_addr, mnet_socklen_t* addrlen, int timeout_ms)
+{
+    return mnet_busy_poll_wait(bp, buf, len, flags, src_addr, addrlen, timeout_ms);
+}
+
+
+// ================================================
+//             FILE TRANSFER & RELAY
+//
+
+
+#ifdef MNET_LINUX
+
+int64_t mnet_sendfile(mnet_socket_t sock, mnet_file_t file, int64_t* offset, size_t count)
+{
+    if (!offset || *offset < 0) return -1;
+
+    off_t off = (off_t)*offset;
+    const ssize_t sent = sendfile(sock, file, &off, count);
+    if (sent < 0) return -1;
+
+    *offset = (int64_t)off;
+    return (int64_t)sent;
+}
+
+mnet_result_t mnet_relay_init(mnet_relay_t* relay)
+{
+    if (!relay) return mnet_error;
+    memset(relay, 0, sizeof(*relay));
+    relay->pipe_rd = -1;
+    relay->pipe_wr = -1;
+
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) return mnet_error;
+
+    relay->pipe_rd = fds[0];
+    relay->pipe_wr = fds[1];
+    return mnet_ok;
+}
+
+void mnet_relay_destroy(mnet_relay_t* relay)
+{
+    if (!relay) return;
+    if (relay->pipe_rd >= 0) close(relay->pipe_rd);
+    if (relay->pipe_wr >= 0) close(relay->pipe_wr);
+    memset(relay, 0, sizeof(*relay));
+    relay->pipe_rd = -1;
+    relay->pipe_wr = -1;
+}
+
+static int64_t mnet_relay_flush(mnet_relay_t* relay, mnet_socket_t to)
+{
+    int64_t written = 0;
+
+    while (relay->pending > 0)
+    {
+        const ssize_t n = splice(relay->pipe_rd, NULL, to, NULL, relay->pending,
+                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n <= 0) return written > 0 ? written : -1;
+
+        relay->pending -= (size_t)n;
+        written += n;
+    }
+
+    return written;
+}
+
+int64_t mnet_relay(mnet_relay_t* relay, mnet_socket_t from, mnet_socket_t to, size_t max)
+{
+    if (!relay) return -1;
+
+    int64_t written = 0;
+    if (relay->pending > 0)
+    {
+        written = mnet_relay_flush(relay, to);
+        if (relay->pending > 0) return written > 0 ? written : -1;
+    }
+
+    const ssize_t in = splice(from, NULL, relay->pipe_wr, NULL, max,
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (in == 0) return written;
+    if (in < 0)
+    {
+        if (written > 0) return written;
+        return -1;
+    }
+
+    relay->pending += (size_t)in;
+
+    const int64_t out = mnet_relay_flush(relay, to);
+    if (out < 0)
+    {
+        if (written > 0) return written;
+
+        // data is parked in the pipe, report it as would block.
+        errno = EWOULDBLOCK;
+        return -1;
+    }
+
+    return written + out;
+}
+
+#else
+
+int64_t mnet_sendfile(mnet_socket_t sock, mnet_file_t file, int64_t* offset, size_t count)
+{
+    if (!offset || *offset < 0) return -1;
+
+    uint8_t buf[MNET_RELAY_BUFFER_SIZE];
+    const size_t want = count < sizeof(buf) ? count : sizeof(buf);
+
+#ifdef MNET_WINDOWS
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)((uint64_t)*offset & 0xFFFFFFFFu);
+    ov.OffsetHigh = (DWORD)((uint64_t)*offset >> 32);
+
+    DWORD got = 0;
+    if (!ReadFile(file, buf, (DWORD)want, &got, &ov))
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    const int64_t read_bytes = (int64_t)got;
+#else
+    const ssize_t got = pread(file, buf, want, (off_t)*offset);
+    if (got < 0) return -1;
+    const int64_t read_bytes = (int64_t)got;
+#endif
+
+    if (read_bytes == 0) return 0;
+
+    const int sent = mnet_send(sock, buf, (size_t)read_bytes, mnet_msg_default);
+    if (sent < 0) return -1;
+
+    *offset += sent;
+    return (int64_t)sent;
+}
+
+mnet_result_t mnet_relay_init(mnet_relay_t* relay)
+{
+    if (!relay) return mnet_error;
+    memset(relay, 0, sizeof(*relay));
+
+    relay->buf = (uint8_t*)malloc(MNET_RELAY_BUFFER_SIZE);
+    return relay->buf ? mnet_ok : mnet_error;
+}
+
+void mnet_relay_destroy(mnet_relay_t* relay)
+{
+    if (!relay) return;
+    free(relay->buf);
+    memset(relay, 0, sizeof(*relay));
+}
+
+static int64_t mnet_relay_flush(mnet_relay_t* relay, mnet_socket_t to)
+{
+    int64_t written = 0;
+
+    while (relay->pending > 0)
+    {
+        const int n = mnet_send(to, relay->buf + relay->start, relay->pending, mnet_msg_default);
+        if (n <= 0) return written > 0 ? written : -1;
+
+        relay->start += (size_t)n;
+        relay->pending -= (size_t)n;
+        written += n;
+    }
+
+    relay->start = 0;
+    return written;
+}
+
+int64_t mnet_relay(mnet_relay_t* relay, mnet_socket_t from, mnet_socket_t to, size_t max)
+{
+    if (!relay || !relay->buf) return -1;
+
+    int64_t written = 0;
+    if (relay->pending > 0)
+    {
+        written = mnet_relay_flush(relay, to);
+        if (relay->pending > 0) return written > 0 ? written : -1;
+    }
+
+    const size_t want = max < MNET_RELAY_BUFFER_SIZE ? max : MNET_RELAY_BUFFER_SIZE;
+    const int in = mnet_recv(from, relay->buf, want, mnet_msg_default);
+    if (in == 0) return written;
+    if (in < 0) return written > 0 ? written : -1;
+
+    relay->start = 0;
+    relay->pending = (size_t)in;
+
+    const int64_t out = mnet_relay_flush(relay, to);
+    if (out < 0) return written > 0 ? written : -1;
+
+    return written + out;
+}
+
+#endif
+
+
+// ================================================
+//                  SOCKET OPTIONS
+//
+
+
+int mnet_setsockopt(mnet_socket_t sock, mnet_sockopt_level_t level, mnet_sockopt_t optname,
+                    const void* optval, mnet_socklen_t optlen)
+{
+#ifdef MNET_WINDOWS
+    return setsockopt(sock, (int)level, (int)optname, (const char*)optval, optlen);
+#elif defined(MNET_UNIX)
+    return setsockopt(sock, (int)level, (int)optname, optval, optlen);
+#endif
+}
+
+int mnet_getsockopt(mnet_socket_t sock, mnet_sockopt_level_t level, mnet_sockopt_t optname,
+                    void* optval, mnet_socklen_t* optlen)
+{
+#ifdef MNET_WINDOWS
+    return getsockopt(sock, (int)level, (int)optname, (char*)optval, optlen);
+#elif defined(MNET_UNIX)
+    return getsockopt(sock, (int)level, (int)optname, optval, optlen);
+#endif
+}
+
+
+// ================================================
+//              EXTRA SOCKET CONTROL
+//
+
+mnet_result_t mnet_set_blocking(mnet_socket_t sock, const int do_block)
+{
+#ifdef MNET_WINDOWS
+
+    u_long mode = do_block ? 0 : 1;
+    return ioctlsocket(sock, (long int)FIONBIO, &mode) == 0 ? mnet_ok : mnet_error;
+
+#elif defined(MNET_UNIX)
+
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags == -1) return mnet_error;
+
+    if (do_block)
+        flags &= ~O_NONBLOCK;
+    else
+        flags |= O_NONBLOCK;
+
+    return fcntl(sock, F_SETFL, flags) == 0 ? mnet_ok : mnet_error;
+
+#endif
+}
+
+mnet_result_t mnet_set_reuseaddr(
+    const mnet_socket_t sock,
+    const int do_reuse)
+{
+    if (sock == MNET_INVALID_SOCKET) return mnet_error;
+
+    int optval = do_reuse ? 1 : 0;
+
+#ifdef MNET_WINDOWS
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&optval, sizeof(optval)) != 0)
+        return mnet_error;
+#elif defined(MNET_UNIX)
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) != 0)
+        return mnet_error;
+#endif
+
+    return mnet_ok;
+}
+
+mnet_result_t mnet_set_reuseport(
+    const mnet_socket_t sock,
+    const int do_reuse)
+{
+    if (sock == MNET_INVALID_SOCKET) return mnet_error;
+
+#if defined(MNET_UNIX) && defined(SO_REUSEPORT)
+    int optval = do_reuse ? 1 : 0;
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) != 0)
+        return mnet_error;
+    return mnet_ok;
+#else
+    (void)do_reuse;
+    return mnet_error;
+#endif
+}
+
+int mnet_available(mnet_socket_t sock, unsigned long* bytes)
+{
+    if (!bytes) return mnet_error;
+
+#ifdef MNET_WINDOWS
+    return ioctlsocket(sock, FIONREAD, bytes) == 0 ? mnet_ok : mnet_error;
+#elif defined(MNET_UNIX)
+    return ioctl(sock, FIONREAD, bytes) == 0 ? mnet_ok : mnet_error;
+#endif
+}
+
+// ================================================
+//             I/O MULTIPLEXING (POLL)
+//
+
+int mnet_poll(mnet_pollfd_t* fds, int nfds, int timeout)
+{
+    if (!fds) return mnet_error;
+
+#ifdef MNET_WINDOWS
+    return WSAPoll((WSAPOLLFD*)fds, (ULONG)nfds, timeout);
+#elif defined(MNET_UNIX)
+    return poll((struct pollfd*)fds, (nfds_t)nfds, timeout);
+#endif
+}
+
+
+// ================================================
+//             EVENT LOOP (READINESS)
+//
+
+
+#ifdef MNET_LINUX
+
+static uint32_t mnet_loop_to_epoll(uint32_t events)
+{
+    uint32_t ep = 0;
+    if (events & mnet_loop_in)      ep |= EPOLLIN | EPOLLRDHUP;
+    if (events & mnet_loop_out)     ep |= EPOLLOUT;
+    if (events & mnet_loop_edge)    ep |= EPOLLET;
+    if (events & mnet_loop_oneshot) ep |= EPOLLONESHOT;
+    return ep;
+}
+
+static uint32_t mnet_loop_from_epoll(uint32_t ep)
+{
+    uint32_t events = 0;
+    if (ep & EPOLLIN)                   events |= mnet_loop_in;
+    if (ep & EPOLLOUT)                  events |= mnet_loop_out;
+    if (ep & EPOLLERR)                  events |= mnet_loop_err;
+    if (ep & (EPOLLHUP | EPOLLRDHUP))   events |= mnet_loop_hup;
+    return events;
+}
+
+static void** mnet_loop_slot(mnet_loop_t* loop, mnet_socket_t sock, int create)
+{
+    if (sock < 0 || sock >= MNET_LOOP_MAX_FD) return NULL;
+
+    const size_t page_index = (size_t)sock / MNET_LOOP_PAGE_SIZE;
+    void** page = __atomic_load_n(&loop->pages[page_index], __ATOMIC_ACQUIRE);
+
+    if (!page && create)
+    {
+        void** fresh = (void**)calloc(MNET_LOOP_PAGE_SIZE, sizeof(void*));
+        if (!fresh) return NULL;
+
+        // another thread may have published the page first.
+        if (__atomic_compare_exchange_n(&loop->pages[page_index], &page, fresh,
+                                        0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            page = fresh;
+        else
+            free(fresh);
+    }
+
+    if (!page) return NULL;
+    return &page[(size_t)sock % MNET_LOOP_PAGE_SIZE];
+}
+
+static mnet_result_t mnet_loop_ctl(mnet_loop_t* loop, int op, mnet_socket_t sock,
+                                   uint32_t events, void* udata)
+{
+    void** slot = mnet_loop_slot(loop, sock, 1);
+    if (!slot) return mnet_error;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = mnet_loop_to_epoll(events);
+    ev.data.fd = sock;
+
+    // an added socket can fire on another thread before epoll_ctl
+    //  returns, so its udata goes in first. a failed call must not
+    //  clobber the udata of a registration that is still live. (EEXIST)
+    if (op == EPOLL_CTL_ADD)
+    {
+        void* previous = __atomic_exchange_n(slot, udata, __ATOMIC_ACQ_REL);
+        if (epoll_ctl(loop->epfd, op, sock, &ev) == 0) return mnet_ok;
+
+        __atomic_store_n(slot, previous, __ATOMIC_RELEASE);
+        return mnet_error;
+    }
+
+    if (epoll_ctl(loop->epfd, op, sock, &ev) != 0) return mnet_error;
+    __atomic_store_n(slot, udata, __ATOMIC_RELEASE);
+    return mnet_ok;
+}
+
+mnet_result_t mnet_loop_init(mnet_loop_t* loop)
+{
+    if (!loop) return mnet_error;
+    memset(loop, 0, sizeof(*loop));
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    return loop->epfd >= 0 ? mnet_ok : mnet_error;
+}
+
+void mnet_loop_destroy(mnet_loop_t* loop)
+{
+    if (!loop) return;
+
+    if (loop->epfd >= 0) close(loop->epfd);
+    loop->epfd = -1;
+
+    for (size_t i = 0; i < MNET_LOOP_PAGE_COUNT; i++)
+    {
+        free(loop->pages[i]);
+        loop->pages[i] = NULL;
+    }
+}
+
+mnet_result_t mnet_loop_add(mnet_loop_t* loop, mnet_socket_t sock, uint32_t events, void* udata)
+{
+    if (!loop) return mnet_error;
+    return mnet_loop_ctl(loop, EPOLL_CTL_ADD, sock, events, udata);
+}
+
+mnet_result_t mnet_loop_mod(mnet_loop_t* loop, mnet_socket_t sock, uint32_t events, void* udata)
+{
+    if (!loop) return mnet_error;
+    return mnet_loop_ctl(loop, EPOLL_CTL_MOD, sock, events, udata);
+}
+
+mnet_result_t mnet_loop_del(mnet_loop_t* loop, mnet_socket_t sock)
+{
+    if (!loop) return mnet_error;
+
+    void** slot = mnet_loop_slot(loop, sock, 0);
+    if (slot) __atomic_store_n(slot, NULL, __ATOMIC_RELEASE);
+
+    return epoll_ctl(loop->epfd, EPOLL_CTL_DEL, sock, NULL) == 0 ? mnet_ok : mnet_error;
+}
+
+static int mnet_loop_wait_sockets(mnet_loop_t* loop, mnet_loop_event_t* events, int max_events, int timeout)
+{
+    struct epoll_event batch[MNET_LOOP_WAIT_BATCH];
+    int total = 0;
+
+    while (total < max_events)
+    {
+        int want = max_events - total;
+        if (want > MNET_LOOP_WAIT_BATCH) want = MNET_LOOP_WAIT_BATCH;
+
+        // only the first call may block, the rest drain what is already ready.
+        const int n = epoll_wait(loop->epfd, batch, want, total == 0 ? timeout : 0);
+        if (n < 0)
+        {
+            if (total > 0) break;
+            return -1;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            mnet_loop_event_t* out = &events[total + i];
+            void** slot = mnet_loop_slot(loop, batch[i].data.fd, 0);
+
+            out->sock = batch[i].data.fd;
+            out->events = mnet_loop_from_epoll(batch[i].events);
+            out->udata = slot ? __atomic_load_n(slot, __ATOMIC_ACQUIRE) : NULL;
+        }
+
+        total += n;
+        if (n < want) break;
+    }
+
+    return total;
+}
+
+#else
+
+static short mnet_loop_to_poll(uint32_t events)
+{
+    short ev = 0;
+    if (events & mnet_loop_in)  ev |= POLLIN;
+    if (events & mnet_loop_out) ev |= POLLOUT;
+    return ev;
+}
+
+static int mnet_loop_find(const mnet_loop_t* loop, mnet_socket_t sock)
+{
+    for (int i = 0; i < loop->count; i++)
+        if (loop->fds[i].fd == sock) return i;
+    return -1;
+}
+
+mnet_result_t mnet_loop_init(mnet_loop_t* loop)
+{
+    if (!loop) return mnet_error;
+    memset(loop, 0, sizeof(*loop));
+    return mnet_ok;
+}
+
+void mnet_loop_destroy(mnet_loop_t* loop)
+{
+    if (!loop) return;
+    free(loop->fds);
+    free(loop->udata);
+    free(loop->flags);
+    memset(loop, 0, sizeof(*loop));
+}
+
+mnet_result_t mnet_loop_add(mnet_loop_t* loop, mnet_socket_t sock, uint32_t events, void* udata)
+{
+    if (!loop || sock == MNET_INVALID_SOCKET) return mnet_error;
+    if (mnet_loop_find(loop, sock) >= 0) return mnet_error;
+
+    if (loop->count == loop->capacity)
+    {
+        const int capacity = loop->capacity ? loop->capacity * 2 : 64;
+
+        mnet_pollfd_t* fds = (mnet_pollfd_t*)realloc(loop->fds, (size_t)capacity * sizeof(*fds));
+        if (!fds) return mnet_error;
+        loop->fds = fds;
+
+        void** ud = (void**)realloc(loop->udata, (size_t)capacity * sizeof(*ud));
+        if (!ud) return mnet_error;
+        loop->udata = ud;
+
+        uint32_t* flags = (uint32_t*)realloc(loop->flags, (size_t)capacity * sizeof(*flags));
+        if (!flags) return mnet_error;
+        loop->flags = flags;
+
+        loop->capacity = capacity;
+    }
+
+    const int i = loop->count++;
+    loop->fds[i].fd = sock;
+    loop->fds[i].events = mnet_loop_to_poll(events);
+    loop->fds[i].revents = 0;
+    loop->udata[i] = udata;
+    loop->flags[i] = events;
+    return mnet_ok;
+}
+
+mnet_result_t mnet_loop_mod(mnet_loop_t* loop, mnet_socket_t sock, uint32_t events, void* udata)
+{
+    if (!loop) return mnet_error;
+
+    const int i = mnet_loop_find(loop, sock);
+    if (i < 0) return mnet_error;
+
+    loop->fds[i].events = mnet_loop_to_poll(events);
+    loop->udata[i] = udata;
+    loop->flags[i] = events;
+    return mnet_ok;
+}
+
+mnet_result_t mnet_loop_del(mnet_loop_t* loop, mnet_socket_t sock)
+{
+    if (!loop) return mnet_error;
+
+    const int i = mnet_loop_find(loop, sock);
+    if (i < 0) return mnet_error;
+
+    const int last = --loop->count;
+    loop->fds[i] = loop->fds[last];
+    loop->udata[i] = loop->udata[last];
+    loop->flags[i] = loop->flags[last];
+    return mnet_ok;
+}
+
+static int mnet_loop_wait_sockets(mnet_loop_t* loop, mnet_loop_event_t* events, int max_events, int timeout)
+{
+    if (loop->count == 0)
+    {
+#ifdef MNET_WINDOWS
+        // WSAPoll rejects an empty set.
+        if (timeout != 0) Sleep(timeout < 0 ? INFINITE : (DWORD)timeout);
+#else
+        if (timeout != 0) poll(NULL, 0, timeout);
+#endif
+        return 0;
+    }
+
+    const int ready = mnet_poll(loop->fds, loop->count, timeout);
+    if (ready <= 0) return ready;
+
+    int total = 0;
+    for (int i = 0; i < loop->count && total < max_events; i++)
+    {
+        const short revents = loop->fds[i].revents;
+        if (!revents) continue;
+
+        uint32_t ev = 0;
+        if (revents & POLLIN)               ev |= mnet_loop_in;
+        if (revents & POLLOUT)              ev |= mnet_loop_out;
+        if (revents & (POLLERR | POLLNVAL)) ev |= mnet_loop_err;
+        if (revents & POLLHUP)              ev |= mnet_loop_hup;
+
+        events[total].sock = loop->fds[i].fd;
+        events[total].events = ev;
+        events[total].udata = loop->udata[i];
+        total++;
+
+        // disarm until mnet_loop_mod.
+        if (loop->flags[i] & mnet_loop_oneshot) loop->fds[i].events = 0;
+        loop->fds[i].revents = 0;
+    }
+
+    return total;
+}
+
+#endif
+
+int mnet_loop_wait(mnet_loop_t* loop, mnet_loop_event_t* events, int max_events, int timeout)
+{
+    if (!loop || !events || max_events <= 0) return -1;
+    if (!loop->timers) return mnet_loop_wait_sockets(loop, events, max_events, timeout);
+
+    const uint64_t start = mnet_time_ms();
+    int fired = 0;
+
+    for (;;)
+    {
+        const uint64_t now = mnet_time_ms();
+        fired += mnet_timer_wheel_advance(loop->timers, now);
+
+        // timers ran, only collect what is ready on top of that.
+        int wait = fired > 0 ? 0 : timeout;
+        if (wait > 0) wait = now - start >= (uint64_t)wait ? 0 : wait - (int)(now - start);
+
+        const int next = mnet_timer_wheel_timeout(loop->timers, now);
+        const int shortened = next >= 0 && (wait < 0 || next < wait);
+        if (shortened) wait = next;
+
+        const int count = mnet_loop_wait_sockets(loop, events, max_events, wait);
+        if (count != 0 || fired > 0 || !shortened) return count;
+
+        // woken for a deadline, which may only have moved timers
+        //  down the wheel. keep waiting out the caller's timeout.
+    }
+}
+
+
+// ================================================
+//            TIMER WHEEL
+//
+
+
+#define MNET_TIMER_SLOT_MASK    ((uint64_t)MNET_TIMER_SLOTS - 1)
+
+static int mnet_timer_ctz64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while (!(v & 1)) { v >>= 1; n++; }
+    return n;
+#endif
+}
+
+static void mnet_timer_link(mnet_timer_t** head, mnet_timer_t* timer)
+{
+    timer->next = *head;
+    if (timer->next) timer->next->pprev = &timer->next;
+    timer->pprev = head;
+    *head = timer;
+}
+
+static void mnet_timer_unlink(mnet_timer_t* timer)
+{
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+static void mnet_timer_update_occupied(mnet_timer_wheel_t* wheel, int level, int slot)
+{
+    if (wheel->slots[level][slot]) wheel->occupied[level] |= (uint64_t)1 << slot;
+    else wheel->occupied[level] &= ~((uint64_t)1 << slot);
+}
+
+static void mnet_timer_place(mnet_timer_wheel_t* wheel, mnet_timer_t* timer)
+{
+    const uint64_t now = wheel->now;
+    uint64_t expires = timer->expires;
+
+    if (expires <= now)
+    {
+        mnet_timer_link(&wheel->expired, timer);
+        timer->slot = -1;
+        return;
+    }
+
+    // the lowest level where the deadline's slot comes up within one
+    //  turn from now. counted in slots ahead rather than by comparing
+    //  digits, so a deadline just across a turn of the level above
+    //  still lands close by. (slots wrap around)
+    int level = 0;
+    uint64_t ahead = expires - now;
+    while (level < MNET_TIMER_LEVELS - 1 && ahead > MNET_TIMER_SLOT_MASK)
+    {
+        level++;
+        ahead = (expires >> (MNET_TIMER_SLOT_BITS * level)) - (now >> (MNET_TIMER_SLOT_BITS * level));
+    }
+
+    int slot;
+    if (ahead > MNET_TIMER_SLOT_MASK)
+    {
+        // beyond the wheel, park in the top slot that comes up last.
+        //  it is placed again with its real deadline from there.
+        slot = (int)(((now >> (MNET_TIMER_SLOT_BITS * level)) + MNET_TIMER_SLOT_MASK) & MNET_TIMER_SLOT_MASK);
+    }
+    else
+    {
+        slot = (int)((expires >> (MNET_TIMER_SLOT_BITS * level)) & MNET_TIMER_SLOT_MASK);
+    }
+
+    mnet_timer_link(&wheel->slots[level][slot], timer);
+    wheel->occupied[level] |= (uint64_t)1 << slot;
+    timer->slot = level * MNET_TIMER_SLOTS + slot;
+}
+
+static int mnet_timer_fire_list(mnet_timer_wheel_t* wheel, mnet_timer_t** head)
+{
+    // detach first, callbacks may start timers that land in the same list.
+    mnet_timer_t* list = *head;
+    *head = NULL;
+    if (list) list->pprev = &list;
+
+    int fired = 0;
+    while (list)
+    {
+        mnet_timer_t* timer = list;
+        mnet_timer_unlink(timer);
+        wheel->count--;
+        fired++;
+
+        if (timer->callback) timer->callback(wheel, timer, timer->udata);
+    }
+    return fired;
+}
+
+static void mnet_timer_cascade(mnet_timer_wheel_t* wheel)
+{
+    for (int level = 1; level < MNET_TIMER_LEVELS; level++)
+    {
+        const int shift = MNET_TIMER_SLOT_BITS * level;
+        const int slot = (int)((wheel->now >> shift) & MNET_TIMER_SLOT_MASK);
+
+        mnet_timer_t* list = wheel->slots[level][slot];
+        wheel->slots[level][slot] = NULL;
+        wheel->occupied[level] &= ~((uint64_t)1 << slot);
+
+        while (list)
+        {
+            mnet_timer_t* timer = list;
+            list = timer->next;
+            timer->next = NULL;
+            mnet_timer_place(wheel, timer);
+        }
+
+        // the next level only turns over when this one wrapped.
+        if (slot != 0) break;
+    }
+}
+
+static uint64_t mnet_timer_next_tick(const mnet_timer_wheel_t* wheel)
+{
+    const uint64_t now = wheel->now;
+    uint64_t next = UINT64_MAX;
+
+    // slots hold deadlines 1 to 63 slots ahead of their level's current
+    //  digit, wrapping around. rotate the bitmap so bit 0 is the slot
+    //  right after the digit, its lowest bit is the nearest slot. a
+    //  higher level can come up (to cascade) before a lower one.
+    for (int level = 0; level < MNET_TIMER_LEVELS; level++)
+    {
+        const uint64_t occupied = wheel->occupied[level];
+        if (!occupied) continue;
+
+        const int shift = MNET_TIMER_SLOT_BITS * level;
+        const int turn = (int)((now >> shift) & MNET_TIMER_SLOT_MASK) + 1;
+        const uint64_t rotated = turn == MNET_TIMER_SLOTS ? occupied : (occupied >> turn) | (occupied << (MNET_TIMER_SLOTS - turn));
+
+        const uint64_t tick = ((now >> shift) + (uint64_t)mnet_timer_ctz64(rotated) + 1) << shift;
+        if (tick < next) next = tick;
+    }
+
+    return next;
+}
+
+void mnet_timer_wheel_init(mnet_timer_wheel_t* wheel, uint64_t now_ms)
+{
+    if (!wheel) return;
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now_ms;
+}
+
+void mnet_timer_init(mnet_timer_t* timer, mnet_timer_callback_t callback, void* udata)
+{
+    if (!timer) return;
+    memset(timer, 0, sizeof(*timer));
+    timer->callback = callback;
+    timer->udata = udata;
+}
+
+void mnet_timer_start(mnet_timer_wheel_t* wheel, mnet_timer_t* timer, uint64_t expires_ms)
+{
+    if (!wheel || !timer) return;
+
+    mnet_timer_cancel(wheel, timer);
+    timer->expires = expires_ms;
+    mnet_timer_place(wheel, timer);
+    wheel->count++;
+}
+
+void mnet_timer_cancel(mnet_timer_wheel_t* wheel, mnet_timer_t* timer)
+{
+    if (!wheel || !timer || !timer->pprev) return;
+
+    const int index = timer->slot;
+    mnet_timer_unlink(timer);
+    wheel->count--;
+
+    if (index >= 0) mnet_timer_update_occupied(wheel, index / MNET_TIMER_SLOTS, index % MNET_TIMER_SLOTS);
+}
+
+int mnet_timer_pending(const mnet_timer_t* timer)
+{
+    return timer && timer->pprev ? 1 : 0;
+}
+
+int mnet_timer_wheel_advance(mnet_timer_wheel_t* wheel, uint64_t now_ms)
+{
+    if (!wheel) return 0;
+
+    int fired = mnet_timer_fire_list(wheel, &wheel->expired);
+
+    while (wheel->now < now_ms)
+    {
+        if (wheel->count == 0)
+        {
+            wheel->now = now_ms;
+            break;
+        }
+
+        // nothing happens on the ticks in between, skip them.
+        const uint64_t next = mnet_timer_next_tick(wheel);
+
+        if (next > now_ms)
+        {
+            wheel->now = now_ms;
+            break;
+        }
+
+        wheel->now = next;
+        const int slot = (int)(next & MNET_TIMER_SLOT_MASK);
+        if (slot == 0) mnet_timer_cascade(wheel);
+
+        fired += mnet_timer_fire_list(wheel, &wheel->slots[0][slot]);
+        mnet_timer_update_occupied(wheel, 0, slot);
+        fired += mnet_timer_fire_list(wheel, &wheel->expired);
+    }
+
+    return fired;
+}
+
+int mnet_timer_wheel_timeout(const mnet_timer_wheel_t* wheel, uint64_t now_ms)
+{
+    if (!wheel || wheel->count == 0) return -1;
+    if (wheel->expired) return 0;
+
+    const uint64_t next = mnet_timer_next_tick(wheel);
+    if (next <= now_ms) return 0;
+    return next - now_ms > INT32_MAX ? INT32_MAX : (int)(next - now_ms);
+}
+
+void mnet_loop_set_timers(mnet_loop_t* loop, mnet_timer_wheel_t* wheel)
+{
+    if (loop) loop->timers = wheel;
+}
+
+
+// ================================================
+//            COROUTINES
+//
+
+
+#define MNET_CO_QUEUED      0x01    // in the ready queue.
+#define MNET_CO_WOKEN       0x02    // sleep timer fired.
+
+static void mnet_co_timer_fired(mnet_timer_wheel_t* wheel, mnet_timer_t* timer, void* udata)
+{
+    (void)wheel;
+    (void)timer;
+
+    mnet_co_t* co = (mnet_co_t*)udata;
+    co->flags |= MNET_CO_WOKEN;
+    mnet_co_ready(co);
+}
+
+mnet_result_t mnet_co_sched_init(mnet_co_sched_t* sched)
+{
+    if (!sched) return mnet_error;
+    memset(sched, 0, sizeof(*sched));
+
+    if (mnet_loop_init(&sched->loop) != mnet_ok) return mnet_error;
+    mnet_timer_wheel_init(&sched->timers, mnet_time_ms());
+    mnet_loop_set_timers(&sched->loop, &sched->timers);
+    return mnet_ok;
+}
+
+void mnet_co_sched_destroy(mnet_co_sched_t* sched)
+{
+    if (!sched) return;
+    mnet_loop_destroy(&sched->loop);
+    sched->ready_head = NULL;
+    sched->ready_tail = NULL;
+    sched->count = 0;
+}
+
+void mnet_co_spawn(mnet_co_sched_t* sched, mnet_co_t* co, mnet_co_fn_t fn, void* udata)
+{
+    if (!sched || !co || !fn) return;
+    memset(co, 0, sizeof(*co));
+    co->fn = fn;
+    co->udata = udata;
+    co->sched = sched;
+    co->wait_sock = MNET_INVALID_SOCKET;
+    co->reg_sock = MNET_INVALID_SOCKET;
+    mnet_timer_init(&co->timer, mnet_co_timer_fired, co);
+
+    sched->count++;
+    mnet_co_ready(co);
+}
+
+void mnet_co_ready(mnet_co_t* co)
+{
+    if (!co || (co->flags & MNET_CO_QUEUED)) return;
+
+    mnet_co_sched_t* sched = co->sched;
+    co->flags |= MNET_CO_QUEUED;
+    co->next = NULL;
+
+    if (sched->ready_tail) sched->ready_tail->next = co;
+    else sched->ready_head = co;
+    sched->ready_tail = co;
+}
+
+static int mnet_co_wait_socket(mnet_co_t* co, mnet_socket_t sock, uint8_t events)
+{
+    // sockets stay registered (edge triggered) with the coroutine as
+    //  udata, the loop is only touched when it waits for something new.
+    if (co->reg_sock != sock || co->reg_events != events)
+    {
+        const uint32_t mask = (uint32_t)events | mnet_loop_edge;
+        if (mnet_loop_mod(&co->sched->loop, sock, mask, co) != mnet_ok &&
+            mnet_loop_add(&co->sched->loop, sock, mask, co) != mnet_ok)
+            return -1;
+
+        co->reg_sock = sock;
+        co->reg_events = events;
+    }
+
+    co->wait_sock = sock;
+    co->wait_events = events;
+    return MNET_CO_WAIT;
+}
+
+int mnet_co_sched_run_once(mnet_co_sched_t* sched, int timeout_ms)
+{
+    if (!sched) return -1;
+
+    mnet_loop_event_t events[MNET_LOOP_WAIT_BATCH];
+    const int count = mnet_loop_wait(&sched->loop, events, MNET_LOOP_WAIT_BATCH,
+                                     sched->ready_head ? 0 : timeout_ms);
+    if (count < 0)
+    {
+#ifdef MNET_UNIX
+        if (errno != EINTR) return -1;
+#else
+        return -1;
+#endif
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        mnet_co_t* co = (mnet_co_t*)events[i].udata;
+        if (!co) continue;
+
+        const uint32_t wanted = (uint32_t)co->wait_events | mnet_loop_err | mnet_loop_hup;
+        if (co->wait_events && co->wait_sock == events[i].sock && (events[i].events & wanted))
+        {
+            co->wait_sock = MNET_INVALID_SOCKET;
+            co->wait_events = 0;
+            mnet_co_ready(co);
+        }
+#ifndef MNET_LINUX
+        else
+        {
+            // the fallback loop is level triggered, stop it from
+            //  reporting until the coroutine waits on the socket again.
+            (void)mnet_loop_mod(&sched->loop, events[i].sock, 0, co);
+            if (co->reg_sock == events[i].sock) co->reg_events = 0;
+        }
+#endif
+    }
+
+    // only run what is ready now, coroutines that yield run next time.
+    mnet_co_t* co = sched->ready_head;
+    sched->ready_head = NULL;
+    sched->ready_tail = NULL;
+
+    int resumed = 0;
+    while (co)
+    {
+        mnet_co_t* next = co->next;
+        co->flags = (uint8_t)(co->flags & ~MNET_CO_QUEUED);
+        resumed++;
+
+        // a finished coroutine may already be freed, don't touch it.
+        if (co->fn(co) == mnet_co_done) sched->count--;
+        co = next;
+    }
+
+    return resumed;
+}
+
+mnet_result_t mnet_co_sched_run(mnet_co_sched_t* sched)
+{
+    if (!sched) return mnet_error;
+
+    while (sched->count > 0)
+    {
+        if (mnet_co_sched_run_once(sched, -1) < 0) return mnet_error;
+    }
+
+    return mnet_ok;
+}
+
+int mnet_co_recv(mnet_co_t* co, mnet_socket_t sock, void* buf, size_t len, mnet_msg_flags_t flags)
+{
+    if (!co) return -1;
+
+    const int received = mnet_recv(sock, buf, len, flags);
+    if (received >= 0 || mnet_get_platform_error() != mnet_ewouldblock) return received;
+    return mnet_co_wait_socket(co, sock, mnet_loop_in);
+}
+
+int mnet_co_send(mnet_co_t* co, mnet_socket_t sock, const void* buf, size_t len, mnet_msg_flags_t flags)
+{
+    if (!co) return -1;
+
+    while (co->progress < len)
+    {
+        const int sent = mnet_send(sock, (const uint8_t*)buf + co->progress, len - co->progress, flags);
+        if (sent < 0)
+        {
+            if (mnet_get_platform_error() == mnet_ewouldblock)
+                return mnet_co_wait_socket(co, sock, mnet_loop_out);
+
+            co->progress = 0;
+            return -1;
+        }
+
+        co->progress += (size_t)sent;
+    }
+
+    co->progress = 0;
+    return (int)len;
+}
+
+int mnet_co_accept(mnet_co_t* co, mnet_socket_t sock, mnet_socket_t* client,
+                   mnet_sockaddr_t* addr, mnet_socklen_t* addrlen)
+{
+    if (!co || !client) return mnet_error;
+
+    const mnet_socket_t accepted = mnet_accept(sock, addr, addrlen);
+    if (mnet_socket_is_valid(accepted))
+    {
+        if (mnet_set_blocking(accepted, 0) != mnet_ok)
+        {
+            mnet_close(accepted);
+            return mnet_error;
+        }
+
+        *client = accepted;
+        return mnet_ok;
+    }
+
+    if (mnet_get_platform_error() != mnet_ewouldblock) return mnet_error;
+    return mnet_co_wait_socket(co, sock, mnet_loop_in);
+}
+
+int mnet_co_sleep(mnet_co_t* co, uint32_t ms)
+{
+    if (!co) return mnet_error;
+
+    if (co->flags & MNET_CO_WOKEN)
+    {
+        co->flags = (uint8_t)(co->flags & ~MNET_CO_WOKEN);
+        return mnet_ok;
+    }
+
+    // resumed early (mnet_co_ready), keep the deadline of the first call.
+    if (mnet_timer_pending(&co->timer)) return MNET_CO_WAIT;
+
+    mnet_timer_start(&co->sched->timers, &co->timer, mnet_time_ms() + ms);
+    return MNET_CO_WAIT;
+}
+
+mnet_result_t mnet_co_close(mnet_co_t* co, mnet_socket_t sock)
+{
+    if (!co) return mnet_error;
+
+    // may never have waited on it.
+    (void)mnet_loop_del(&co->sched->loop, sock);
+
+    if (co->reg_sock == sock)
+    {
+        co->reg_sock = MNET_INVALID_SOCKET;
+        co->reg_events = 0;
+    }
+    if (co->wait_sock == sock)
+    {
+        co->wait_sock = MNET_INVALID_SOCKET;
+        co->wait_events = 0;
+    }
+
+    return mnet_close(sock);
+}
+
+
+// ================================================
+//            COMPLETION I/O (IO_URING)
+//
+
+
+#define MNET_URING_OP_SEND      1
+#define MNET_URING_OP_RECV      2
+#define MNET_URING_OP_SENDV     3
+#define MNET_URING_OP_RECVV     4
+#define MNET_URING_OP_ACCEPT    5
+#define MNET_URING_OP_CONNECT   6
+
+static uint32_t mnet_uring_alloc_op(mnet_uring_t* ring)
+{
+    if (ring->free_op_count == 0) return UINT32_MAX;
+    return ring->free_ops[--ring->free_op_count];
+}
+
+static void mnet_uring_free_op(mnet_uring_t* ring, uint32_t index)
+{
+    ring->free_ops[ring->free_op_count++] = index;
+}
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+
+static int mnet_uring_sys_setup(uint32_t entries, struct io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int mnet_uring_sys_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                                uint32_t flags, const void* arg, size_t argsz)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int mnet_uring_sys_register(int fd, uint32_t opcode, const void* arg, uint32_t nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static mnet_result_t mnet_uring_native_init(mnet_uring_t* ring, uint32_t entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    // room for multishot operations completing more than once.
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 2;
+
+    const int fd = mnet_uring_sys_setup(entries, &params);
+    if (fd < 0) return mnet_error;
+
+    // timed waits rely on IORING_ENTER_EXT_ARG.
+    if (!(params.features & IORING_FEAT_EXT_ARG))
+    {
+        close(fd);
+        return mnet_error;
+    }
+
+    ring->ring_fd = fd;
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    const int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap && ring->cq_map_size > ring->sq_map_size)
+        ring->sq_map_size = ring->cq_map_size;
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) goto fail;
+
+    if (single_mmap)
+    {
+        ring->cq_map = ring->sq_map;
+    }
+    else
+    {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) goto fail;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) goto fail;
+
+    uint8_t* sq = (uint8_t*)ring->sq_map;
+    uint8_t* cq = (uint8_t*)ring->cq_map;
+
+    ring->sq_head       = (uint32_t*)(sq + params.sq_off.head);
+    ring->sq_tail       = (uint32_t*)(sq + params.sq_off.tail);
+    ring->sq_array      = (uint32_t*)(sq + params.sq_off.array);
+    ring->sq_mask       = *(uint32_t*)(sq + params.sq_off.ring_mask);
+    ring->sq_entries    = params.sq_entries;
+    ring->sq_local_tail = *ring->sq_tail;
+
+    ring->cq_head_ptr   = (uint32_t*)(cq + params.cq_off.head);
+    ring->cq_tail_ptr   = (uint32_t*)(cq + params.cq_off.tail);
+    ring->cq_mask       = *(uint32_t*)(cq + params.cq_off.ring_mask);
+    ring->cq_cqes       = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // sqe slots map 1:1 to the submission array.
+    for (uint32_t i = 0; i < ring->sq_entries; i++)
+        ring->sq_array[i] = i;
+
+    ring->op_capacity = params.cq_entries;
+    return mnet_ok;
+
+fail:
+    if (ring->sqes && ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map && ring->sq_map != MAP_FAILED) munmap(ring->sq_map, ring->sq_map_size);
+    close(fd);
+
+    ring->sqes = NULL;
+    ring->cq_map = NULL;
+    ring->sq_map = NULL;
+    ring->ring_fd = -1;
+    return mnet_error;
+}
+
+static void mnet_uring_native_destroy(mnet_uring_t* ring)
+{
+    if (ring->buf_ring) munmap(ring->buf_ring, ring->buf_ring_size);
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map) munmap(ring->sq_map, ring->sq_map_size);
+    if (ring->ring_fd >= 0) close(ring->ring_fd);
+}
+
+static struct io_uring_sqe* mnet_uring_get_sqe(mnet_uring_t* ring)
+{
+    uint32_t head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    if (ring->sq_local_tail - head >= ring->sq_entries)
+    {
+        // queue is full, flush it to the kernel first.
+        if (mnet_uring_submit(ring) < 0) return NULL;
+
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (ring->sq_local_tail - head >= ring->sq_entries) return NULL;
+    }
+
+    struct io_uring_sqe* sqe = &ring->sqes[ring->sq_local_tail & ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_local_tail++;
+    return sqe;
+}
+
+static mnet_result_t mnet_uring_native_queue(mnet_uring_t* ring, uint32_t index)
+{
+    mnet_uring_op_t* op = &ring->ops[index];
+
+    struct io_uring_sqe* sqe = mnet_uring_get_sqe(ring);
+    if (!sqe) return mnet_error;
+
+    sqe->fd = op->sock;
+    sqe->user_data = index;
+    sqe->msg_flags = (uint32_t)op->msg_flags;
+
+    switch (op->type)
+    {
+    case MNET_URING_OP_SEND:
+    case MNET_URING_OP_RECV:
+        sqe->opcode = op->type == MNET_URING_OP_SEND ? IORING_OP_SEND : IORING_OP_RECV;
+        if (op->multishot)
+        {
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = 0;
+        }
+        else
+        {
+            sqe->addr = (uint64_t)(uintptr_t)op->buf;
+            sqe->len = (uint32_t)op->len;
+        }
+        break;
+
+    case MNET_URING_OP_SENDV:
+    case MNET_URING_OP_RECVV:
+        memset(&op->msg, 0, sizeof(op->msg));
+        op->msg.msg_iov = (struct iovec*)op->iov;
+        op->msg.msg_iovlen = (size_t)op->iovcnt;
+
+        sqe->opcode = op->type == MNET_URING_OP_SENDV ? IORING_OP_SENDMSG : IORING_OP_RECVMSG;
+        sqe->addr = (uint64_t)(uintptr_t)&op->msg;
+        sqe->len = 1;
+        break;
+
+    case MNET_URING_OP_ACCEPT:
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->addr = (uint64_t)(uintptr_t)op->addr;
+        sqe->off = (uint64_t)(uintptr_t)op->addrlen;
+        sqe->accept_flags = 0;
+        if (op->multishot) sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        break;
+
+    case MNET_URING_OP_CONNECT:
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->addr = (uint64_t)(uintptr_t)op->addr;
+        sqe->off = (uint64_t)op->len;
+        sqe->msg_flags = 0;
+        break;
+
+    default:
+        return mnet_error;
+    }
+
+    return mnet_ok;
+}
+
+static int mnet_uring_native_reap(mnet_uring_t* ring, mnet_uring_cqe_t* cqes, int max_cqes)
+{
+    uint32_t head = *ring->cq_head_ptr;
+    const uint32_t tail = __atomic_load_n(ring->cq_tail_ptr, __ATOMIC_ACQUIRE);
+    int count = 0;
+
+    while (head != tail && count < max_cqes)
+    {
+        const struct io_uring_cqe* cqe = &ring->cq_cqes[head & ring->cq_mask];
+        const uint32_t index = (uint32_t)cqe->user_data;
+        mnet_uring_cqe_t* out = &cqes[count++];
+
+        out->udata = ring->ops[index].udata;
+        out->res = cqe->res;
+        out->flags = 0;
+        out->buf_id = 0;
+
+        if (cqe->flags & IORING_CQE_F_BUFFER)
+        {
+            out->flags |= mnet_uring_cqe_buffer;
+            out->buf_id = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        }
+
+        if (cqe->flags & IORING_CQE_F_MORE)
+            out->flags |= mnet_uring_cqe_more;
+        else
+            mnet_uring_free_op(ring, index);
+
+        head++;
+    }
+
+    __atomic_store_n(ring->cq_head_ptr, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+static int mnet_uring_native_wait(mnet_uring_t* ring, mnet_uring_cqe_t* cqes, int max_cqes, int timeout)
+{
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    const uint32_t to_submit = ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    int count = mnet_uring_native_reap(ring, cqes, max_cqes);
+    if (count > 0 || timeout == 0)
+    {
+        if (to_submit && mnet_uring_sys_enter(ring->ring_fd, to_submit, 0, 0, NULL, 0) < 0)
+            return count > 0 ? count : -1;
+
+        return count > 0 ? count : mnet_uring_native_reap(ring, cqes, max_cqes);
+    }
+
+    int result;
+    if (timeout > 0)
+    {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (long long)(timeout % 1000) * 1000000;
+
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+
+        result = mnet_uring_sys_enter(ring->ring_fd, to_submit, 1,
+                                      IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                      &arg, sizeof(arg));
+    }
+    else
+    {
+        result = mnet_uring_sys_enter(ring->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    }
+
+    if (result < 0 && errno != ETIME && errno != EINTR) return -1;
+    return mnet_uring_native_reap(ring, cqes, max_cqes);
+}
+
+#endif
+
+static void mnet_uring_fallback_push(mnet_uring_t* ring, void* udata, int res, uint32_t flags, uint16_t buf_id)
+{
+    mnet_uring_cqe_t* cqe = &ring->cqes[(ring->cq_head + ring->cq_count) % (ring->op_capacity * 2)];
+    cqe->udata = udata;
+    cqe->res = res;
+    cqe->flags = flags;
+    cqe->buf_id = buf_id;
+    ring->cq_count++;
+}
+
+static int mnet_uring_fallback_would_block(int res)
+{
+    return res < 0 && (-res == (int)mnet_ewouldblock || -res == EAGAIN);
+}
+
+// runs a ready operation, returns 1 if it stays pending.
+static int mnet_uring_fallback_exec(mnet_uring_t* ring, uint32_t index)
+{
+    mnet_uring_op_t* op = &ring->ops[index];
+    int res = 0;
+
+    switch (op->type)
+    {
+    case MNET_URING_OP_SEND:
+        res = mnet_send(op->sock, op->buf, op->len, (mnet_msg_flags_t)op->msg_flags);
+        break;
+
+    case MNET_URING_OP_RECV:
+        if (op->multishot)
+        {
+            if (ring->free_buf_count == 0)
+            {
+                mnet_uring_fallback_push(ring, op->udata, -(int)mnet_enobufs, 0, 0);
+                return 0;
+            }
+
+            const uint16_t buf_id = ring->free_bufs[--ring->free_buf_count];
+            res = mnet_recv(op->sock, mnet_uring_buffer(ring, buf_id), ring->buf_size,
+                            (mnet_msg_flags_t)op->msg_flags);
+            if (res < 0) res = -(int)mnet_get_platform_error();
+
+            if (res <= 0)
+            {
+                ring->free_bufs[ring->free_buf_count++] = buf_id;
+                if (mnet_uring_fallback_would_block(res)) return 1;
+
+                mnet_uring_fallback_push(ring, op->udata, res, 0, 0);
+                return 0;
+            }
+
+            mnet_uring_fallback_push(ring, op->udata, res,
+                                     mnet_uring_cqe_more | mnet_uring_cqe_buffer, buf_id);
+            return 1;
+        }
+
+        res = mnet_recv(op->sock, op->buf, op->len, (mnet_msg_flags_t)op->msg_flags);
+        break;
+
+    case MNET_URING_OP_SENDV:
+        res = mnet_sendv(op->sock, op->iov, op->iovcnt, (mnet_msg_flags_t)op->msg_flags);
+        break;
+
+    case MNET_URING_OP_RECVV:
+        res = mnet_recvv(op->sock, op->iov, op->iovcnt, (mnet_msg_flags_t)op->msg_flags);
+        break;
+
+    case MNET_URING_OP_ACCEPT:
+    {
+        const mnet_socket_t client = mnet_accept(op->sock, op->addr, op->addrlen);
+        res = mnet_socket_is_valid(client) ? (int)client : -1;
+        break;
+    }
+
+    case MNET_URING_OP_CONNECT:
+    {
+        int err = 0;
+        mnet_socklen_t err_len = sizeof(err);
+        if (mnet_getsockopt(op->sock, mnet_sol_socket, mnet_so_error, &err, &err_len) != 0)
+            res = -1;
+        else
+            res = err ? -err : 0;
+
+        mnet_uring_fallback_push(ring, op->udata, res, 0, 0);
+        return 0;
+    }
+
+    default:
+        return 0;
+    }
+
+    if (res < 0) res = -(int)mnet_get_platform_error();
+    if (mnet_uring_fallback_would_block(res)) return 1;
+
+    if (op->multishot && res >= 0)
+    {
+        mnet_uring_fallback_push(ring, op->udata, res, mnet_uring_cqe_more, 0);
+        return 1;
+    }
+
+    mnet_uring_fallback_push(ring, op->udata, res, 0, 0);
+    return 0;
+}
+
+static int mnet_uring_fallback_wait(mnet_uring_t* ring, mnet_uring_cqe_t* cqes, int max_cqes, int timeout)
+{
+    if (ring->cq_count == 0 && ring->pending_count > 0)
+    {
+        for (uint32_t i = 0; i < ring->pending_count; i++)
+        {
+            const mnet_uring_op_t* op = &ring->ops[ring->pending[i]];
+            const int out = op->type == MNET_URING_OP_SEND || op->type == MNET_URING_OP_SENDV
+                         || op->type == MNET_URING_OP_CONNECT;
+
+            ring->pfds[i].fd = op->sock;
+            ring->pfds[i].events = out ? POLLOUT : POLLIN;
+            ring->pfds[i].revents = 0;
+        }
+
+        const int ready = mnet_poll(ring->pfds, (int)ring->pending_count, timeout);
+        if (ready < 0) return -1;
+
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < ring->pending_count; i++)
+        {
+            const uint32_t index = ring->pending[i];
+
+            // every op pushes at most one completion per pass.
+            const int has_room = ring->cq_count < ring->op_capacity * 2;
+            const int stays = ring->pfds[i].revents && has_room
+                            ? mnet_uring_fallback_exec(ring, index)
+                            : 1;
+
+            if (stays)
+                ring->pending[kept++] = index;
+            else
+                mnet_uring_free_op(ring, index);
+        }
+        ring->pending_count = kept;
+    }
+
+    int count = 0;
+    while (ring->cq_count > 0 && count < max_cqes)
+    {
+        cqes[count++] = ring->cqes[ring->cq_head];
+        ring->cq_head = (ring->cq_head + 1) % (ring->op_capacity * 2);
+        ring->cq_count--;
+    }
+
+    return count;
+}
+
+static mnet_result_t mnet_uring_queue(mnet_uring_t* ring, const mnet_uring_op_t* op)
+{
+    if (!ring) return mnet_error;
+
+    const uint32_t index = mnet_uring_alloc_op(ring);
+    if (index == UINT32_MAX) return mnet_error;
+
+    ring->ops[index] = *op;
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    if (ring->native)
+    {
+        if (mnet_uring_native_queue(ring, index) != mnet_ok)
+        {
+            mnet_uring_free_op(ring, index);
+            return mnet_error;
+        }
+        return mnet_ok;
+    }
+#endif
+
+    if (op->type == MNET_URING_OP_CONNECT)
+    {
+        // a connect can complete right here, its completion needs room
+        //  before it is started. (the unreaped ones are never overwritten)
+        if (ring->cq_count >= ring->op_capacity * 2)
+        {
+            mnet_uring_free_op(ring, index);
+#ifdef MNET_WINDOWS
+            WSASetLastError(WSAENOBUFS);
+#else
+            errno = ENOBUFS;
+#endif
+            return mnet_error;
+        }
+
+        // start the connect now, nonblocking sockets finish once writable.
+        if (mnet_connect(op->sock, op->addr, (mnet_socklen_t)op->len) == 0)
+        {
+            mnet_uring_fallback_push(ring, op->udata, 0, 0, 0);
+            mnet_uring_free_op(ring, index);
+            return mnet_ok;
+        }
+
+        const mnet_error_t err = mnet_get_platform_error();
+        if (err != mnet_einprogress && err != mnet_ewouldblock)
+        {
+            mnet_uring_fallback_push(ring, op->udata, -(int)err, 0, 0);
+            mnet_uring_free_op(ring, index);
+            return mnet_ok;
+        }
+    }
+
+    ring->pending[ring->pending_count++] = index;
+    return mnet_ok;
+}
+
+mnet_result_t mnet_uring_init(mnet_uring_t* ring, uint32_t entries)
+{
+    if (!ring || entries == 0) return mnet_error;
+    memset(ring, 0, sizeof(*ring));
+
+    uint32_t size = 8;
+    while (size < entries && size < 32768) size <<= 1;
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    ring->ring_fd = -1;
+    if (mnet_uring_native_init(ring, size) == mnet_ok)
+        ring->native = 1;
+#endif
+
+    if (!ring->native)
+    {
+        ring->op_capacity = size;
+        ring->pending = (uint32_t*)malloc(size * sizeof(uint32_t));
+        ring->pfds = (mnet_pollfd_t*)malloc(size * sizeof(mnet_pollfd_t));
+        ring->cqes = (mnet_uring_cqe_t*)malloc(size * 2 * sizeof(mnet_uring_cqe_t));
+    }
+
+    ring->ops = (mnet_uring_op_t*)calloc(ring->op_capacity, sizeof(mnet_uring_op_t));
+    ring->free_ops = (uint32_t*)malloc(ring->op_capacity * sizeof(uint32_t));
+
+    if (!ring->ops || !ring->free_ops || (!ring->native && (!ring->pending || !ring->pfds || !ring->cqes)))
+    {
+        mnet_uring_destroy(ring);
+        return mnet_error;
+    }
+
+    for (uint32_t i = 0; i < ring->op_capacity; i++)
+        ring->free_ops[i] = ring->op_capacity - 1 - i;
+    ring->free_op_count = ring->op_capacity;
+
+    return mnet_ok;
+}
+
+void mnet_uring_destroy(mnet_uring_t* ring)
+{
+    if (!ring) return;
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    if (ring->native) mnet_uring_native_destroy(ring);
+#endif
+
+    free(ring->ops);
+    free(ring->free_ops);
+    free(ring->pending);
+    free(ring->pfds);
+    free(ring->cqes);
+    free(ring->bufs);
+    free(ring->free_bufs);
+    memset(ring, 0, sizeof(*ring));
+}
+
+int mnet_uring_is_native(const mnet_uring_t* ring)
+{
+    return ring ? ring->native : 0;
+}
+
+mnet_result_t mnet_uring_setup_buffers(mnet_uring_t* ring, uint16_t count, uint32_t size)
+{
+    if (!ring || ring->bufs || count == 0 || size == 0) return mnet_error;
+    if ((count & (count - 1)) != 0 || count > 32768) return mnet_error;
+
+    ring->bufs = (uint8_t*)malloc((size_t)count * size);
+    if (!ring->bufs) return mnet_error;
+    ring->buf_count = count;
+    ring->buf_size = size;
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    if (ring->native)
+    {
+        ring->buf_ring_size = (size_t)count * sizeof(struct io_uring_buf);
+        void* mem = mmap(NULL, ring->buf_ring_size, PROT_READ | PROT_WRITE,
+                         MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        if (mem == MAP_FAILED) goto fail;
+        ring->buf_ring = (struct io_uring_buf*)mem;
+
+        struct io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+        reg.ring_entries = count;
+        reg.bgid = 0;
+
+        if (mnet_uring_sys_register(ring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            munmap(ring->buf_ring, ring->buf_ring_size);
+            ring->buf_ring = NULL;
+            goto fail;
+        }
+
+        for (uint16_t i = 0; i < count; i++)
+        {
+            ring->buf_ring[i].addr = (uint64_t)(uintptr_t)(ring->bufs + (size_t)i * size);
+            ring->buf_ring[i].len = size;
+            ring->buf_ring[i].bid = i;
+        }
+
+        // the ring tail overlays the reserved field of the first entry.
+        __atomic_store_n(&ring->buf_ring[0].resv, count, __ATOMIC_RELEASE);
+        return mnet_ok;
+    }
+#endif
+
+    ring->free_bufs = (uint16_t*)malloc(count * sizeof(uint16_t));
+    if (!ring->free_bufs) goto fail;
+
+    for (uint16_t i = 0; i < count; i++)
+        ring->free_bufs[i] = (uint16_t)(count - 1 - i);
+    ring->free_buf_count = count;
+    return mnet_ok;
+
+fail:
+    free(ring->bufs);
+    ring->bufs = NULL;
+    ring->buf_count = 0;
+    return mnet_error;
+}
+
+void* mnet_uring_buffer(const mnet_uring_t* ring, uint16_t buf_id)
+{
+    if (!ring || !ring->bufs || buf_id >= ring->buf_count) return NULL;
+    return ring->bufs + (size_t)buf_id * ring->buf_size;
+}
+
+void mnet_uring_recycle_buffer(mnet_uring_t* ring, uint16_t buf_id)
+{
+    if (!ring || !ring->bufs || buf_id >= ring->buf_count) return;
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    if (ring->native)
+    {
+        const uint16_t tail = __atomic_load_n(&ring->buf_ring[0].resv, __ATOMIC_RELAXED);
+        struct io_uring_buf* buf = &ring->buf_ring[tail & (ring->buf_count - 1)];
+
+        buf->addr = (uint64_t)(uintptr_t)(ring->bufs + (size_t)buf_id * ring->buf_size);
+        buf->len = ring->buf_size;
+        buf->bid = buf_id;
+
+        __atomic_store_n(&ring->buf_ring[0].resv, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+        return;
+    }
+#endif
+
+    ring->free_bufs[ring->free_buf_count++] = buf_id;
+}
+
+mnet_result_t mnet_uring_send(mnet_uring_t* ring, mnet_socket_t sock, const void* buf, size_t len,
+                              mnet_msg_flags_t flags, void* udata)
+{
+    mnet_uring_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type = MNET_URING_OP_SEND;
+    op.sock = sock;
+    op.buf = (void*)buf;
+    op.len = len;
+    op.msg_flags = (int)flags;
+    op.udata = udata;
+    return mnet_uring_queue(ring, &op);
+}
+
+mnet_result_t mnet_uring_recv(mnet_uring_t* ring, mnet_socket_t sock, void* buf, size_t len,
+                              mnet_msg_flags_t flags, void* udata)
+{
+    mnet_uring_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type = MNET_URING_OP_RECV;
+    op.sock = sock;
+    op.buf = buf;
+    op.len = len;
+    op.msg_flags = (int)flags;
+    op.udata = udata;
+    return mnet_uring_queue(ring, &op);
+}
+
+mnet_result_t mnet_uring_sendv(mnet_uring_t* ring, mnet_socket_t sock, const mnet_iovec_t* iov, int iovcnt,
+                               mnet_msg_flags_t flags, void* udata)
+{
+    if (!iov || iovcnt <= 0) return mnet_error;
+
+    mnet_uring_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type = MNET_URING_OP_SENDV;
+    op.sock = sock;
+    op.iov = (mnet_iovec_t*)iov;
+    op.iovcnt = iovcnt;
+    op.msg_flags = (int)flags;
+    op.udata = udata;
+    return mnet_uring_queue(ring, &op);
+}
+
+mnet_result_t mnet_uring_recvv(mnet_uring_t* ring, mnet_socket_t sock, mnet_iovec_t* iov, int iovcnt,
+                               mnet_msg_flags_t flags, void* udata)
+{
+    if (!iov || iovcnt <= 0) return mnet_error;
+
+    mnet_uring_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type = MNET_URING_OP_RECVV;
+    op.sock = sock;
+    op.iov = iov;
+    op.iovcnt = iovcnt;
+    op.msg_flags = (int)flags;
+    op.udata = udata;
+    return mnet_uring_queue(ring, &op);
+}
+
+mnet_result_t mnet_uring_accept(mnet_uring_t* ring, mnet_socket_t sock, mnet_sockaddr_t* addr,
+                                mnet_socklen_t* addrlen, void* udata)
+{
+    mnet_uring_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type = MNET_URING_OP_ACCEPT;
+    op.sock = sock;
+    op.addr = addr;
+    op.addrlen = addrlen;
+    op.udata = udata;
+    return mnet_uring_queue(ring, &op);
+}
+
+mnet_result_t mnet_uring_connect(mnet_uring_t* ring, mnet_socket_t sock, const mnet_sockaddr_t* addr,
+                                 mnet_socklen_t addrlen, void* udata)
+{
+    if (!addr) return mnet_error;
+
+    mnet_uring_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type = MNET_URING_OP_CONNECT;
+    op.sock = sock;
+    op.addr = (mnet_sockaddr_t*)addr;
+    op.len = (size_t)addrlen;
+    op.udata = udata;
+    return mnet_uring_queue(ring, &op);
+}
+
+mnet_result_t mnet_uring_accept_multishot(mnet_uring_t* ring, mnet_socket_t sock, void* udata)
+{
+    mnet_uring_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type = MNET_URING_OP_ACCEPT;
+    op.multishot = 1;
+    op.sock = sock;
+    op.udata = udata;
+    return mnet_uring_queue(ring, &op);
+}
+
+mnet_result_t mnet_uring_recv_multishot(mnet_uring_t* ring, mnet_socket_t sock, void* udata)
+{
+    if (!ring || !ring->bufs) return mnet_error;
+
+    mnet_uring_op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type = MNET_URING_OP_RECV;
+    op.multishot = 1;
+    op.sock = sock;
+    op.udata = udata;
+    return mnet_uring_queue(ring, &op);
+}
+
+int mnet_uring_submit(mnet_uring_t* ring)
+{
+    if (!ring) return -1;
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    if (ring->native)
+    {
+        __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+        const uint32_t to_submit = ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if (to_submit == 0) return 0;
+
+        return mnet_uring_sys_enter(ring->ring_fd, to_submit, 0, 0, NULL, 0);
+    }
+#endif
+
+    // the fallback runs operations from mnet_uring_wait.
+    return (int)ring->pending_count;
+}
+
+int mnet_uring_wait(mnet_uring_t* ring, mnet_uring_cqe_t* cqes, int max_cqes, int timeout)
+{
+    if (!ring || !cqes || max_cqes <= 0) return -1;
+
+#if defined(MNET_LINUX) && defined(MNET_IO_URING)
+    if (ring->native) return mnet_uring_native_wait(ring, cqes, max_cqes, timeout);
+#endif
+
+    return mnet_uring_fallback_wait(ring, cqes, max_cqes, timeout);
+}
+
+
+// ================================================
+//           ADDRESS AND NAME RESOLUTION
+//
+
+
+int mnet_getsockname(mnet_socket_t sock, mnet_sockaddr_t* addr, mnet_socklen_t* addrlen)
+{
+    return getsockname(sock, addr, addrlen);
+}
+
+int mnet_getpeername(mnet_socket_t sock, mnet_sockaddr_t* addr, mnet_socklen_t* addrlen)
+{
+    return getpeername(sock, addr, addrlen);
+}
+
+int mnet_getaddrinfo(const char* node, const char* service,
+                     const struct addrinfo* hints, struct addrinfo** res)
+{
+    return getaddrinfo(node, service, hints, res);
+}
+
+void mnet_freeaddrinfo(struct addrinfo* res)
+{
+    freeaddrinfo(res);
+}
+
+int mnet_getnameinfo(const mnet_sockaddr_t* addr, mnet_socklen_t addrlen,
+                     char* host, mnet_socklen_t hostlen,
+                     char* serv, mnet_socklen_t servlen, int flags)
+{
+#ifdef MNET_WINDOWS
+    return getnameinfo(addr, addrlen, host, (DWORD)hostlen, serv, (DWORD)servlen, flags);
+#elif defined(MNET_UNIX)
+    return getnameinfo(addr, addrlen, host, hostlen, serv, servlen, flags);
+#endif
+}
+
+int mnet_inet_pton(mnet_address_family_t af, const char* src, void* dst)
+{
+#ifdef MNET_WINDOWS
+    return InetPtonA((int)af, src, dst);
+#elif defined(MNET_UNIX)
+    return inet_pton((int)af, src, dst);
+#endif
+}
+
+const char* mnet_inet_ntop(mnet_address_family_t af, const void* src, char* dst, mnet_socklen_t size)
+{
+#ifdef MNET_WINDOWS
+    return InetNtopA((int)af, (void*)src, dst, (size_t)size);
+#elif defined(MNET_UNIX)
+    return inet_ntop((int)af, src, dst, size);
+#endif
+}
+
+
+// ================================================
+//              ADDRESS UTILITIES
+//
+
+
+mnet_result_t mnet_get_family(const mnet_sockaddr_t* addr, mnet_address_family_t* out_family)
+{
+    if (!addr || !out_family) return mnet_error;
+    *out_family = (mnet_address_family_t)addr->sa_family;
+    return mnet_ok;
+}
+
+int mnet_addr_ip_to_string(
+    const mnet_sockaddr_t* addr,
+    char ip_buf[],
+    size_t ip_buf_size)
+{
+    if (!addr || !ip_buf) return mnet_error;
+
+    char tmp[MNET_IP_STRLEN];
+    int len;
+
+    if (addr->sa_family == AF_INET)
+    {
+        const mnet_sockaddr_in_t* addr_in = (const mnet_sockaddr_in_t*)addr;
+        len = mnet_ipv4_format((const uint8_t*)&addr_in->sin_addr, tmp);
+    }
+    else if (addr->sa_family == AF_INET6)
+    {
+        const mnet_sockaddr_in6_t* addr_in6 = (const mnet_sockaddr_in6_t*)addr;
+        len = mnet_ipv6_format((const uint8_t*)&addr_in6->sin6_addr, tmp);
+    }
+    else return mnet_error;
+
+    if ((size_t)len + 1 > ip_buf_size) return mnet_error;
+    memcpy(ip_buf, tmp, (size_t)len + 1);
+    return mnet_ok;
+}
+
+int mnet_addr_to_string(
+    const mnet_sockaddr_t* addr,
+    char ip_buf[],
+    size_t ip_buf_size,
+    uint16_t port)
+{
+    mnet_endpoint_t ep;
+    if (!ip_buf || mnet_endpoint_from_sockaddr(&ep, addr) != mnet_ok) return mnet_error;
+
+    ep.port = port;
+    return mnet_endpoint_to_string(&ep, ip_buf, ip_buf_size) < 0 ? mnet_error : mnet_ok;
+}
+
+int mnet_addr_set_port(mnet_sockaddr_t* addr, uint16_t port)
+{
+    if (!addr) return mnet_error;
+
+    if (addr->sa_family == AF_INET)
+    {
+        mnet_sockaddr_in_t* addr_in = (mnet_sockaddr_in_t*)addr;
+        addr_in->sin_port = mnet_htons(port);
+        return mnet_ok;
+    }
+    else if (addr->sa_family == AF_INET6)
+    {
+        mnet_sockaddr_in6_t* addr_in6 = (mnet_sockaddr_in6_t*)addr;
+        addr_in6->sin6_port = mnet_htons(port);
+        return mnet_ok;
+    }
+
+    return mnet_error;
+}
+
+
+// ================================================
+//              ENDPOINTS
+//
+
+
+mnet_result_t mnet_endpoint_from_sockaddr(mnet_endpoint_t* ep, const mnet_sockaddr_t* addr)
+{
+    if (!ep || !addr) return mnet_error;
+    memset(ep, 0, sizeof(*ep));
+
+    if (addr->sa_family == AF_INET)
+    {
+        const mnet_sockaddr_in_t* addr_in = (const mnet_sockaddr_in_t*)addr;
+        memcpy(ep->addr, &addr_in->sin_addr, 4);
+        ep->port = mnet_ntohs(addr_in->sin_port);
+        ep->family = MNET_ENDPOINT_IPV4;
+        return mnet_ok;
+    }
+    else if (addr->sa_family == AF_INET6)
+    {
+        const mnet_sockaddr_in6_t* addr_in6 = (const mnet_sockaddr_in6_t*)addr;
+        memcpy(ep->addr, &addr_in6->sin6_addr, 16);
+        ep->port = mnet_ntohs(addr_in6->sin6_port);
+        ep->family = MNET_ENDPOINT_IPV6;
+        return mnet_ok;
+    }
+
+    return mnet_error;
+}
+
+mnet_socklen_t mnet_endpoint_to_sockaddr(const mnet_endpoint_t* ep, mnet_sockaddr_storage* out)
+{
+    if (!ep || !out) return 0;
+    memset(out, 0, sizeof(*out));
+
+    if (ep->family == MNET_ENDPOINT_IPV4)
+    {
+        mnet_sockaddr_in_t* addr_in = (mnet_sockaddr_in_t*)out;
+        addr_in->sin_family = AF_INET;
+        addr_in->sin_port = mnet_htons(ep->port);
+        memcpy(&addr_in->sin_addr, ep->addr, 4);
+        return (mnet_socklen_t)sizeof(*addr_in);
+    }
+    else if (ep->family == MNET_ENDPOINT_IPV6)
+    {
+        mnet_sockaddr_in6_t* addr_in6 = (mnet_sockaddr_in6_t*)out;
+        addr_in6->sin6_family = AF_INET6;
+        addr_in6->sin6_port = mnet_htons(ep->port);
+        memcpy(&addr_in6->sin6_addr, ep->addr, 16);
+        return (mnet_socklen_t)sizeof(*addr_in6);
+    }
+
+    return 0;
+}
+
+uint64_t mnet_endpoint_hash(const mnet_endpoint_t* ep)
+{
+    // the struct is 2 words + 4 bytes, fold them with multiply-xorshift rounds.
+    uint64_t a, b;
+    uint32_t c;
+    memcpy(&a, (const uint8_t*)ep, 8);
+    memcpy(&b, (const uint8_t*)ep + 8, 8);
+    memcpy(&c, (const uint8_t*)ep + 16, 4);
+
+    uint64_t h = (a ^ 0x9e3779b97f4a7c15ull) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 31) ^ b) * 0x94d049bb133111ebull;
+    h = (h ^ (h >> 29) ^ c) * 0xbf58476d1ce4e5b9ull;
+    return h ^ (h >> 32);
+}
+
+int mnet_endpoint_equal(const mnet_endpoint_t* a, const mnet_endpoint_t* b)
+{
+    uint64_t a0, a1, b0, b1;
+    uint32_t a2, b2;
+    memcpy(&a0, (const uint8_t*)a, 8);
+    memcpy(&a1, (const uint8_t*)a + 8, 8);
+    memcpy(&a2, (const uint8_t*)a + 16, 4);
+    memcpy(&b0, (const uint8_t*)b, 8);
+    memcpy(&b1, (const uint8_t*)b + 8, 8);
+    memcpy(&b2, (const uint8_t*)b + 16, 4);
+    return ((a0 ^ b0) | (a1 ^ b1) | (uint64_t)(a2 ^ b2)) == 0;
+}
+
+mnet_result_t mnet_ipv4_parse(const char* src, size_t len, uint8_t out[4])
+{
+    if (!src || !out) return mnet_error;
+
+    size_t pos = 0;
+    for (int part = 0; part < 4; part++)
+    {
+        if (part > 0)
+        {
+            if (pos >= len || src[pos] != '.') return mnet_error;
+            pos++;
+        }
+
+        const size_t start = pos;
+        unsigned value = 0;
+        while (pos < len && src[pos] >= '0' && src[pos] <= '9' && pos - start < 3)
+            value = value * 10 + (unsigned)(src[pos++] - '0');
+
+        // no empty parts, no leading zeros, like inet_pton.
+        if (pos == start || value > 255 || (src[start] == '0' && pos - start > 1)) return mnet_error;
+        out[part] = (uint8_t)value;
+    }
+
+    return pos == len ? mnet_ok : mnet_error;
+}
+
+static int mnet_hex_value(char c)
+{
+    // one unsigned compare per range.
+    const unsigned u = (unsigned char)c;
+    if (u - '0' < 10) return (int)(u - '0');
+    const unsigned lower = u | 0x20;
+    if (lower - 'a' < 6) return (int)(lower - 'a' + 10);
+    return -1;
+}
+
+mnet_result_t mnet_ipv6_parse(const char* src, size_t len, uint8_t out[16])
+{
+    if (!src || !out) return mnet_error;
+
+    uint8_t addr[16];
+    int groups = 0;
+    int gap = -1;   // group index of "::".
+    size_t pos = 0;
+
+    if (len >= 2 && src[0] == ':' && src[1] == ':')
+    {
+        gap = 0;
+        pos = 2;
+    }
+    else if (len > 0 && src[0] == ':') return mnet_error;
+
+    while (pos < len)
+    {
+        if (groups == 8) return mnet_error;
+
+        const size_t start = pos;
+        unsigned value = 0;
+        int digit;
+        while (pos < len && pos - start < 4 && (digit = mnet_hex_value(src[pos])) >= 0)
+        {
+            value = (value << 4) | (unsigned)digit;
+            pos++;
+        }
+        if (pos == start) return mnet_error;
+
+        if (pos < len && src[pos] == '.')
+        {
+            // trailing dotted IPv4 part takes the last two groups.
+            if (groups > 6) return mnet_error;
+            if (mnet_ipv4_parse(src + start, len - start, addr + groups * 2) != mnet_ok) return mnet_error;
+            groups += 2;
+            pos = len;
+            break;
+        }
+
+        addr[groups * 2] = (uint8_t)(value >> 8);
+        addr[groups * 2 + 1] = (uint8_t)value;
+        groups++;
+
+        if (pos == len) break;
+        if (src[pos] != ':') return mnet_error;
+        pos++;
+
+        if (pos < len && src[pos] == ':')
+        {
+            if (gap >= 0) return mnet_error;
+            gap = groups;
+            pos++;
+        }
+        else if (pos == len) return mnet_error;
+    }
+
+    if (gap >= 0)
+    {
+        if (groups == 8) return mnet_error;
+
+        const int tail = groups - gap;
+        memset(out, 0, 16);
+        memcpy(out, addr, (size_t)gap * 2);
+        memcpy(out + 16 - tail * 2, addr + gap * 2, (size_t)tail * 2);
+        return mnet_ok;
+    }
+
+    if (groups != 8) return mnet_error;
+    memcpy(out, addr, 16);
+    return mnet_ok;
+}
+
+static char* mnet_format_u8(char* dst, unsigned value)
+{
+    if (value >= 100)
+    {
+        *dst++ = (char)('0' + value / 100);
+        value %= 100;
+        *dst++ = (char)('0' + value / 10);
+    }
+    else if (value >= 10)
+    {
+        *dst++ = (char)('0' + value / 10);
+    }
+    *dst++ = (char)('0' + value % 10);
+    return dst;
+}
+
+int mnet_ipv4_format(const uint8_t addr[4], char* dst)
+{
+    char* p = dst;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i) *p++ = '.';
+        p = mnet_format_u8(p, addr[i]);
+    }
+    *p = '\0';
+    return (int)(p - dst);
+}
+
+int mnet_ipv6_format(const uint8_t addr[16], char* dst)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    // IPv4-mapped addresses keep the dotted part. (::ffff:1.2.3.4)
+    static const uint8_t mapped[12] = { 0,0,0,0, 0,0,0,0, 0,0,0xff,0xff };
+    if (memcmp(addr, mapped, 12) == 0)
+    {
+        memcpy(dst, "::ffff:", 7);
+        return 7 + mnet_ipv4_format(addr + 12, dst + 7);
+    }
+
+    // longest run of at least two zero groups, the first one on a tie.
+    int best = -1, best_len = 0;
+    for (int i = 0; i < 8;)
+    {
+        if (addr[i * 2] | addr[i * 2 + 1]) { i++; continue; }
+        int j = i;
+        while (j < 8 && !(addr[j * 2] | addr[j * 2 + 1])) j++;
+        if (j - i > best_len) { best = i; best_len = j - i; }
+        i = j;
+    }
+    if (best_len < 2) best = -1;
+
+    char* p = dst;
+    for (int i = 0; i < 8; i++)
+    {
+        if (i == best)
+        {
+            *p++ = ':';
+            *p++ = ':';
+            i += best_len - 1;
+            continue;
+        }
+        if (i && i != best + best_len) *p++ = ':';
+
+        const unsigned group = ((unsigned)addr[i * 2] << 8) | addr[i * 2 + 1];
+        int shift = 12;
+        while (shift > 0 && !((group >> shift) & 0xF)) shift -= 4;
+        for (; shift >= 0; shift -= 4) *p++ = hex[(group >> shift) & 0xF];
+    }
+    *p = '\0';
+    return (int)(p - dst);
+}
+
+mnet_result_t mnet_endpoint_parse(mnet_endpoint_t* ep, const char* str)
+{
+    if (!ep || !str) return mnet_error;
+    memset(ep, 0, sizeof(*ep));
+
+    const size_t len = strlen(str);
+    size_t addr_start = 0, addr_end = len;
+    const char* port = NULL;
+    int ipv6;
+
+    if (len > 0 && str[0] == '[')
+    {
+        const char* close = memchr(str, ']', len);
+        if (!close) return mnet_error;
+        addr_start = 1;
+        addr_end = (size_t)(close - str);
+        if (close[1] == ':') port = close + 2;
+        else if (close[1] != '\0') return mnet_error;
+        ipv6 = 1;
+    }
+    else
+    {
+        const char* colon = memchr(str, ':', len);
+        ipv6 = colon && memchr(colon + 1, ':', len - (size_t)(colon - str) - 1) != NULL;
+        if (colon && !ipv6)
+        {
+            addr_end = (size_t)(colon - str);
+            port = colon + 1;
+        }
+    }
+
+    if (port)
+    {
+        unsigned value = 0;
+        if (*port == '\0') return mnet_error;
+        for (const char* p = port; *p; p++)
+        {
+            if (*p < '0' || *p > '9' || p - port >= 5) return mnet_error;
+            value = value * 10 + (unsigned)(*p - '0');
+        }
+        if (value > 65535) return mnet_error;
+        ep->port = (uint16_t)value;
+    }
+
+    if (ipv6)
+    {
+        if (mnet_ipv6_parse(str + addr_start, addr_end - addr_start, ep->addr) != mnet_ok) return mnet_error;
+        ep->family = MNET_ENDPOINT_IPV6;
+    }
+    else
+    {
+        if (mnet_ipv4_parse(str + addr_start, addr_end - addr_start, ep->addr) != mnet_ok) return mnet_error;
+        ep->family = MNET_ENDPOINT_IPV4;
+    }
+    return mnet_ok;
+}
+
+int mnet_endpoint_to_string(const mnet_endpoint_t* ep, char* buf, size_t size)
+{
+    char tmp[MNET_ADDR_STRLEN];
+    char* p = tmp;
+
+    if (!ep || !buf) return -1;
+
+    if (ep->family == MNET_ENDPOINT_IPV4)
+    {
+        p += mnet_ipv4_format(ep->addr, p);
+    }
+    else if (ep->family == MNET_ENDPOINT_IPV6)
+    {
+        *p++ = '[';
+        p += mnet_ipv6_format(ep->addr, p);
+        *p++ = ']';
+    }
+    else return -1;
+
+    *p++ = ':';
+    unsigned port = ep->port;
+    char digits[5];
+    int n = 0;
+    do { digits[n++] = (char)('0' + port % 10); port /= 10; } while (port);
+    while (n) *p++ = digits[--n];
+
+    const size_t len = (size_t)(p - tmp);
+    if (len + 1 > size) return -1;
+    memcpy(buf, tmp, len);
+    buf[len] = '\0';
+    return (int)len;
+}
+
+
+// ================================================
+//                      TIME
+//
+
+uint64_t mnet_time_ns(void)
+{
+#ifdef MNET_WINDOWS
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    const uint64_t ticks = (uint64_t)counter.QuadPart;
+    const uint64_t freq = (uint64_t)frequency.QuadPart;
+    return ticks / freq * 1000000000ull + ticks % freq * 1000000000ull / freq;
+#elif defined(MNET_UNIX)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+uint64_t mnet_time_ms(void)
+{
+    return mnet_time_ns() / 1000000ull;
+}
+
+uint64_t mnet_time_wall_ns(void)
+{
+#ifdef MNET_WINDOWS
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+
+    // 100ns ticks since 1601.
+    const uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | (uint64_t)ft.dwLowDateTime;
+    return (ticks - 116444736000000000ull) * 100ull;
+#elif defined(MNET_UNIX)
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+// ================================================
+//                  ERROR HANDLING
+//
+
+
+mnet_error_t mnet_get_platform_error(void)
+{
+#ifdef MNET_WINDOWS
+    return (mnet_error_t)WSAGetLastError();
+#elif defined(MNET_UNIX)
+    return (mnet_error_t)errno;
+#endif
+}
+
+const char* mnet_error_string(
+    const mnet_error_t error_code)
+{
+#ifdef MNET_WINDOWS
+    static char buf[256];
+    FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                   NULL, (DWORD)error_code, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                   buf, sizeof(buf), NULL);
+    return buf;
+#elif defined(MNET_UNIX)
+    return strerror(error_code);
+#endif
+}
+
+void mnet_error_string_r(mnet_error_t error_code, char* buf, size_t bufsize)
+{
+#ifdef MNET_WINDOWS
+    FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                   NULL, (DWORD)error_code, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                   buf, (DWORD)bufsize, NULL);
+#elif defined(MNET_UNIX)
+    if (!buf || bufsize == 0) return;
+#   if defined(__GLIBC__) && defined(_GNU_SOURCE)
+    // GNU strerror_r may return a static string instead of filling buf.
+    const char* str = strerror_r(error_code, buf, bufsize);
+    if (str != buf)
+    {
+        strncpy(buf, str, bufsize - 1);
+        buf[bufsize - 1] = '\0';
+    }
+#   else
+    strerror_r(error_code, buf, bufsize);
+#   endif
+#endif
+}
+
+
+// ================================================
+//              ADDRESS CREATORS
+//
+
+
+int mnet_addr_ipv4(struct sockaddr_in *addr, const char *ip, uint16_t port)
+{
+    if (!addr) return -1;
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+
+    if (!ip || strcmp(ip, "0.0.0.0") == 0)
+    {
+        addr->sin_addr.s_addr = INADDR_ANY;
+        return 0;
+    }
+
+    return mnet_ipv4_parse(ip, strlen(ip), (uint8_t*)&addr->sin_addr) == mnet_ok ? 0 : -1;
+}
+
+int mnet_addr_ipv6(struct sockaddr_in6 *addr, const char *ip, uint16_t port)
+{
+    if (!addr) return -1;
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin6_family = AF_INET6;
+    addr->sin6_port = htons(port);
+
+    if (!ip || strcmp(ip, "::") == 0)
+    {
+        addr->sin6_addr = in6addr_any;
+        return 0;
+    }
+
+    return mnet_ipv6_parse(ip, strlen(ip), (uint8_t*)&addr->sin6_addr) == mnet_ok ? 0 : -1;
+}
+
+int mnet_addr_any_ipv4(struct sockaddr_in *addr, uint16_t port)
+{
+    return mnet_addr_ipv4(addr, NULL, port);
+}
+
+int mnet_addr_any_ipv6(struct sockaddr_in6 *addr, uint16_t port)
+{
+    return mnet_addr_ipv6(addr, NULL, port);
+}
+
+
+// ================================================
+//              THREADING PRIMITIVES
+//
+
+
+#if defined(_MSC_VER)
+#   define MNET_THREAD_LOCAL __declspec(thread)
+#else
+#   define MNET_THREAD_LOCAL __thread
+#endif
+
+static uint32_t mnet_atomic_add_u32(volatile uint32_t* value, int32_t delta)
+{
+#if defined(_MSC_VER)
+    return (uint32_t)InterlockedAdd((volatile LONG*)value, (LONG)delta);
+#else
+    return __atomic_add_fetch(value, (uint32_t)delta, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static uint32_t mnet_atomic_load_u32(const volatile uint32_t* value)
+{
+#if defined(_MSC_VER)
+    return (uint32_t)InterlockedOr((volatile LONG*)value, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void mnet_spin_lock(volatile int* lock)
+{
+#if defined(_MSC_VER)
+    while (InterlockedExchange((volatile LONG*)lock, 1) != 0)
+        while (*lock) YieldProcessor();
+#else
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0)
+        while (__atomic_load_n(lock, __ATOMIC_RELAXED)) { }
+#endif
+}
+
+static void mnet_spin_unlock(volatile int* lock)
+{
+#if defined(_MSC_VER)
+    InterlockedExchange((volatile LONG*)lock, 0);
+#else
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+typedef struct mnet_thread_start
+{
+    void (*fn)(void* arg);
+    void* arg;
+} mnet_thread_start_t;
+
+#ifdef MNET_WINDOWS
+static DWORD WINAPI mnet_thread_main(LPVOID param)
+#else
+static void* mnet_thread_main(void* param)
+#endif
+{
+    mnet_thread_start_t start = *(mnet_thread_start_t*)param;
+    free(param);
+    start.fn(start.arg);
+#ifdef MNET_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+mnet_result_t mnet_thread_create(mnet_thread_t* thread, void (*fn)(void* arg), void* arg)
+{
+    if (!thread || !fn) return mnet_error;
+
+    mnet_thread_start_t* start = (mnet_thread_start_t*)malloc(sizeof(mnet_thread_start_t));
+    if (!start) return mnet_error;
+    start->fn = fn;
+    start->arg = arg;
+
+#ifdef MNET_WINDOWS
+    *thread = CreateThread(NULL, 0, mnet_thread_main, start, 0, NULL);
+    if (*thread) return mnet_ok;
+#else
+    if (pthread_create(thread, NULL, mnet_thread_main, start) == 0) return mnet_ok;
+#endif
+
+    free(start);
+    return mnet_error;
+}
+
+mnet_result_t mnet_thread_join(mnet_thread_t thread)
+{
+#ifdef MNET_WINDOWS
+    if (WaitForSingleObject(thread, INFINITE) != WAIT_OBJECT_0) return mnet_error;
+    CloseHandle(thread);
+    return mnet_ok;
+#else
+    return pthread_join(thread, NULL) == 0 ? mnet_ok : mnet_error;
+#endif
+}
+
+mnet_result_t mnet_thread_pin(int cpu)
+{
+    if (cpu < 0) return mnet_error;
+
+#ifdef MNET_WINDOWS
+    if (cpu >= (int)(sizeof(DWORD_PTR) * 8)) return mnet_error;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) ? mnet_ok : mnet_error;
+#elif defined(MNET_LINUX)
+    if (cpu >= CPU_SETSIZE) return mnet_error;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((size_t)cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? mnet_ok : mnet_error;
+#else
+    return mnet_error;
+#endif
+}
+
+int mnet_cpu_count(void)
+{
+#ifdef MNET_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+
+// ================================================
+//          INSTRUMENTATION
+//
+
+
+// owner-thread counters that another thread may read: a relaxed load
+//  and store compile to a plain add, but keep the reader well defined.
+#if defined(_MSC_VER)
+#   define MNET_STATS_ADD(field, n)     (*(volatile uint64_t*)&(field) += (uint64_t)(n))
+#   define MNET_STATS_READ(field)       (*(volatile const uint64_t*)&(field))
+#   define MNET_STATS_WRITE(field, v)   (*(volatile uint64_t*)&(field) = (uint64_t)(v))
+#else
+#   define MNET_STATS_ADD(field, n)     __atomic_store_n(&(field), __atomic_load_n(&(field), __ATOMIC_RELAXED) + (uint64_t)(n), __ATOMIC_RELAXED)
+#   define MNET_STATS_READ(field)       __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#   define MNET_STATS_WRITE(field, v)   __atomic_store_n(&(field), (uint64_t)(v), __ATOMIC_RELAXED)
+#endif
+
+static int mnet_histogram_index(uint64_t value)
+{
+    const uint64_t limit = ((uint64_t)1 << MNET_HISTOGRAM_MAX_BITS) - 1;
+    if (value > limit) value = limit;
+    if (value < ((uint64_t)1 << MNET_HISTOGRAM_SUB_BITS)) return (int)value;
+
+    int msb = 63;
+#if defined(__GNUC__) || defined(__clang__)
+    msb = 63 - __builtin_clzll(value);
+#else
+    while (!(value >> msb)) msb--;
+#endif
+
+    const int shift = msb - MNET_HISTOGRAM_SUB_BITS;
+    const int sub = (int)((value >> shift) & ((1u << MNET_HISTOGRAM_SUB_BITS) - 1));
+    return ((shift + 1) << MNET_HISTOGRAM_SUB_BITS) + sub;
+}
+
+static uint64_t mnet_histogram_upper(int index)
+{
+    const int subs = 1 << MNET_HISTOGRAM_SUB_BITS;
+    if (index < subs) return (uint64_t)index;
+
+    const int shift = (index >> MNET_HISTOGRAM_SUB_BITS) - 1;
+    const uint64_t sub = (uint64_t)(index & (subs - 1));
+    return (((uint64_t)subs + sub + 1) << shift) - 1;
+}
+
+void mnet_histogram_init(mnet_histogram_t* hist)
+{
+    if (!hist) return;
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void mnet_histogram_record(mnet_histogram_t* hist, uint64_t value)
+{
+    if (!hist) return;
+
+    MNET_STATS_ADD(hist->buckets[mnet_histogram_index(value)], 1);
+    MNET_STATS_ADD(hist->count, 1);
+    MNET_STATS_ADD(hist->sum, value);
+    if (value < hist->min) MNET_STATS_WRITE(hist->min, value);
+    if (value > hist->max) MNET_STATS_WRITE(hist->max, value);
+}
+
+void mnet_histogram_merge(mnet_histogram_t* dst, const mnet_histogram_t* src)
+{
+    if (!dst || !src) return;
+
+    for (int i = 0; i < MNET_HISTOGRAM_BUCKETS; i++) dst->buckets[i] += MNET_STATS_READ(src->buckets[i]);
+    dst->count += MNET_STATS_READ(src->count);
+    dst->sum += MNET_STATS_READ(src->sum);
+
+    const uint64_t min = MNET_STATS_READ(src->min);
+    const uint64_t max = MNET_STATS_READ(src->max);
+    if (min < dst->min) dst->min = min;
+    if (max > dst->max) dst->max = max;
+}
+
+uint64_t mnet_histogram_percentile(const mnet_histogram_t* hist, double percentile)
+{
+    if (!hist || hist->count == 0) return 0;
+    if (percentile < 0.0) percentile = 0.0;
+    if (percentile > 100.0) percentile = 100.0;
+
+    uint64_t rank = (uint64_t)((percentile / 100.0) * (double)hist->count + 0.5);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < MNET_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += hist->buckets[i];
+        if (seen >= rank)
+        {
+            const uint64_t upper = mnet_histogram_upper(i);
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+double mnet_histogram_mean(const mnet_histogram_t* hist)
+{
+    if (!hist || hist->count == 0) return 0.0;
+    return (double)hist->sum / (double)hist->count;
+}
+
+#ifdef MNET_STATS
+
+typedef struct mnet_stats_block
+{
+    struct mnet_stats_block*    next;
+    mnet_stats_t                stats;
+} mnet_stats_block_t;
+
+static mnet_stats_block_t*                  mnet_stats_blocks = NULL;
+static volatile int                         mnet_stats_lock = 0;
+static MNET_THREAD_LOCAL mnet_stats_block_t* mnet_stats_local = NULL;
+
+// per-socket counters, a cache line each, in pages allocated on first use.
+#define MNET_STATS_PAGE_SIZE        1024
+#define MNET_STATS_PAGE_COUNT       ((MNET_STATS_MAX_SOCKETS + MNET_STATS_PAGE_SIZE - 1) / MNET_STATS_PAGE_SIZE)
+
+typedef union mnet_stats_socket_slot
+{
+    mnet_socket_stats_t     stats;
+    uint8_t                 line[64];
+} mnet_stats_socket_slot_t;
+
+static void*                                mnet_stats_pages[MNET_STATS_PAGE_COUNT];
+
+static mnet_stats_t* mnet_stats_thread(void)
+{
+    if (mnet_stats_local) return &mnet_stats_local->stats;
+
+    // blocks outlive their thread, so the totals keep what it did.
+    mnet_stats_block_t* block = (mnet_stats_block_t*)malloc(sizeof(*block));
+    if (!block) return NULL;
+
+    memset(block, 0, sizeof(*block));
+    for (int i = 0; i < mnet_op_count; i++) mnet_histogram_init(&block->stats.op_time[i]);
+    mnet_histogram_init(&block->stats.rtt);
+
+    mnet_spin_lock(&mnet_stats_lock);
+    block->next = mnet_stats_blocks;
+    mnet_stats_blocks = block;
+    mnet_spin_unlock(&mnet_stats_lock);
+
+    mnet_stats_local = block;
+    return &block->stats;
+}
+
+static mnet_socket_stats_t* mnet_stats_slot(mnet_socket_t sock, int create)
+{
+#ifdef MNET_WINDOWS
+    const size_t index = (size_t)sock / 4;
+#else
+    const size_t index = (size_t)sock;
+#endif
+    if (sock == MNET_INVALID_SOCKET || index >= MNET_STATS_MAX_SOCKETS) return NULL;
+
+    void** entry = &mnet_stats_pages[index / MNET_STATS_PAGE_SIZE];
+#if defined(_MSC_VER)
+    void* page = *(void* volatile*)entry;
+#else
+    void* page = __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+#endif
+
+    if (!page && create)
+    {
+        // one spare line to align the slots on, pages live as long as the process.
+        void* fresh = calloc(MNET_STATS_PAGE_SIZE + 1, sizeof(mnet_stats_socket_slot_t));
+        if (!fresh) return NULL;
+
+        // another thread may have published the page first.
+#if defined(_MSC_VER)
+        page = InterlockedCompareExchangePointer((PVOID volatile*)entry, fresh, NULL);
+        if (!page) page = fresh;
+        else free(fresh);
+#else
+        if (__atomic_compare_exchange_n(entry, &page, fresh, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            page = fresh;
+        else
+            free(fresh);
+#endif
+    }
+    if (!page) return NULL;
+
+    mnet_stats_socket_slot_t* slots = (mnet_stats_socket_slot_t*)(((uintptr_t)page + 63) & ~(uintptr_t)63);
+    return &slots[index % MNET_STATS_PAGE_SIZE].stats;
+}
+
+static void mnet_stats_socket_reset(mnet_socket_t sock)
+{
+    mnet_socket_stats_t* slot = mnet_stats_slot(sock, 1);
+    if (!slot) return;
+
+    MNET_STATS_WRITE(slot->bytes_sent, 0);
+    MNET_STATS_WRITE(slot->bytes_received, 0);
+    MNET_STATS_WRITE(slot->sends, 0);
+    MNET_STATS_WRITE(slot->receives, 0);
+    MNET_STATS_WRITE(slot->wouldblock, 0);
+    MNET_STATS_WRITE(slot->errors, 0);
+}
+
+static void mnet_stats_record(mnet_op_t op, mnet_socket_t sock, int result, uint64_t start_ns)
+{
+    const uint64_t elapsed = mnet_time_ns() - start_ns;
+    const int is_send = op == mnet_op_send || op == mnet_op_sendto || op == mnet_op_sendv;
+    int wouldblock = 0;
+    if (result < 0) wouldblock = mnet_get_platform_error() == mnet_ewouldblock;
+
+    mnet_stats_t* stats = mnet_stats_thread();
+    if (stats)
+    {
+        mnet_op_stats_t* counters = &stats->ops[op];
+        MNET_STATS_ADD(counters->calls, 1);
+        if (result > 0) MNET_STATS_ADD(counters->bytes, result);
+        else if (result < 0 && wouldblock) MNET_STATS_ADD(counters->wouldblock, 1);
+        else if (result < 0) MNET_STATS_ADD(counters->errors, 1);
+        mnet_histogram_record(&stats->op_time[op], elapsed);
+    }
+
+    // the socket's own line, plain adds like the thread blocks.
+    mnet_socket_stats_t* slot = mnet_stats_slot(sock, 1);
+    if (slot)
+    {
+        if (is_send) MNET_STATS_ADD(slot->sends, 1);
+        else MNET_STATS_ADD(slot->receives, 1);
+
+        if (result > 0 && is_send) MNET_STATS_ADD(slot->bytes_sent, result);
+        else if (result > 0) MNET_STATS_ADD(slot->bytes_received, result);
+        else if (result < 0 && wouldblock) MNET_STATS_ADD(slot->wouldblock, 1);
+        else if (result < 0) MNET_STATS_ADD(slot->errors, 1);
+    }
+    else if (stats)
+    {
+        MNET_STATS_ADD(stats->untracked, 1);
+    }
+}
+
+mnet_result_t mnet_stats_snapshot(mnet_stats_t* out)
+{
+    if (!out) return mnet_error;
+
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < mnet_op_count; i++) mnet_histogram_init(&out->op_time[i]);
+    mnet_histogram_init(&out->rtt);
+
+    mnet_spin_lock(&mnet_stats_lock);
+    for (const mnet_stats_block_t* block = mnet_stats_blocks; block; block = block->next)
+    {
+        for (int i = 0; i < mnet_op_count; i++)
+        {
+            const mnet_op_stats_t* src = &block->stats.ops[i];
+            out->ops[i].calls += MNET_STATS_READ(src->calls);
+            out->ops[i].bytes += MNET_STATS_READ(src->bytes);
+            out->ops[i].wouldblock += MNET_STATS_READ(src->wouldblock);
+            out->ops[i].errors += MNET_STATS_READ(src->errors);
+            mnet_histogram_merge(&out->op_time[i], &block->stats.op_time[i]);
+        }
+        mnet_histogram_merge(&out->rtt, &block->stats.rtt);
+        out->untracked += MNET_STATS_READ(block->stats.untracked);
+    }
+    mnet_spin_unlock(&mnet_stats_lock);
+
+    return mnet_ok;
+}
+
+mnet_result_t mnet_stats_socket(mnet_socket_t sock, mnet_socket_stats_t* out)
+{
+    const mnet_socket_stats_t* slot = mnet_stats_slot(sock, 1);
+    if (!slot || !out) return mnet_error;
+
+    out->bytes_sent = MNET_STATS_READ(slot->bytes_sent);
+    out->bytes_received = MNET_STATS_READ(slot->bytes_received);
+    out->sends = MNET_STATS_READ(slot->sends);
+    out->receives = MNET_STATS_READ(slot->receives);
+    out->wouldblock = MNET_STATS_READ(slot->wouldblock);
+    out->errors = MNET_STATS_READ(slot->errors);
+    return mnet_ok;
+}
+
+void mnet_stats_record_rtt(uint64_t ns)
+{
+    mnet_stats_t* stats = mnet_stats_thread();
+    if (stats) mnet_histogram_record(&stats->rtt, ns);
+}
+
+#else
+
+mnet_result_t mnet_stats_snapshot(mnet_stats_t* out)
+{
+    if (out) memset(out, 0, sizeof(*out));
+    return mnet_error;
+}
+
+mnet_result_t mnet_stats_socket(mnet_socket_t sock, mnet_socket_stats_t* out)
+{
+    (void)sock;
+    if (out) memset(out, 0, sizeof(*out));
+    return mnet_error;
+}
+
+void mnet_stats_record_rtt(uint64_t ns)
+{
+    (void)ns;
+}
+
+#endif
+
+
+// ================================================
+//          CROSS-THREAD QUEUE & WAKEUP
+//
+
+
+void mnet_mpsc_init(mnet_mpsc_t* queue)
+{
+    if (queue) queue->head = NULL;
+}
+
+int mnet_mpsc_push(mnet_mpsc_t* queue, mnet_mpsc_node_t* node)
+{
+    if (!queue || !node) return 0;
+
+#if defined(_MSC_VER)
+    mnet_mpsc_node_t* head;
+    do
+    {
+        head = queue->head;
+        node->next = head;
+    } while (InterlockedCompareExchangePointer((PVOID volatile*)&queue->head, node, head) != head);
+#else
+    mnet_mpsc_node_t* head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    do
+    {
+        node->next = head;
+    } while (!__atomic_compare_exchange_n(&queue->head, &head, node, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+#endif
+
+    return head == NULL;
+}
+
+mnet_mpsc_node_t* mnet_mpsc_take_all(mnet_mpsc_t* queue)
+{
+    if (!queue) return NULL;
+
+    // the consumer takes the whole stack, no node is ever popped
+    //  alone so there is no ABA problem.
+#if defined(_MSC_VER)
+    mnet_mpsc_node_t* node = (mnet_mpsc_node_t*)InterlockedExchangePointer((PVOID volatile*)&queue->head, NULL);
+#else
+    mnet_mpsc_node_t* node = __atomic_exchange_n(&queue->head, NULL, __ATOMIC_ACQUIRE);
+#endif
+
+    mnet_mpsc_node_t* ordered = NULL;
+    while (node)
+    {
+        mnet_mpsc_node_t* next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+    }
+    return ordered;
+}
+
+mnet_result_t mnet_wakeup_init(mnet_wakeup_t* wakeup)
+{
+    if (!wakeup) return mnet_error;
+    wakeup->rd = MNET_INVALID_SOCKET;
+    wakeup->wr = MNET_INVALID_SOCKET;
+    wakeup->pending = 0;
+
+#if defined(MNET_LINUX)
+    wakeup->rd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup->rd < 0) return mnet_error;
+    wakeup->wr = wakeup->rd;
+    return mnet_ok;
+#elif defined(MNET_UNIX)
+    int fds[2];
+    if (pipe(fds) != 0) return mnet_error;
+
+    wakeup->rd = fds[0];
+    wakeup->wr = fds[1];
+    if (mnet_set_blocking(fds[0], 0) != mnet_ok || mnet_set_blocking(fds[1], 0) != mnet_ok)
+    {
+        mnet_wakeup_destroy(wakeup);
+        return mnet_error;
+    }
+    return mnet_ok;
+#else
+    // no pipes for WSAPoll, use a loopback UDP socket sending to itself.
+    mnet_sockaddr_in_t addr;
+    mnet_socklen_t addrlen = sizeof(addr);
+
+    wakeup->rd = mnet_socket(mnet_af_inet, mnet_sock_dgram, mnet_ipproto_udp);
+    if (wakeup->rd == MNET_INVALID_SOCKET) return mnet_error;
+    wakeup->wr = wakeup->rd;
+
+    if (mnet_addr_ipv4(&addr, "127.0.0.1", 0) != mnet_ok
+     || mnet_bind(wakeup->rd, (mnet_sockaddr_t*)&addr, sizeof(addr)) != mnet_ok
+     || mnet_getsockname(wakeup->rd, (mnet_sockaddr_t*)&addr, &addrlen) != mnet_ok
+     || mnet_connect(wakeup->rd, (mnet_sockaddr_t*)&addr, addrlen) != mnet_ok
+     || mnet_set_blocking(wakeup->rd, 0) != mnet_ok)
+    {
+        mnet_wakeup_destroy(wakeup);
+        return mnet_error;
+    }
+    return mnet_ok;
+#endif
+}
+
+void mnet_wakeup_destroy(mnet_wakeup_t* wakeup)
+{
+    if (!wakeup) return;
+
+#if defined(MNET_UNIX)
+    if (wakeup->wr != wakeup->rd && wakeup->wr != MNET_INVALID_SOCKET) close(wakeup->wr);
+    if (wakeup->rd != MNET_INVALID_SOCKET) close(wakeup->rd);
+#else
+    if (wakeup->rd != MNET_INVALID_SOCKET) mnet_close(wakeup->rd);
+#endif
+
+    wakeup->rd = MNET_INVALID_SOCKET;
+    wakeup->wr = MNET_INVALID_SOCKET;
+}
+
+mnet_socket_t mnet_wakeup_socket(const mnet_wakeup_t* wakeup)
+{
+    return wakeup ? wakeup->rd : MNET_INVALID_SOCKET;
+}
+
+void mnet_wakeup_signal(mnet_wakeup_t* wakeup)
+{
+    if (!wakeup) return;
+
+#if defined(_MSC_VER)
+    if (InterlockedExchange((volatile LONG*)&wakeup->pending, 1) != 0) return;
+#else
+    if (__atomic_exchange_n(&wakeup->pending, 1, __ATOMIC_SEQ_CST) != 0) return;
+#endif
+
+#if defined(MNET_LINUX)
+    const uint64_t one = 1;
+    if (write(wakeup->wr, &one, sizeof(one)) < 0) { }
+#elif defined(MNET_UNIX)
+    const uint8_t one = 1;
+    if (write(wakeup->wr, &one, sizeof(one)) < 0) { }
+#else
+    const uint8_t one = 1;
+    mnet_send(wakeup->wr, &one, sizeof(one), 0);
+#endif
+}
+
+void mnet_wakeup_drain(mnet_wakeup_t* wakeup)
+{
+    if (!wakeup) return;
+
+    // empty the socket before clearing pending. the other way around a
+    //  signal written in between is eaten here while pending stays set,
+    //  and every later signal is skipped. a signal that still sees
+    //  pending set here pushed its work before, the consumer takes it
+    //  after this returns.
+#if defined(MNET_LINUX)
+    uint64_t value;
+    if (read(wakeup->rd, &value, sizeof(value)) < 0) { }
+#elif defined(MNET_UNIX)
+    uint8_t buf[64];
+    while (read(wakeup->rd, buf, sizeof(buf)) > 0) { }
+#else
+    uint8_t buf[64];
+    while (mnet_recv(wakeup->rd, buf, sizeof(buf), 0) > 0) { }
+#endif
+
+#if defined(_MSC_VER)
+    InterlockedExchange((volatile LONG*)&wakeup->pending, 0);
+#else
+    __atomic_store_n(&wakeup->pending, 0, __ATOMIC_SEQ_CST);
+#endif
+}
+
+
+// ================================================
+//                  WORKER POOL
+//
+
+
+#define MNET_POOL_DEQUE_MASK ((int64_t)MNET_POOL_DEQUE_SIZE - 1)
+
+static MNET_THREAD_LOCAL mnet_pool_worker_t* mnet_pool_self = NULL;
+
+static int64_t mnet_pool_load(const volatile int64_t* value, int order)
+{
+#if defined(_MSC_VER)
+    (void)order;
+    const int64_t v = *value;
+    MemoryBarrier();
+    return v;
+#else
+    return __atomic_load_n(value, order);
+#endif
+}
+
+static void mnet_pool_store(volatile int64_t* value, int64_t v, int order)
+{
+#if defined(_MSC_VER)
+    (void)order;
+    MemoryBarrier();
+    *value = v;
+#else
+    __atomic_store_n(value, v, order);
+#endif
+}
+
+static int mnet_pool_cas(volatile int64_t* value, int64_t expected, int64_t desired)
+{
+#if defined(_MSC_VER)
+    return InterlockedCompareExchange64((volatile LONG64*)value, desired, expected) == expected;
+#else
+    return __atomic_compare_exchange_n(value, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+#endif
+}
+
+static void mnet_pool_fence(void)
+{
+#if defined(_MSC_VER)
+    MemoryBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+static mnet_job_t* mnet_pool_slot_load(mnet_job_t** slot)
+{
+#if defined(_MSC_VER)
+    return *(mnet_job_t* volatile*)slot;
+#else
+    return __atomic_load_n(slot, __ATOMIC_RELAXED);
+#endif
+}
+
+static void mnet_pool_slot_store(mnet_job_t** slot, mnet_job_t* job)
+{
+#if defined(_MSC_VER)
+    *(mnet_job_t* volatile*)slot = job;
+#else
+    __atomic_store_n(slot, job, __ATOMIC_RELAXED);
+#endif
+}
+
+// Chase-Lev deque, after Le et al. "Correct and efficient
+//  work-stealing for weak memory models". (owner pushes and pops
+//  at the bottom, thieves take from the top)
+static int mnet_pool_push(mnet_pool_worker_t* worker, mnet_job_t* job)
+{
+    const int64_t b = mnet_pool_load(&worker->bottom, __ATOMIC_RELAXED);
+    const int64_t t = mnet_pool_load(&worker->top, __ATOMIC_ACQUIRE);
+    if (b - t >= MNET_POOL_DEQUE_SIZE) return 0;
+
+    mnet_pool_slot_store(&worker->jobs[b & MNET_POOL_DEQUE_MASK], job);
+    mnet_pool_store(&worker->bottom, b + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static mnet_job_t* mnet_pool_pop(mnet_pool_worker_t* worker)
+{
+    const int64_t b = mnet_pool_load(&worker->bottom, __ATOMIC_RELAXED) - 1;
+    mnet_pool_store(&worker->bottom, b, __ATOMIC_RELAXED);
+    mnet_pool_fence();
+    int64_t t = mnet_pool_load(&worker->top, __ATOMIC_RELAXED);
+
+    if (t > b)
+    {
+        mnet_pool_store(&worker->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    mnet_job_t* job = mnet_pool_slot_load(&worker->jobs[b & MNET_POOL_DEQUE_MASK]);
+    if (t == b)
+    {
+        // last job, race the thieves for it.
+        if (!mnet_pool_cas(&worker->top, t, t + 1)) job = NULL;
+        mnet_pool_store(&worker->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return job;
+}
+
+static mnet_job_t* mnet_pool_steal(mnet_pool_worker_t* victim)
+{
+    const int64_t t = mnet_pool_load(&victim->top, __ATOMIC_ACQUIRE);
+    mnet_pool_fence();
+    const int64_t b = mnet_pool_load(&victim->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return NULL;
+
+    mnet_job_t* job = mnet_pool_slot_load(&victim->jobs[t & MNET_POOL_DEQUE_MASK]);
+    return mnet_pool_cas(&victim->top, t, t + 1) ? job : NULL;
+}
+
+static void mnet_pool_lock(mnet_pool_t* pool)
+{
+#ifdef MNET_WINDOWS
+    EnterCriticalSection(&pool->lock);
+#else
+    pthread_mutex_lock(&pool->lock);
+#endif
+}
+
+static void mnet_pool_unlock(mnet_pool_t* pool)
+{
+#ifdef MNET_WINDOWS
+    LeaveCriticalSection(&pool->lock);
+#else
+    pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+static void mnet_pool_notify(mnet_pool_t* pool, int all)
+{
+    mnet_pool_fence();
+    if (!all && mnet_atomic_load_u32(&pool->sleepers) == 0) return;
+
+    mnet_pool_lock(pool);
+#ifdef MNET_WINDOWS
+    if (all) WakeAllConditionVariable(&pool->cond);
+    else WakeConditionVariable(&pool->cond);
+#else
+    if (all) pthread_cond_broadcast(&pool->cond);
+    else pthread_cond_signal(&pool->cond);
+#endif
+    mnet_pool_unlock(pool);
+}
+
+static int mnet_pool_has_work(mnet_pool_t* pool)
+{
+#if defined(_MSC_VER)
+    if (*(mnet_mpsc_node_t* volatile*)&pool->inject.head) return 1;
+#else
+    if (__atomic_load_n(&pool->inject.head, __ATOMIC_SEQ_CST)) return 1;
+#endif
+
+    for (int i = 0; i < pool->count; i++)
+    {
+        mnet_pool_worker_t* w = &pool->workers[i];
+        if (mnet_pool_load(&w->top, __ATOMIC_SEQ_CST) < mnet_pool_load(&w->bottom, __ATOMIC_SEQ_CST)) return 1;
+    }
+    return 0;
+}
+
+static mnet_job_t* mnet_pool_find(mnet_pool_worker_t* self)
+{
+    mnet_pool_t* pool = self->pool;
+
+    mnet_job_t* job = mnet_pool_pop(self);
+    if (job) return job;
+
+    // move injected jobs into the own deque, where others can steal them.
+    mnet_mpsc_node_t* node = mnet_mpsc_take_all(&pool->inject);
+    while (node)
+    {
+        mnet_mpsc_node_t* next = node->next;
+        if (!mnet_pool_push(self, (mnet_job_t*)node))
+        {
+            // deque full, hand the rest back.
+            while (node)
+            {
+                next = node->next;
+                mnet_mpsc_push(&pool->inject, node);
+                node = next;
+            }
+            break;
+        }
+        node = next;
+    }
+
+    job = mnet_pool_pop(self);
+    if (job) return job;
+
+    // random start so thieves spread over the victims. (xorshift)
+    self->rng ^= self->rng << 13;
+    self->rng ^= self->rng >> 17;
+    self->rng ^= self->rng << 5;
+
+    const int start = (int)(self->rng % (uint32_t)pool->count);
+    for (int i = 0; i < pool->count; i++)
+    {
+        mnet_pool_worker_t* victim = &pool->workers[(start + i) % pool->count];
+        if (victim == self) continue;
+
+        job = mnet_pool_steal(victim);
+        if (job) return job;
+    }
+    return NULL;
+}
+
+static void mnet_pool_complete(mnet_job_t* job, mnet_pool_port_t* port)
+{
+    if (!port) return;
+
+    mnet_mpsc_push(&port->queue, &job->node);
+    if (port->wakeup) mnet_wakeup_signal(port->wakeup);
+}
+
+static void mnet_pool_main(void* arg)
+{
+    mnet_pool_worker_t* self = (mnet_pool_worker_t*)arg;
+    mnet_pool_t* pool = self->pool;
+    mnet_pool_self = self;
+
+    while (mnet_atomic_load_u32((const volatile uint32_t*)&pool->running))
+    {
+        mnet_job_t* job = mnet_pool_find(self);
+        if (job)
+        {
+            // without a port run may free the job, read it first.
+            mnet_pool_port_t* port = job->port;
+            job->run(job);
+            mnet_pool_complete(job, port);
+            continue;
+        }
+
+        // announce the sleep, then look again so a submit in between is not missed.
+        mnet_pool_lock(pool);
+        mnet_atomic_add_u32(&pool->sleepers, 1);
+        mnet_pool_fence();
+
+        if (!mnet_pool_has_work(pool) && mnet_atomic_load_u32((const volatile uint32_t*)&pool->running))
+        {
+#ifdef MNET_WINDOWS
+            SleepConditionVariableCS(&pool->cond, &pool->lock, INFINITE);
+#else
+            pthread_cond_wait(&pool->cond, &pool->lock);
+#endif
+        }
+
+        mnet_atomic_add_u32(&pool->sleepers, -1);
+        mnet_pool_unlock(pool);
+    }
+
+    mnet_pool_self = NULL;
+}
+
+mnet_result_t mnet_pool_init(mnet_pool_t* pool, int threads)
+{
+    if (!pool || threads < 0) return mnet_error;
+    memset(pool, 0, sizeof(*pool));
+
+    if (threads == 0) threads = mnet_cpu_count();
+    if (threads > MNET_POOL_MAX_THREADS) threads = MNET_POOL_MAX_THREADS;
+
+    pool->workers = (mnet_pool_worker_t*)calloc((size_t)threads, sizeof(mnet_pool_worker_t));
+    if (!pool->workers) return mnet_error;
+
+    mnet_mpsc_init(&pool->inject);
+    pool->running = 1;
+
+#ifdef MNET_WINDOWS
+    InitializeCriticalSection(&pool->lock);
+    InitializeConditionVariable(&pool->cond);
+#else
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+#endif
+
+    // all deques exist before any worker looks for a victim.
+    pool->count = threads;
+    for (int i = 0; i < threads; i++)
+    {
+        mnet_pool_worker_t* worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->rng = 0x9E3779B9u * (uint32_t)(i + 1);
+        worker->jobs = (mnet_job_t**)calloc(MNET_POOL_DEQUE_SIZE, sizeof(mnet_job_t*));
+        if (!worker->jobs) break;
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        mnet_pool_worker_t* worker = &pool->workers[i];
+        if (!worker->jobs || mnet_thread_create(&worker->thread, mnet_pool_main, worker) != mnet_ok)
+        {
+            mnet_pool_destroy(pool);
+            return mnet_error;
+        }
+        worker->started = 1;
+    }
+
+    return mnet_ok;
+}
+
+void mnet_pool_destroy(mnet_pool_t* pool)
+{
+    if (!pool || !pool->workers) return;
+
+#if defined(_MSC_VER)
+    InterlockedExchange((volatile LONG*)&pool->running, 0);
+#else
+    __atomic_store_n(&pool->running, 0, __ATOMIC_SEQ_CST);
+#endif
+    mnet_pool_notify(pool, 1);
+
+    for (int i = 0; i < pool->count; i++)
+    {
+        if (pool->workers[i].started) mnet_thread_join(pool->workers[i].thread);
+        free(pool->workers[i].jobs);
+    }
+
+#ifdef MNET_WINDOWS
+    DeleteCriticalSection(&pool->lock);
+#else
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->cond);
+#endif
+
+    free(pool->workers);
+    memset(pool, 0, sizeof(*pool));
+}
+
+mnet_result_t mnet_pool_submit(mnet_pool_t* pool, mnet_job_t* job, mnet_pool_port_t* port)
+{
+    if (!pool || !pool->workers || !job || !job->run) return mnet_error;
+
+    job->port = port;
+    job->node.next = NULL;
+
+    mnet_pool_worker_t* self = mnet_pool_self;
+    if (!self || self->pool != pool || !mnet_pool_push(self, job))
+        mnet_mpsc_push(&pool->inject, &job->node);
+
+    mnet_pool_notify(pool, 0);
+    return mnet_ok;
+}
+
+void mnet_pool_port_init(mnet_pool_port_t* port, mnet_wakeup_t* wakeup)
+{
+    if (!port) return;
+    mnet_mpsc_init(&port->queue);
+    port->wakeup = wakeup;
+}
+
+int mnet_pool_port_dispatch(mnet_pool_port_t* port)
+{
+    if (!port) return 0;
+
+    int count = 0;
+    mnet_mpsc_node_t* node = mnet_mpsc_take_all(&port->queue);
+    while (node)
+    {
+        mnet_job_t* job = (mnet_job_t*)node;
+        node = node->next;
+
+        if (job->done) job->done(job);
+        count++;
+    }
+    return count;
+}
+
+
+// ================================================
+//                  BUFFER POOL
+//
+
+
+#define MNET_BUFPOOL_SLAB_SIZE      (2u * 1024u * 1024u)
+
+typedef struct mnet_bufpool_slab
+{
+    struct mnet_bufpool_slab*   next;
+    size_t                      size;
+} mnet_bufpool_slab_t;
+
+typedef struct mnet_bufpool_cache
+{
+    uint32_t        id;
+    uint32_t        counts[MNET_BUFPOOL_MAX_CLASSES];
+    mnet_buf_t*     heads[MNET_BUFPOOL_MAX_CLASSES];
+} mnet_bufpool_cache_t;
+
+static MNET_THREAD_LOCAL mnet_bufpool_cache_t mnet_bufpool_caches[MNET_BUFPOOL_MAX_POOLS];
+static volatile uint32_t mnet_bufpool_live[MNET_BUFPOOL_MAX_POOLS];
+static volatile uint32_t mnet_bufpool_next_id = 0;
+static volatile int mnet_bufpool_registry_lock = 0;
+
+static void* mnet_bufpool_map(size_t size, uint32_t flags)
+{
+#ifdef MNET_WINDOWS
+    (void)flags;
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    (void)flags;
+
+#   if defined(MNET_LINUX) && defined(MAP_HUGETLB)
+    if (flags & mnet_bufpool_hugepages)
+    {
+        void* huge = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (huge != MAP_FAILED) return huge;
+    }
+#   endif
+
+    void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return NULL;
+
+#   if defined(MNET_LINUX) && defined(MADV_HUGEPAGE)
+    // no reserved huge pages, ask for transparent ones instead.
+    if (flags & mnet_bufpool_hugepages) madvise(mem, size, MADV_HUGEPAGE);
+#   endif
+    return mem;
+#endif
+}
+
+static void mnet_bufpool_unmap(void* mem, size_t size)
+{
+#ifdef MNET_WINDOWS
+    (void)size;
+    VirtualFree(mem, 0, MEM_RELEASE);
+#else
+    munmap(mem, size);
+#endif
+}
+
+// called with the pool locked.
+static int mnet_bufpool_grow(mnet_bufpool_t* pool, uint32_t size_class)
+{
+    mnet_bufpool_class_t* cls = &pool->classes[size_class];
+    const size_t stride = MNET_BUF_HEADER_SIZE + (size_t)cls->size;
+
+    size_t size = MNET_BUFPOOL_SLAB_SIZE;
+    while (size < MNET_BUF_HEADER_SIZE + stride * 4) size *= 2;
+
+    uint8_t* mem = (uint8_t*)mnet_bufpool_map(size, pool->flags);
+    if (!mem) return 0;
+
+    mnet_bufpool_slab_t* slab = (mnet_bufpool_slab_t*)mem;
+    slab->next = (mnet_bufpool_slab_t*)pool->slabs;
+    slab->size = size;
+    pool->slabs = slab;
+
+    // the slab header takes the first cache line.
+    const size_t count = (size - MNET_BUF_HEADER_SIZE) / stride;
+    for (size_t i = 0; i < count; i++)
+    {
+        mnet_buf_t* buf = (mnet_buf_t*)(mem + MNET_BUF_HEADER_SIZE + i * stride);
+        buf->pool = pool;
+        buf->size_class = size_class;
+        buf->capacity = cls->size;
+        buf->refcount = 0;
+        buf->len = 0;
+        buf->next = cls->free_list;
+        cls->free_list = buf;
+    }
+
+    cls->free_count += (uint32_t)count;
+    return 1;
+}
+
+static mnet_bufpool_cache_t* mnet_bufpool_cache(mnet_bufpool_t* pool)
+{
+    if (pool->slot < 0) return NULL;
+
+    mnet_bufpool_cache_t* cache = &mnet_bufpool_caches[pool->slot];
+    if (cache->id != pool->id)
+    {
+        // left over from a destroyed pool, its memory is gone.
+        memset(cache, 0, sizeof(*cache));
+        cache->id = pool->id;
+    }
+
+    return cache;
+}
+
+static void mnet_bufpool_push_global(mnet_bufpool_t* pool, uint32_t size_class, mnet_buf_t* head, uint32_t count)
+{
+    if (!head) return;
+
+    mnet_buf_t* tail = head;
+    while (tail->next) tail = tail->next;
+
+    mnet_spin_lock(&pool->lock);
+    tail->next = pool->classes[size_class].free_list;
+    pool->classes[size_class].free_list = head;
+    pool->classes[size_class].free_count += count;
+    mnet_spin_unlock(&pool->lock);
+}
+
+mnet_result_t mnet_bufpool_init(mnet_bufpool_t* pool, const uint32_t* sizes, int class_count, uint32_t flags)
+{
+    static const uint32_t default_sizes[] = { 256, 1024, 2048, 4096, 16384, 65536 };
+
+    if (!pool) return mnet_error;
+    memset(pool, 0, sizeof(*pool));
+
+    if (!sizes)
+    {
+        sizes = default_sizes;
+        class_count = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+    }
+
+    if (class_count <= 0 || class_count > MNET_BUFPOOL_MAX_CLASSES) return mnet_error;
+
+    for (int i = 0; i < class_count; i++)
+    {
+        if (sizes[i] == 0 || (i > 0 && sizes[i] <= sizes[i - 1])) return mnet_error;
+
+        // keep every buffer cache line aligned.
+        pool->classes[i].size = (sizes[i] + 63u) & ~63u;
+    }
+
+    pool->class_count = (uint32_t)class_count;
+    pool->flags = flags;
+    pool->slot = -1;
+
+    mnet_spin_lock(&mnet_bufpool_registry_lock);
+    pool->id = ++mnet_bufpool_next_id;
+    for (int i = 0; i < MNET_BUFPOOL_MAX_POOLS; i++)
+    {
+        if (mnet_bufpool_live[i] == 0)
+        {
+            mnet_bufpool_live[i] = pool->id;
+            pool->slot = i;
+            break;
+        }
+    }
+    mnet_spin_unlock(&mnet_bufpool_registry_lock);
+
+    return mnet_ok;
+}
+
+void mnet_bufpool_destroy(mnet_bufpool_t* pool)
+{
+    if (!pool) return;
+
+    if (pool->slot >= 0)
+    {
+        mnet_spin_lock(&mnet_bufpool_registry_lock);
+        mnet_bufpool_live[pool->slot] = 0;
+        mnet_spin_unlock(&mnet_bufpool_registry_lock);
+
+        // other threads notice the stale id on their next use.
+        memset(&mnet_bufpool_caches[pool->slot], 0, sizeof(mnet_bufpool_cache_t));
+    }
+
+    mnet_bufpool_slab_t* slab = (mnet_bufpool_slab_t*)pool->slabs;
+    while (slab)
+    {
+        mnet_bufpool_slab_t* next = slab->next;
+        mnet_bufpool_unmap(slab, slab->size);
+        slab = next;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->slot = -1;
+}
+
+void mnet_bufpool_flush_thread(mnet_bufpool_t* pool)
+{
+    if (!pool) return;
+
+    mnet_bufpool_cache_t* cache = mnet_bufpool_cache(pool);
+    if (!cache) return;
+
+    for (uint32_t c = 0; c < pool->class_count; c++)
+    {
+        mnet_bufpool_push_global(pool, c, cache->heads[c], cache->counts[c]);
+        cache->heads[c] = NULL;
+        cache->counts[c] = 0;
+    }
+}
+
+mnet_buf_t* mnet_buf_alloc(mnet_bufpool_t* pool, size_t size)
+{
+    if (!pool) return NULL;
+
+    uint32_t c = 0;
+    while (c < pool->class_count && pool->classes[c].size < size) c++;
+    if (c == pool->class_count) return NULL;
+
+    mnet_bufpool_cache_t* cache = mnet_bufpool_cache(pool);
+    mnet_buf_t* buf = NULL;
+
+    if (cache && cache->heads[c])
+    {
+        buf = cache->heads[c];
+        cache->heads[c] = buf->next;
+        cache->counts[c]--;
+    }
+    else
+    {
+        mnet_bufpool_class_t* cls = &pool->classes[c];
+
+        mnet_spin_lock(&pool->lock);
+        if (!cls->free_list && !mnet_bufpool_grow(pool, c))
+        {
+            mnet_spin_unlock(&pool->lock);
+            return NULL;
+        }
+
+        buf = cls->free_list;
+        cls->free_list = buf->next;
+        cls->free_count--;
+
+        // refill the thread cache in the same critical section.
+        if (cache)
+        {
+            for (uint32_t i = 0; i < MNET_BUFPOOL_CACHE_BATCH && cls->free_list; i++)
+            {
+                mnet_buf_t* extra = cls->free_list;
+                cls->free_list = extra->next;
+                cls->free_count--;
+
+                extra->next = cache->heads[c];
+                cache->heads[c] = extra;
+                cache->counts[c]++;
+            }
+        }
+        mnet_spin_unlock(&pool->lock);
+    }
+
+    buf->next = NULL;
+    buf->refcount = 1;
+    buf->len = 0;
+    return buf;
+}
+
+void mnet_buf_retain(mnet_buf_t* buf)
+{
+    if (!buf) return;
+    mnet_atomic_add_u32(&buf->refcount, 1);
+}
+
+void mnet_buf_release(mnet_buf_t* buf)
+{
+    if (!buf) return;
+
+    // single owner needs no atomic read-modify-write.
+    if (mnet_atomic_load_u32(&buf->refcount) != 1 && mnet_atomic_add_u32(&buf->refcount, -1) != 0)
+        return;
+
+    buf->refcount = 0;
+
+    mnet_bufpool_t* pool = buf->pool;
+    const uint32_t c = buf->size_class;
+    mnet_bufpool_cache_t* cache = mnet_bufpool_cache(pool);
+
+    if (!cache)
+    {
+        buf->next = NULL;
+        mnet_bufpool_push_global(pool, c, buf, 1);
+        return;
+    }
+
+    buf->next = cache->heads[c];
+    cache->heads[c] = buf;
+    cache->counts[c]++;
+
+    if (cache->counts[c] > MNET_BUFPOOL_CACHE_MAX)
+    {
+        // hand a batch back so other threads can use it.
+        mnet_buf_t* head = cache->heads[c];
+        mnet_buf_t* tail = head;
+        for (uint32_t i = 1; i < MNET_BUFPOOL_CACHE_BATCH; i++) tail = tail->next;
+
+        cache->heads[c] = tail->next;
+        cache->counts[c] -= MNET_BUFPOOL_CACHE_BATCH;
+        tail->next = NULL;
+
+        mnet_bufpool_push_global(pool, c, head, MNET_BUFPOOL_CACHE_BATCH);
+    }
+}
+
+void* mnet_buf_data(mnet_buf_t* buf)
+{
+    if (!buf) return NULL;
+    return (uint8_t*)buf + MNET_BUF_HEADER_SIZE;
+}
+
+void mnet_buf_iovec(mnet_buf_t* buf, mnet_iovec_t* iov, size_t offset, size_t len)
+{
+    if (!buf || !iov) return;
+
+    if (offset > buf->capacity) offset = buf->capacity;
+    if (len > buf->capacity - offset) len = buf->capacity - offset;
+
+    mnet_iovec_init(iov, (uint8_t*)buf + MNET_BUF_HEADER_SIZE + offset, len);
+}
+
+
+// ================================================
+//              MIRRORED RING BUFFER
+//
+
+
+#ifdef MNET_WINDOWS
+
+static mnet_result_t mnet_ring_map(mnet_ring_t* ring)
+{
+    const uint64_t size = (uint64_t)ring->size;
+    ring->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                       (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFFu), NULL);
+    if (!ring->mapping) return mnet_error;
+
+    // find a free 2*size range, release it and map both views into it.
+    //  another thread can grab the range in between, so retry.
+    for (int attempt = 0; attempt < 16; attempt++)
+    {
+        uint8_t* base = (uint8_t*)VirtualAlloc(NULL, ring->size * 2, MEM_RESERVE, PAGE_NOACCESS);
+        if (!base) break;
+        VirtualFree(base, 0, MEM_RELEASE);
+
+        void* first = MapViewOfFileEx(ring->mapping, FILE_MAP_ALL_ACCESS, 0, 0, ring->size, base);
+        if (!first) continue;
+
+        void* second = MapViewOfFileEx(ring->mapping, FILE_MAP_ALL_ACCESS, 0, 0, ring->size, base + ring->size);
+        if (!second)
+        {
+            UnmapViewOfFile(first);
+            continue;
+        }
+
+        ring->base = base;
+        return mnet_ok;
+    }
+
+    CloseHandle(ring->mapping);
+    ring->mapping = NULL;
+    return mnet_error;
+}
+
+static void mnet_ring_unmap(mnet_ring_t* ring)
+{
+    UnmapViewOfFile(ring->base);
+    UnmapViewOfFile(ring->base + ring->size);
+    CloseHandle(ring->mapping);
+    ring->mapping = NULL;
+}
+
+static size_t mnet_ring_page_size(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwAllocationGranularity;
+}
+
+#else
+
+static mnet_result_t mnet_ring_map(mnet_ring_t* ring)
+{
+#ifdef MNET_LINUX
+    const int fd = (int)syscall(SYS_memfd_create, "mnet_ring", 0);
+#else
+    char name[64];
+    snprintf(name, sizeof(name), "/mnet_ring_%ld_%p", (long)getpid(), (void*)ring);
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) shm_unlink(name);
+#endif
+    if (fd < 0) return mnet_error;
+
+    if (ftruncate(fd, (off_t)ring->size) != 0)
+    {
+        close(fd);
+        return mnet_error;
+    }
+
+    // reserve 2*size so both halves land next to each other.
+    uint8_t* base = (uint8_t*)mmap(NULL, ring->size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return mnet_error;
+    }
+
+    const void* first = mmap(base, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    const void* second = mmap(base + ring->size, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+
+    if (first == MAP_FAILED || second == MAP_FAILED)
+    {
+        munmap(base, ring->size * 2);
+        return mnet_error;
+    }
+
+    ring->base = base;
+    return mnet_ok;
+}
+
+static void mnet_ring_unmap(mnet_ring_t* ring)
+{
+    munmap(ring->base, ring->size * 2);
+}
+
+static size_t mnet_ring_page_size(void)
+{
+    const long page = sysconf(_SC_PAGESIZE);
+    return page > 0 ? (size_t)page : 4096;
+}
+
+#endif
+
+mnet_result_t mnet_ring_init(mnet_ring_t* ring, size_t min_size)
+{
+    if (!ring || min_size == 0) return mnet_error;
+    memset(ring, 0, sizeof(*ring));
+
+    const size_t page = mnet_ring_page_size();
+    ring->size = (min_size + page - 1) / page * page;
+
+    if (mnet_ring_map(ring) != mnet_ok)
+    {
+        memset(ring, 0, sizeof(*ring));
+        return mnet_error;
+    }
+
+    return mnet_ok;
+}
+
+void mnet_ring_destroy(mnet_ring_t* ring)
+{
+    if (!ring || !ring->base) return;
+    mnet_ring_unmap(ring);
+    memset(ring, 0, sizeof(*ring));
+}
+
+void* mnet_ring_read_ptr(const mnet_ring_t* ring)
+{
+    return ring->base + ring->head;
+}
+
+void* mnet_ring_write_ptr(const mnet_ring_t* ring)
+{
+    // head + used < 2 * size, which is still inside the mirror.
+    return ring->base + ring->head + ring->used;
+}
+
+size_t mnet_ring_readable(const mnet_ring_t* ring)
+{
+    return ring->used;
+}
+
+size_t mnet_ring_writable(const mnet_ring_t* ring)
+{
+    return ring->size - ring->used;
+}
+
+void mnet_ring_commit(mnet_ring_t* ring, size_t len)
+{
+    if (len > ring->size - ring->used) len = ring->size - ring->used;
+    ring->used += len;
+}
+
+void mnet_ring_consume(mnet_ring_t* ring, size_t len)
+{
+    if (len > ring->used) len = ring->used;
+
+    ring->used -= len;
+    ring->head += len;
+    if (ring->head >= ring->size) ring->head -= ring->size;
+
+    // an empty ring restarts at the front, keeps spans short of the mirror.
+    if (ring->used == 0) ring->head = 0;
+}
+
+int mnet_ring_write_iovecs(const mnet_ring_t* ring, mnet_iovec_t iov[2])
+{
+    if (!ring || !iov) return 0;
+
+    const size_t free_bytes = mnet_ring_writable(ring);
+    if (free_bytes == 0) return 0;
+
+    mnet_iovec_init(&iov[0], mnet_ring_write_ptr(ring), free_bytes);
+    return 1;
+}
+
+int mnet_ring_read_iovecs(const mnet_ring_t* ring, mnet_iovec_t iov[2])
+{
+    if (!ring || !iov || ring->used == 0) return 0;
+
+    mnet_iovec_init(&iov[0], mnet_ring_read_ptr(ring), ring->used);
+    return 1;
+}
+
+int mnet_ring_recv(mnet_ring_t* ring, mnet_socket_t sock, mnet_msg_flags_t flags)
+{
+    if (!ring || !ring->base) return -1;
+
+    const size_t free_bytes = mnet_ring_writable(ring);
+    if (free_bytes == 0)
+    {
+#ifdef MNET_WINDOWS
+        WSASetLastError(WSAENOBUFS);
+#else
+        errno = ENOBUFS;
+#endif
+        return -1;
+    }
+
+    const int received = mnet_recv(sock, mnet_ring_write_ptr(ring), free_bytes, flags);
+    if (received > 0) mnet_ring_commit(ring, (size_t)received);
+    return received;
+}
+
+int mnet_ring_send(mnet_ring_t* ring, mnet_socket_t sock, mnet_msg_flags_t flags)
+{
+    if (!ring || !ring->base) return -1;
+    if (ring->used == 0) return 0;
+
+    const int sent = mnet_send(sock, mnet_ring_read_ptr(ring), ring->used, flags);
+    if (sent > 0) mnet_ring_consume(ring, (size_t)sent);
+    return sent;
+}
+
+
+// ================================================
+//              PEER TABLE
+//
+
+
+#define MNET_PEER_EMPTY     0x80
+#define MNET_PEER_DELETED   0xFE
+
+static uint32_t mnet_peer_group_match(const uint8_t* group, uint8_t byte)
+{
+    // bit i set when group[i] == byte.
+#ifdef MNET_SSE2
+    const __m128i ctrl = _mm_loadu_si128((const __m128i*)(const void*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < MNET_PEER_GROUP; i++)
+        mask |= (uint32_t)(group[i] == byte) << i;
+    return mask;
+#endif
+}
+
+static uint32_t mnet_peer_group_free(const uint8_t* group)
+{
+    // bit i set when group[i] is empty or deleted. (high bit set)
+#ifdef MNET_SSE2
+    const __m128i ctrl = _mm_loadu_si128((const __m128i*)(const void*)group);
+    return (uint32_t)_mm_movemask_epi8(ctrl);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < MNET_PEER_GROUP; i++)
+        mask |= (uint32_t)(group[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+static int mnet_peer_ctz(uint32_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(v);
+#else
+    int n = 0;
+    while (!(v & 1)) { v >>= 1; n++; }
+    return n;
+#endif
+}
+
+static size_t mnet_peer_max_load(size_t capacity)
+{
+    return capacity - capacity / 8;
+}
+
+static int mnet_peer_locate(const mnet_peer_table_t* table, const mnet_endpoint_t* ep, uint64_t hash, size_t* slot)
+{
+    const size_t mask = table->capacity - 1;
+    const uint8_t h2 = (uint8_t)(hash & 0x7F);
+    size_t group = (size_t)(hash >> 7) & mask & ~(size_t)(MNET_PEER_GROUP - 1);
+
+    // triangular probing over whole groups, visits every group once.
+    for (size_t step = MNET_PEER_GROUP;; step += MNET_PEER_GROUP)
+    {
+        const uint8_t* ctrl = table->ctrl + group;
+
+        uint32_t match = mnet_peer_group_match(ctrl, h2);
+        while (match)
+        {
+            const size_t index = group + (size_t)mnet_peer_ctz(match);
+            if (mnet_endpoint_equal(&table->entries[index].ep, ep))
+            {
+                *slot = index;
+                return 1;
+            }
+            match &= match - 1;
+        }
+
+        // a group with an empty slot ends every probe sequence through it.
+        if (mnet_peer_group_match(ctrl, MNET_PEER_EMPTY)) return 0;
+        group = (group + step) & mask;
+    }
+}
+
+static size_t mnet_peer_find_free(const mnet_peer_table_t* table, uint64_t hash)
+{
+    const size_t mask = table->capacity - 1;
+    size_t group = (size_t)(hash >> 7) & mask & ~(size_t)(MNET_PEER_GROUP - 1);
+
+    for (size_t step = MNET_PEER_GROUP;; step += MNET_PEER_GROUP)
+    {
+        const uint32_t free_slots = mnet_peer_group_free(table->ctrl + group);
+        if (free_slots) return group + (size_t)mnet_peer_ctz(free_slots);
+        group = (group + step) & mask;
+    }
+}
+
+static mnet_result_t mnet_peer_table_alloc(mnet_peer_table_t* table, size_t capacity)
+{
+    table->ctrl = (uint8_t*)malloc(capacity);
+    table->entries = (mnet_peer_entry_t*)malloc(capacity * sizeof(mnet_peer_entry_t));
+    if (!table->ctrl || !table->entries)
+    {
+        free(table->ctrl);
+        free(table->entries);
+        table->ctrl = NULL;
+        table->entries = NULL;
+        return mnet_error;
+    }
+
+    memset(table->ctrl, MNET_PEER_EMPTY, capacity);
+    table->capacity = capacity;
+    table->count = 0;
+    table->growth_left = mnet_peer_max_load(capacity);
+    table->cursor = 0;
+    return mnet_ok;
+}
+
+static mnet_result_t mnet_peer_table_rehash(mnet_peer_table_t* table, size_t capacity)
+{
+    mnet_peer_table_t old = *table;
+    if (mnet_peer_table_alloc(table, capacity) != mnet_ok)
+    {
+        *table = old;
+        return mnet_error;
+    }
+
+    for (size_t i = 0; i < old.capacity; i++)
+    {
+        if (old.ctrl[i] & 0x80) continue;
+
+        const uint64_t hash = mnet_endpoint_hash(&old.entries[i].ep);
+        const size_t slot = mnet_peer_find_free(table, hash);
+        table->ctrl[slot] = (uint8_t)(hash & 0x7F);
+        table->entries[slot] = old.entries[i];
+    }
+
+    table->count = old.count;
+    table->growth_left -= old.count;
+    free(old.ctrl);
+    free(old.entries);
+    return mnet_ok;
+}
+
+mnet_result_t mnet_peer_table_init(mnet_peer_table_t* table, size_t expected)
+{
+    if (!table) return mnet_error;
+    memset(table, 0, sizeof(*table));
+
+    size_t capacity = MNET_PEER_GROUP;
+    while (mnet_peer_max_load(capacity) < expected) capacity *= 2;
+    return mnet_peer_table_alloc(table, capacity);
+}
+
+void mnet_peer_table_destroy(mnet_peer_table_t* table)
+{
+    if (!table) return;
+    free(table->ctrl);
+    free(table->entries);
+    memset(table, 0, sizeof(*table));
+}
+
+int mnet_peer_table_find(mnet_peer_table_t* table, const mnet_endpoint_t* ep, uint64_t now_ms, uint32_t* session)
+{
+    if (!table || !ep || !table->ctrl) return 0;
+
+    size_t slot;
+    if (!mnet_peer_locate(table, ep, mnet_endpoint_hash(ep), &slot)) return 0;
+
+    mnet_peer_entry_t* entry = &table->entries[slot];
+    if (now_ms) entry->last_seen_ms = now_ms;
+    if (session) *session = entry->session;
+    return 1;
+}
+
+mnet_result_t mnet_peer_table_insert(
+                mnet_peer_table_t* table,
+                const mnet_endpoint_t* ep,
+                uint32_t session,
+                uint64_t now_ms)
+{
+    if (!table || !ep || !table->ctrl) return mnet_error;
+
+    const uint64_t hash = mnet_endpoint_hash(ep);
+    size_t slot;
+
+    if (mnet_peer_locate(table, ep, hash, &slot))
+    {
+        table->entries[slot].session = session;
+        table->entries[slot].last_seen_ms = now_ms;
+        return mnet_ok;
+    }
+
+    if (table->growth_left == 0)
+    {
+        // mostly tombstones: rebuild at the same size, otherwise grow.
+        const size_t capacity = table->count * 2 < mnet_peer_max_load(table->capacity)
+                              ? table->capacity : table->capacity * 2;
+        if (mnet_peer_table_rehash(table, capacity) != mnet_ok) return mnet_error;
+    }
+
+    slot = mnet_peer_find_free(table, hash);
+
+    // reusing a deleted slot does not use up an empty one.
+    if (table->ctrl[slot] == MNET_PEER_EMPTY) table->growth_left--;
+    table->ctrl[slot] = (uint8_t)(hash & 0x7F);
+
+    mnet_peer_entry_t* entry = &table->entries[slot];
+    entry->ep = *ep;
+    entry->session = session;
+    entry->last_seen_ms = now_ms;
+    table->count++;
+    return mnet_ok;
+}
+
+static void mnet_peer_erase(mnet_peer_table_t* table, size_t slot)
+{
+    const uint8_t* group = table->ctrl + (slot & ~(size_t)(MNET_PEER_GROUP - 1));
+
+    // no probe sequence continues past a group that has an empty slot,
+    //  so the slot can become empty again instead of a tombstone.
+    if (mnet_peer_group_match(group, MNET_PEER_EMPTY))
+    {
+        table->ctrl[slot] = MNET_PEER_EMPTY;
+        table->growth_left++;
+    }
+    else table->ctrl[slot] = MNET_PEER_DELETED;
+
+    table->count--;
+}
+
+int mnet_peer_table_remove(mnet_peer_table_t* table, const mnet_endpoint_t* ep, uint32_t* session)
+{
+    if (!table || !ep || !table->ctrl) return 0;
+
+    size_t slot;
+    if (!mnet_peer_locate(table, ep, mnet_endpoint_hash(ep), &slot)) return 0;
+
+    if (session) *session = table->entries[slot].session;
+    mnet_peer_erase(table, slot);
+    return 1;
+}
+
+size_t mnet_peer_table_evict(
+                mnet_peer_table_t* table,
+                uint64_t now_ms,
+                uint64_t idle_ms,
+                size_t max_slots,
+                mnet_peer_evict_callback_t callback,
+                void* udata)
+{
+    if (!table || !table->ctrl) return 0;
+    if (max_slots > table->capacity) max_slots = table->capacity;
+
+    size_t removed = 0;
+    size_t slot = table->cursor & (table->capacity - 1);
+
+    for (size_t i = 0; i < max_slots && table->count > 0; i++)
+    {
+        const mnet_peer_entry_t* entry = &table->entries[slot];
+        if (!(table->ctrl[slot] & 0x80) && now_ms >= entry->last_seen_ms && now_ms - entry->last_seen_ms >= idle_ms)
+        {
+            const mnet_endpoint_t ep = entry->ep;
+            const uint32_t session = entry->session;
+            mnet_peer_erase(table, slot);
+            removed++;
+            if (callback) callback(&ep, session, udata);
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+
+    table->cursor = slot;
+    return removed;
+}
+
+
+// ================================================
+//              MESSAGE FRAMING
+//
+
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#   define MNET_CRC32C_SSE42
+#   include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#   define MNET_CRC32C_ARM
+#   include <arm_acle.h>
+#endif
+
+// CRC32C of every nibble value, for CPUs without crc instructions.
+static const uint32_t mnet_crc32c_nibbles[16] =
+{
+    0x00000000, 0x105EC76F, 0x20BD8EDE, 0x30E349B1,
+    0x417B1DBC, 0x5125DAD3, 0x61C69362, 0x7198540D,
+    0x82F63B78, 0x92A8FC17, 0xA24BB5A6, 0xB21572C9,
+    0xC38D26C4, 0xD3D3E1AB, 0xE330A81A, 0xF36E6F75
+};
+
+static uint32_t mnet_crc32c_sw(uint32_t crc, const uint8_t* p, size_t len)
+{
+    while (len--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ mnet_crc32c_nibbles[crc & 0x0F];
+        crc = (crc >> 4) ^ mnet_crc32c_nibbles[crc & 0x0F];
+    }
+    return crc;
+}
+
+#ifdef MNET_CRC32C_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t mnet_crc32c_hw(uint32_t crc, const uint8_t* p, size_t len)
+{
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+#endif
+    for (; len >= 4; p += 4, len -= 4)
+    {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+    while (len--) crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#elif defined(MNET_CRC32C_ARM)
+static uint32_t mnet_crc32c_hw(uint32_t crc, const uint8_t* p, size_t len)
+{
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    while (len--) crc = __crc32cb(crc, *p++);
+    return crc;
+}
+#endif
+
+uint32_t mnet_crc32c(uint32_t crc, const void* data, size_t len)
+{
+    if (!data) return crc;
+    const uint8_t* p = (const uint8_t*)data;
+
+    crc = ~crc;
+#if defined(MNET_CRC32C_SSE42)
+    crc = __builtin_cpu_supports("sse4.2") ? mnet_crc32c_hw(crc, p, len) : mnet_crc32c_sw(crc, p, len);
+#elif defined(MNET_CRC32C_ARM)
+    crc = mnet_crc32c_hw(crc, p, len);
+#else
+    crc = mnet_crc32c_sw(crc, p, len);
+#endif
+    return ~crc;
+}
+
+static const uint8_t* mnet_framer_find(const uint8_t* p, size_t len, uint8_t byte)
+{
+#ifdef MNET_SSE2
+    const __m128i needle = _mm_set1_epi8((char)byte);
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)(p + i));
+        const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask) return p + i + mnet_peer_ctz(mask);
+    }
+
+    for (; i < len; i++)
+        if (p[i] == byte) return p + i;
+    return NULL;
+#else
+    return (const uint8_t*)memchr(p, byte, len);
+#endif
+}
+
+static size_t mnet_framer_max_payload(const mnet_framer_t* framer)
+{
+    size_t max = (size_t)-1;
+    if (framer->mode == mnet_frame_u16) max = 0xFFFF;
+    if (framer->mode == mnet_frame_u32 && (uint64_t)max > 0xFFFFFFFFull) max = (size_t)0xFFFFFFFFull;
+    if (framer->mode <= mnet_frame_varint && framer->param && framer->param < max) max = framer->param;
+
+    // parse only, the length still comes from the peer.
+    if (!framer->buf && framer->mode != mnet_frame_fixed && !(framer->mode <= mnet_frame_varint && framer->param)
+     && max > MNET_FRAME_DEFAULT_MAX)
+        max = MNET_FRAME_DEFAULT_MAX;
+
+    // the whole frame has to fit the receive buffer.
+    if (framer->buf)
+    {
+        size_t overhead = framer->crc32c ? 4 : 0;
+        if (framer->mode == mnet_frame_u16) overhead += 2;
+        else if (framer->mode == mnet_frame_u32) overhead += 4;
+        else if (framer->mode == mnet_frame_varint) overhead += MNET_FRAME_HEADER_MAX;
+        else if (framer->mode == mnet_frame_delimiter) overhead += 1;
+
+        const size_t fit = framer->size > overhead ? framer->size - overhead : 0;
+        if (fit < max) max = fit;
+    }
+
+    return max;
+}
+
+mnet_result_t mnet_framer_init(mnet_framer_t* framer, mnet_frame_mode_t mode, size_t param, size_t buffer_size)
+{
+    if (!framer || mode > mnet_frame_delimiter) return mnet_error;
+    if (mode == mnet_frame_fixed && param == 0) return mnet_error;
+    if (mode == mnet_frame_delimiter && param > 0xFF) return mnet_error;
+
+    memset(framer, 0, sizeof(*framer));
+    framer->mode = mode;
+    framer->param = param;
+
+    if (buffer_size > 0)
+    {
+        framer->buf = (uint8_t*)malloc(buffer_size);
+        if (!framer->buf) return mnet_error;
+        framer->size = buffer_size;
+    }
+
+    framer->max_frame = mnet_framer_max_payload(framer);
+    if (mode == mnet_frame_fixed && framer->max_frame < param)
+    {
+        mnet_framer_destroy(framer);
+        return mnet_error;
+    }
+
+    return mnet_ok;
+}
+
+void mnet_framer_destroy(mnet_framer_t* framer)
+{
+    if (!framer) return;
+    free(framer->buf);
+    memset(framer, 0, sizeof(*framer));
+}
+
+mnet_result_t mnet_framer_set_crc32c(mnet_framer_t* framer, int enable)
+{
+    if (!framer || (enable && framer->mode == mnet_frame_delimiter)) return mnet_error;
+
+    framer->crc32c = enable ? 1 : 0;
+    framer->max_frame = mnet_framer_max_payload(framer);
+    if (framer->mode == mnet_frame_fixed && framer->max_frame < framer->param)
+    {
+        framer->crc32c = 0;
+        framer->max_frame = mnet_framer_max_payload(framer);
+        return mnet_error;
+    }
+
+    return mnet_ok;
+}
+
+static int mnet_framer_parse_delimited(mnet_framer_t* framer, const uint8_t* p, size_t len, mnet_frame_t* frame)
+{
+    // a delimiter may end the longest payload, look one byte further.
+    const size_t max = framer->max_frame;
+    const size_t limit = len <= max ? len : max + 1;
+    if (framer->scanned > limit) framer->scanned = 0;
+
+    const uint8_t* hit = mnet_framer_find(p + framer->scanned, limit - framer->scanned, (uint8_t)framer->param);
+    if (!hit)
+    {
+        framer->scanned = limit;
+        if (len <= max) return 0;
+
+        framer->scanned = 0;
+        return -1;
+    }
+
+    framer->scanned = 0;
+    frame->data = p;
+    frame->len = (size_t)(hit - p);
+    frame->wire_len = frame->len + 1;
+    return 1;
+}
+
+int mnet_framer_parse(mnet_framer_t* framer, const void* data, size_t len, mnet_frame_t* frame)
+{
+    if (!framer || !frame || (!data && len)) return -1;
+
+    const uint8_t* p = (const uint8_t*)data;
+    if (framer->mode == mnet_frame_delimiter) return mnet_framer_parse_delimited(framer, p, len, frame);
+
+    size_t header = 0;
+    uint64_t payload = 0;
+
+    switch (framer->mode)
+    {
+        case mnet_frame_u16:
+            if (len < 2) return 0;
+            payload = (uint64_t)p[0] << 8 | p[1];
+            header = 2;
+            break;
+
+        case mnet_frame_u32:
+            if (len < 4) return 0;
+            payload = (uint64_t)p[0] << 24 | (uint64_t)p[1] << 16 | (uint64_t)p[2] << 8 | p[3];
+            header = 4;
+            break;
+
+        case mnet_frame_varint:
+            for (int shift = 0;; shift += 7)
+            {
+                if (header == MNET_FRAME_HEADER_MAX) return -1;
+                if (header == len) return 0;
+
+                const uint8_t byte = p[header++];
+                if (shift == 63 && (byte & 0x7E)) return -1;
+                payload |= (uint64_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) break;
+            }
+            break;
+
+        default:
+            payload = framer->param;
+            break;
+    }
+
+    if (payload > framer->max_frame) return -1;
+
+    // compare before adding, a huge length must not wrap the sum around.
+    const size_t trailer = framer->crc32c ? 4 : 0;
+    if (len < header + trailer || payload > len - header - trailer) return 0;
+    const size_t wire_len = header + (size_t)payload + trailer;
+
+    if (framer->crc32c)
+    {
+        const uint8_t* crc = p + header + payload;
+        const uint32_t expected = (uint32_t)crc[0] << 24 | (uint32_t)crc[1] << 16 | (uint32_t)crc[2] << 8 | crc[3];
+        if (mnet_crc32c(0, p + header, (size_t)payload) != expected) return -1;
+    }
+
+    frame->data = p + header;
+    frame->len = (size_t)payload;
+    frame->wire_len = wire_len;
+    return 1;
+}
+
+int mnet_framer_recv(mnet_framer_t* framer, mnet_socket_t sock, mnet_msg_flags_t flags)
+{
+    if (!framer || !framer->buf) return -1;
+
+    if (framer->start == framer->end)
+    {
+        framer->start = 0;
+        framer->end = 0;
+    }
+    else if (framer->end == framer->size && framer->start > 0)
+    {
+        // the frame runs past the end of the buffer, move it to the front.
+        memmove(framer->buf, framer->buf + framer->start, framer->end - framer->start);
+        framer->end -= framer->start;
+        framer->start = 0;
+    }
+
+    if (framer->end == framer->size)
+    {
+#ifdef MNET_WINDOWS
+        WSASetLastError(WSAENOBUFS);
+#else
+        errno = ENOBUFS;
+#endif
+        return -1;
+    }
+
+    const int received = mnet_recv(sock, framer->buf + framer->end, framer->size - framer->end, flags);
+    if (received > 0) framer->end += (size_t)received;
+    return received;
+}
+
+int mnet_framer_next(mnet_framer_t* framer, mnet_frame_t* frame)
+{
+    if (!framer || !framer->buf) return -1;
+
+    const int result = mnet_framer_parse(framer, framer->buf + framer->start, framer->end - framer->start, frame);
+    if (result == 1) framer->start += frame->wire_len;
+    return result;
+}
+
+int mnet_framer_header(const mnet_framer_t* framer, size_t len, uint8_t* header)
+{
+    if (!framer || !header) return -1;
+
+    switch (framer->mode)
+    {
+        case mnet_frame_u16:
+            if (len > 0xFFFF) return -1;
+            header[0] = (uint8_t)(len >> 8);
+            header[1] = (uint8_t)len;
+            return 2;
+
+        case mnet_frame_u32:
+            if ((uint64_t)len > 0xFFFFFFFFull) return -1;
+            header[0] = (uint8_t)((uint64_t)len >> 24);
+            header[1] = (uint8_t)(len >> 16);
+            header[2] = (uint8_t)(len >> 8);
+            header[3] = (uint8_t)len;
+            return 4;
+
+        case mnet_frame_varint:
+        {
+            uint64_t value = len;
+            int count = 0;
+            while (value >= 0x80)
+            {
+                header[count++] = (uint8_t)(value | 0x80);
+                value >>= 7;
+            }
+            header[count++] = (uint8_t)value;
+            return count;
+        }
+
+        case mnet_frame_fixed:
+            return len == framer->param ? 0 : -1;
+
+        default:
+            return 0;
+    }
+}
+
+int mnet_framer_trailer(const mnet_framer_t* framer, const void* payload, size_t len, uint8_t* trailer)
+{
+    if (!framer || !trailer) return 0;
+
+    int count = 0;
+    if (framer->crc32c)
+    {
+        const uint32_t crc = mnet_crc32c(0, payload, len);
+        trailer[count++] = (uint8_t)(crc >> 24);
+        trailer[count++] = (uint8_t)(crc >> 16);
+        trailer[count++] = (uint8_t)(crc >> 8);
+        trailer[count++] = (uint8_t)crc;
+    }
+    if (framer->mode == mnet_frame_delimiter) trailer[count++] = (uint8_t)framer->param;
+    return count;
+}
+
+
+// ================================================
+//              WRITE QUEUE
+//
+
+
+void mnet_writeq_init(mnet_writeq_t* queue)
+{
+    if (!queue) return;
+    memset(queue, 0, sizeof(*queue));
+}
+
+static mnet_writeq_entry_t* mnet_writeq_at(const mnet_writeq_t* queue, uint32_t i)
+{
+    return &queue->entries[(queue->head + i) & (queue->capacity - 1)];
+}
+
+static void mnet_writeq_release(mnet_writeq_t* queue, mnet_writeq_entry_t* entry)
+{
+    if (entry->block)
+    {
+        // keep one standard block around, chatty connections
+        //  empty and refill it all the time.
+        if (!queue->spare && entry->block_size == MNET_WRITEQ_BLOCK_SIZE) queue->spare = entry->block;
+        else free(entry->block);
+    }
+
+    if (entry->done) entry->done(entry->udata);
+}
+
+void mnet_writeq_destroy(mnet_writeq_t* queue)
+{
+    if (!queue) return;
+
+    for (uint32_t i = 0; i < queue->count; i++)
+        mnet_writeq_release(queue, mnet_writeq_at(queue, i));
+
+    free(queue->entries);
+    free(queue->spare);
+    memset(queue, 0, sizeof(*queue));
+}
+
+static mnet_writeq_entry_t* mnet_writeq_push(mnet_writeq_t* queue)
+{
+    if (queue->count == queue->capacity)
+    {
+        const uint32_t capacity = queue->capacity ? queue->capacity * 2 : 16;
+        mnet_writeq_entry_t* entries = (mnet_writeq_entry_t*)malloc(capacity * sizeof(mnet_writeq_entry_t));
+        if (!entries) return NULL;
+
+        for (uint32_t i = 0; i < queue->count; i++)
+            entries[i] = *mnet_writeq_at(queue, i);
+
+        free(queue->entries);
+        queue->entries = entries;
+        queue->capacity = capacity;
+        queue->head = 0;
+    }
+
+    mnet_writeq_entry_t* entry = mnet_writeq_at(queue, queue->count++);
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+
+mnet_result_t mnet_writeq_write(mnet_writeq_t* queue, const void* data, size_t len)
+{
+    if (!queue || (!data && len)) return mnet_error;
+    if (len == 0) return mnet_ok;
+
+    // room left in the last block.
+    size_t room = 0;
+    if (queue->count > 0)
+    {
+        const mnet_writeq_entry_t* tail = mnet_writeq_at(queue, queue->count - 1);
+        if (tail->block) room = tail->block_size - (size_t)(tail->data + tail->len - tail->block);
+    }
+    if (room > len) room = len;
+
+    // reserve the rest before copying anything, a failed write queues nothing.
+    const size_t rest = len - room;
+    mnet_writeq_entry_t* entry = NULL;
+    uint8_t* block = NULL;
+    size_t block_size = 0;
+    if (rest > 0)
+    {
+        entry = mnet_writeq_push(queue);
+        if (!entry) return mnet_error;
+
+        block_size = rest > MNET_WRITEQ_BLOCK_SIZE ? rest : MNET_WRITEQ_BLOCK_SIZE;
+        if (block_size == MNET_WRITEQ_BLOCK_SIZE && queue->spare)
+        {
+            block = queue->spare;
+            queue->spare = NULL;
+        }
+        else block = (uint8_t*)malloc(block_size);
+
+        if (!block)
+        {
+            queue->count--;
+            return mnet_error;
+        }
+    }
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    if (room > 0)
+    {
+        // the push may have moved the ring, look the tail up again.
+        mnet_writeq_entry_t* tail = mnet_writeq_at(queue, queue->count - (entry ? 2 : 1));
+        const size_t used = (size_t)(tail->data + tail->len - tail->block);
+        memcpy(tail->block + used, bytes, room);
+        tail->len += room;
+    }
+
+    if (entry)
+    {
+        memcpy(block, bytes + room, rest);
+        entry->data = block;
+        entry->len = rest;
+        entry->block = block;
+        entry->block_size = block_size;
+    }
+
+    queue->writes++;
+    queue->pending += len;
+    return mnet_ok;
+}
+
+mnet_result_t mnet_writeq_write_ref(mnet_writeq_t* queue, const void* data, size_t len,
+                                    mnet_writeq_done_t done, void* udata)
 {
-    return bind(sock, addr, addrlen);
+    if (!queue || (!data && len)) return mnet_error;
+
+    mnet_writeq_entry_t* entry = mnet_writeq_push(queue);
+    if (!entry) return mnet_error;
+
+    entry->data = (const uint8_t*)data;
+    entry->len = len;
+    entry->done = done;
+    entry->udata = udata;
+
+    queue->writes++;
+    queue->pending += len;
+    return mnet_ok;
+}
+
+static void mnet_writeq_advance(mnet_writeq_t* queue, uint64_t bytes)
+{
+    queue->pending -= bytes;
+    queue->sent += bytes;
+
+    while (queue->count > 0)
+    {
+        mnet_writeq_entry_t* entry = mnet_writeq_at(queue, 0);
+        if (bytes < entry->len)
+        {
+            entry->data += (size_t)bytes;
+            entry->len -= (size_t)bytes;
+            return;
+        }
+
+        // empty references still report done, in order.
+        bytes -= entry->len;
+        queue->head = (queue->head + 1) & (queue->capacity - 1);
+        queue->count--;
+        mnet_writeq_release(queue, entry);
+    }
+}
+
+int mnet_writeq_flush(mnet_writeq_t* queue, mnet_socket_t sock, mnet_msg_flags_t flags)
+{
+    if (!queue) return -1;
+
+    while (queue->count > 0)
+    {
+        mnet_iovec_t iov[MNET_WRITEQ_IOV_MAX];
+        int iovcnt = 0;
+        uint64_t total = 0;
+
+        for (uint32_t i = 0; i < queue->count && iovcnt < MNET_WRITEQ_IOV_MAX && total < MNET_WRITEQ_MAX_SEND; i++)
+        {
+            const mnet_writeq_entry_t* entry = mnet_writeq_at(queue, i);
+            uint64_t len = entry->len;
+            if (len > MNET_WRITEQ_MAX_SEND - total) len = MNET_WRITEQ_MAX_SEND - total;
+
+            mnet_iovec_init(&iov[iovcnt++], (void*)entry->data, (size_t)len);
+            total += len;
+        }
+
+        // only empty references left.
+        if (total == 0)
+        {
+            mnet_writeq_advance(queue, 0);
+            return 0;
+        }
+
+        queue->syscalls++;
+        const int sent = mnet_sendv(sock, iov, iovcnt, flags);
+        if (sent < 0) return mnet_get_platform_error() == mnet_ewouldblock ? 1 : -1;
+
+        mnet_writeq_advance(queue, (uint64_t)sent);
+
+        // the socket buffer is full, the next call would only fail.
+        if ((uint64_t)sent < total) return queue->count > 0 ? 1 : 0;
+    }
+
+    return 0;
+}
+
+uint64_t mnet_writeq_pending(const mnet_writeq_t* queue)
+{
+    return queue ? queue->pending : 0;
+}
+
+
+// ================================================
+//            TCP SERVER (HIGH LEVEL)
+//
+
+
+#define MNET_TCP_FREE_END UINT32_MAX
+#define MNET_TCP_WAKEUP_UDATA ((void*)UINTPTR_MAX)
+
+#define MNET_TCP_COMMAND_SEND   1
+#define MNET_TCP_COMMAND_CLOSE  2
+
+typedef struct mnet_tcp_command
+{
+    mnet_mpsc_node_t    node;
+    int                 type;
+    mnet_conn_id_t      conn;
+    size_t              len;
+    uint8_t             data[];
+} mnet_tcp_command_t;
+
+static mnet_conn_id_t mnet_tcp_make_id(uint32_t index, uint32_t generation)
+{
+    return ((mnet_conn_id_t)generation << 32) | index;
+}
+
+static mnet_tcp_conn_t* mnet_tcp_lookup(const mnet_tcp_server_t* server, mnet_conn_id_t conn)
+{
+    if (!server) return NULL;
+
+    const uint32_t index = (uint32_t)(conn & 0xFFFFFFFFu);
+    const uint32_t generation = (uint32_t)(conn >> 32);
+    if (index >= server->capacity) return NULL;
+
+    mnet_tcp_conn_t* c = &server->conns[index];
+    if (c->generation != generation || c->sock == MNET_INVALID_SOCKET) return NULL;
+    return c;
+}
+
+static int mnet_tcp_grow(mnet_tcp_server_t* server)
+{
+    const uint32_t capacity = server->capacity ? server->capacity * 2 : 64;
+
+    mnet_tcp_conn_t* conns = (mnet_tcp_conn_t*)realloc(server->conns, capacity * sizeof(mnet_tcp_conn_t));
+    if (!conns) return 0;
+
+    for (uint32_t i = server->capacity; i < capacity; i++)
+    {
+        memset(&conns[i], 0, sizeof(conns[i]));
+        conns[i].sock = MNET_INVALID_SOCKET;
+        conns[i].generation = 1;
+        conns[i].next_free = i + 1 < capacity ? i + 1 : server->free_head;
+    }
+
+    server->free_head = server->capacity;
+    server->conns = conns;
+    server->capacity = capacity;
+    return 1;
+}
+
+static void mnet_tcp_release(mnet_tcp_server_t* server, uint32_t index)
+{
+    mnet_tcp_conn_t* c = &server->conns[index];
+    const mnet_conn_id_t id = mnet_tcp_make_id(index, c->generation);
+
+    mnet_loop_del(&server->loop, c->sock);
+    mnet_close(c->sock);
+
+    if (server->callbacks.on_close)
+        server->callbacks.on_close(server, id, server->user);
+
+    // the callback can not have moved the table, it never accepts.
+    c = &server->conns[index];
+    free(c->in_buf);
+    mnet_writeq_destroy(&c->out);
+
+    const uint32_t generation = c->generation + 1;
+    memset(c, 0, sizeof(*c));
+    c->sock = MNET_INVALID_SOCKET;
+    c->generation = generation ? generation : 1;
+    c->next_free = server->free_head;
+
+    server->free_head = index;
+    server->count--;
+}
+
+static void mnet_tcp_set_write_interest(mnet_tcp_server_t* server, uint32_t index, int want_write)
+{
+    mnet_tcp_conn_t* c = &server->conns[index];
+    if (c->want_write == want_write) return;
+
+    c->want_write = want_write;
+    mnet_loop_mod(&server->loop, c->sock,
+                  mnet_loop_in | (want_write ? mnet_loop_out : 0),
+                  (void*)(uintptr_t)(index + 1));
+}
+
+// returns 0 if the connection failed.
+static int mnet_tcp_flush(mnet_tcp_server_t* server, uint32_t index)
+{
+    mnet_tcp_conn_t* c = &server->conns[index];
+
+    const int result = mnet_writeq_flush(&c->out, c->sock, mnet_msg_nosignal);
+    if (result < 0) return 0;
+
+    mnet_tcp_set_write_interest(server, index, result > 0);
+    return 1;
+}
+
+// flush the connections sent to during the last dispatch.
+static void mnet_tcp_flush_deferred(mnet_tcp_server_t* server)
+{
+    // on_close of a released connection may send again, straight away.
+    server->dispatching = 0;
+
+    for (uint32_t i = 0; i < server->flush_count; i++)
+    {
+        const mnet_conn_id_t id = server->flushes[i];
+        mnet_tcp_conn_t* c = mnet_tcp_lookup(server, id);
+        if (!c) continue;
+
+        c->flush_pending = 0;
+        const uint32_t index = (uint32_t)(id & 0xFFFFFFFFu);
+        if (!mnet_tcp_flush(server, index) || (c->closing && mnet_writeq_pending(&c->out) == 0))
+            mnet_tcp_release(server, index);
+    }
+
+    server->flush_count = 0;
+}
+
+static void mnet_tcp_accept(mnet_tcp_server_t* server)
+{
+    for (int i = 0; i < MNET_TCP_ACCEPT_BATCH; i++)
+    {
+        mnet_sockaddr_storage addr;
+        mnet_socklen_t addrlen = sizeof(addr);
+
+#ifdef MNET_LINUX
+        const mnet_socket_t sock = accept4(server->listener, (mnet_sockaddr_t*)&addr, &addrlen,
+                                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (sock == MNET_INVALID_SOCKET) return;
+        MNET_STATS_RESET(sock);
+#else
+        const mnet_socket_t sock = mnet_accept(server->listener, (mnet_sockaddr_t*)&addr, &addrlen);
+        if (sock == MNET_INVALID_SOCKET) return;
+        mnet_set_blocking(sock, 0);
+#endif
+
+        if (server->free_head == MNET_TCP_FREE_END && !mnet_tcp_grow(server))
+        {
+            mnet_close(sock);
+            continue;
+        }
+
+        const uint32_t index = server->free_head;
+        mnet_tcp_conn_t* c = &server->conns[index];
+        server->free_head = c->next_free;
+
+        c->sock = sock;
+        c->addr = addr;
+        c->next_free = MNET_TCP_FREE_END;
+
+        if (mnet_loop_add(&server->loop, sock, mnet_loop_in, (void*)(uintptr_t)(index + 1)) != mnet_ok)
+        {
+            mnet_close(sock);
+            c->sock = MNET_INVALID_SOCKET;
+            c->next_free = server->free_head;
+            server->free_head = index;
+            continue;
+        }
+
+        server->count++;
+
+        if (server->callbacks.on_open)
+            server->callbacks.on_open(server, mnet_tcp_make_id(index, c->generation), server->user);
+    }
+}
+
+// returns 0 if the connection is gone.
+static int mnet_tcp_read(mnet_tcp_server_t* server, uint32_t index)
+{
+    mnet_tcp_conn_t* c = &server->conns[index];
+    const mnet_conn_id_t id = mnet_tcp_make_id(index, c->generation);
+
+    if (c->in_cap - c->in_len < MNET_TCP_READ_SIZE)
+    {
+        const size_t capacity = c->in_len + MNET_TCP_READ_SIZE;
+        if (capacity > server->max_input + MNET_TCP_READ_SIZE) return 0;
+
+        uint8_t* buf = (uint8_t*)realloc(c->in_buf, capacity);
+        if (!buf) return 0;
+        c->in_buf = buf;
+        c->in_cap = capacity;
+    }
+
+    const int received = mnet_recv(c->sock, c->in_buf + c->in_len, c->in_cap - c->in_len, mnet_msg_default);
+    if (received == 0) return 0;
+    if (received < 0) return mnet_get_platform_error() == mnet_ewouldblock;
+
+    c->in_len += (size_t)received;
+
+    size_t consumed = server->callbacks.on_data(server, id, c->in_buf, c->in_len, server->user);
+
+    // the callback may have closed or sent on this connection.
+    c = mnet_tcp_lookup(server, id);
+    if (!c) return 1;
+
+    if (consumed > c->in_len) consumed = c->in_len;
+    if (consumed > 0)
+    {
+        c->in_len -= consumed;
+        if (c->in_len > 0) memmove(c->in_buf, c->in_buf + consumed, c->in_len);
+    }
+
+    return c->in_len <= server->max_input;
+}
+
+static mnet_result_t mnet_tcp_server_setup(mnet_tcp_server_t* server, const mnet_sockaddr_t* addr,
+                                           mnet_socklen_t addrlen, const mnet_tcp_callbacks_t* callbacks,
+                                           void* user, int reuseport)
+{
+    if (!server || !addr || !callbacks || !callbacks->on_data) return mnet_error;
+    memset(server, 0, sizeof(*server));
+
+    server->callbacks = *callbacks;
+    server->user = user;
+    server->free_head = MNET_TCP_FREE_END;
+    server->max_input = MNET_TCP_MAX_INPUT;
+    mnet_mpsc_init(&server->commands);
+    mnet_pool_port_init(&server->jobs, &server->wakeup);
+
+    if (mnet_wakeup_init(&server->wakeup) != mnet_ok) return mnet_error;
+    if (mnet_loop_init(&server->loop) != mnet_ok
+     || mnet_loop_add(&server->loop, mnet_wakeup_socket(&server->wakeup), mnet_loop_in, MNET_TCP_WAKEUP_UDATA) != mnet_ok)
+    {
+        mnet_loop_destroy(&server->loop);
+        mnet_wakeup_destroy(&server->wakeup);
+        return mnet_error;
+    }
+
+    server->listener = mnet_socket((mnet_address_family_t)addr->sa_family, mnet_sock_stream, mnet_ipproto_tcp);
+    if (server->listener == MNET_INVALID_SOCKET) goto fail;
+
+    if (mnet_set_reuseaddr(server->listener, 1) != mnet_ok
+     || (reuseport && mnet_set_reuseport(server->listener, 1) != mnet_ok)
+     || mnet_bind(server->listener, addr, addrlen) != mnet_ok
+     || mnet_listen(server->listener, SOMAXCONN) != mnet_ok
+     || mnet_set_blocking(server->listener, 0) != mnet_ok
+     || mnet_loop_add(&server->loop, server->listener, mnet_loop_in, NULL) != mnet_ok)
+    {
+        mnet_close(server->listener);
+        goto fail;
+    }
+
+    return mnet_ok;
+
+fail:
+    mnet_loop_destroy(&server->loop);
+    mnet_wakeup_destroy(&server->wakeup);
+    memset(server, 0, sizeof(*server));
+    server->listener = MNET_INVALID_SOCKET;
+    return mnet_error;
+}
+
+mnet_result_t mnet_tcp_server_init(mnet_tcp_server_t* server, const mnet_sockaddr_t* addr, mnet_socklen_t addrlen,
+                                   const mnet_tcp_callbacks_t* callbacks, void* user)
+{
+    return mnet_tcp_server_setup(server, addr, addrlen, callbacks, user, 0);
+}
+
+void mnet_tcp_server_destroy(mnet_tcp_server_t* server)
+{
+    if (!server || server->listener == MNET_INVALID_SOCKET) return;
+
+    for (uint32_t i = 0; i < server->capacity; i++)
+        if (server->conns[i].sock != MNET_INVALID_SOCKET)
+            mnet_tcp_release(server, i);
+
+    mnet_loop_del(&server->loop, server->listener);
+    mnet_close(server->listener);
+    mnet_loop_del(&server->loop, mnet_wakeup_socket(&server->wakeup));
+    mnet_loop_destroy(&server->loop);
+    mnet_wakeup_destroy(&server->wakeup);
+    free(server->conns);
+    free(server->flushes);
+
+    // commands nobody will run anymore.
+    mnet_mpsc_node_t* node = mnet_mpsc_take_all(&server->commands);
+    while (node)
+    {
+        mnet_mpsc_node_t* next = node->next;
+        free(node);
+        node = next;
+    }
+
+    memset(server, 0, sizeof(*server));
+    server->listener = MNET_INVALID_SOCKET;
+}
+
+static void mnet_tcp_run_commands(mnet_tcp_server_t* server)
+{
+    mnet_wakeup_drain(&server->wakeup);
+
+    // one wakeup flushes everything posted up to now.
+    mnet_mpsc_node_t* node = mnet_mpsc_take_all(&server->commands);
+    while (node)
+    {
+        mnet_tcp_command_t* command = (mnet_tcp_command_t*)node;
+        node = node->next;
+
+        if (command->type == MNET_TCP_COMMAND_SEND)
+            mnet_tcp_server_send(server, command->conn, command->data, command->len);
+        else if (command->type == MNET_TCP_COMMAND_CLOSE)
+            mnet_tcp_server_close(server, command->conn);
+
+        free(command);
+    }
+
+    mnet_pool_port_dispatch(&server->jobs);
+}
+
+static mnet_result_t mnet_tcp_post(mnet_tcp_server_t* server, int type, mnet_conn_id_t conn,
+                                   const void* data, size_t len)
+{
+    if (!server || (len && !data)) return mnet_error;
+
+    mnet_tcp_command_t* command = (mnet_tcp_command_t*)malloc(sizeof(mnet_tcp_command_t) + len);
+    if (!command) return mnet_error;
+
+    command->type = type;
+    command->conn = conn;
+    command->len = len;
+    if (len) memcpy(command->data, data, len);
+
+    mnet_mpsc_push(&server->commands, &command->node);
+    mnet_wakeup_signal(&server->wakeup);
+    return mnet_ok;
+}
+
+int mnet_tcp_server_poll(mnet_tcp_server_t* server, int timeout)
+{
+    if (!server) return -1;
+
+    mnet_loop_event_t events[MNET_TCP_EVENT_BATCH];
+    const int count = mnet_loop_wait(&server->loop, events, MNET_TCP_EVENT_BATCH, timeout);
+    if (count <= 0) return count;
+
+    server->dispatching = 1;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!events[i].udata)
+        {
+            mnet_tcp_accept(server);
+            continue;
+        }
+
+        if (events[i].udata == MNET_TCP_WAKEUP_UDATA)
+        {
+            mnet_tcp_run_commands(server);
+            continue;
+        }
+
+        const uint32_t index = (uint32_t)((uintptr_t)events[i].udata - 1);
+        if (index >= server->capacity || server->conns[index].sock != events[i].sock) continue;
+
+        int alive = 1;
+        if (events[i].events & mnet_loop_out)
+            alive = mnet_tcp_flush(server, index);
+
+        if (alive && (events[i].events & (mnet_loop_in | mnet_loop_hup | mnet_loop_err)))
+        {
+            // the callback may close and reuse the slot, keep track of it by id.
+            const mnet_conn_id_t id = mnet_tcp_make_id(index, server->conns[index].generation);
+            alive = mnet_tcp_read(server, index);
+            if (!mnet_tcp_lookup(server, id)) continue;
+        }
+
+        mnet_tcp_conn_t* c = &server->conns[index];
+        if (!alive || (c->closing && mnet_writeq_pending(&c->out) == 0))
+            mnet_tcp_release(server, index);
+    }
+
+    mnet_tcp_flush_deferred(server);
+    return count;
+}
+
+mnet_result_t mnet_tcp_server_send(mnet_tcp_server_t* server, mnet_conn_id_t conn, const void* data, size_t len)
+{
+    mnet_tcp_conn_t* c = mnet_tcp_lookup(server, conn);
+    if (!c || c->closing || (!data && len)) return mnet_error;
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    const uint32_t index = (uint32_t)(conn & 0xFFFFFFFFu);
+
+    // nothing queued, try the socket directly and skip the copy.
+    //  (small sends from callbacks are left to coalesce)
+    if (mnet_writeq_pending(&c->out) == 0 && (!server->dispatching || len >= MNET_WRITEQ_BLOCK_SIZE))
+    {
+        while (len > 0)
+        {
+            const size_t chunk = len < MNET_WRITEQ_MAX_SEND ? len : MNET_WRITEQ_MAX_SEND;
+            const int sent = mnet_send(c->sock, bytes, chunk, mnet_msg_nosignal);
+            if (sent < 0) break;
+            bytes += sent;
+            len -= (size_t)sent;
+        }
+        if (len == 0) return mnet_ok;
+    }
+
+    if (mnet_writeq_write(&c->out, bytes, len) != mnet_ok) return mnet_error;
+
+    if (!server->dispatching)
+    {
+        mnet_tcp_set_write_interest(server, index, 1);
+        return mnet_ok;
+    }
+
+    if (!c->flush_pending)
+    {
+        if (server->flush_count == server->flush_cap)
+        {
+            const uint32_t capacity = server->flush_cap ? server->flush_cap * 2 : 64;
+            mnet_conn_id_t* flushes = (mnet_conn_id_t*)realloc(server->flushes, capacity * sizeof(mnet_conn_id_t));
+            if (!flushes)
+            {
+                // still sent, by the writable event instead.
+                mnet_tcp_set_write_interest(server, index, 1);
+                return mnet_ok;
+            }
+            server->flushes = flushes;
+            server->flush_cap = capacity;
+        }
+
+        c->flush_pending = 1;
+        server->flushes[server->flush_count++] = conn;
+    }
+
+    return mnet_ok;
+}
+
+mnet_result_t mnet_tcp_server_close(mnet_tcp_server_t* server, mnet_conn_id_t conn)
+{
+    mnet_tcp_conn_t* c = mnet_tcp_lookup(server, conn);
+    if (!c) return mnet_error;
+
+    c->closing = 1;
+
+    // output still pending, the writable event finishes the close.
+    if (mnet_writeq_pending(&c->out) > 0) return mnet_ok;
+
+    mnet_tcp_release(server, (uint32_t)(conn & 0xFFFFFFFFu));
+    return mnet_ok;
+}
+
+mnet_socket_t mnet_tcp_server_socket(const mnet_tcp_server_t* server, mnet_conn_id_t conn)
+{
+    const mnet_tcp_conn_t* c = mnet_tcp_lookup(server, conn);
+    return c ? c->sock : MNET_INVALID_SOCKET;
+}
+
+const mnet_sockaddr_t* mnet_tcp_server_peer(const mnet_tcp_server_t* server, mnet_conn_id_t conn)
+{
+    const mnet_tcp_conn_t* c = mnet_tcp_lookup(server, conn);
+    return c ? (const mnet_sockaddr_t*)&c->addr : NULL;
+}
+
+mnet_result_t mnet_tcp_server_set_udata(mnet_tcp_server_t* server, mnet_conn_id_t conn, void* udata)
+{
+    mnet_tcp_conn_t* c = mnet_tcp_lookup(server, conn);
+    if (!c) return mnet_error;
+    c->udata = udata;
+    return mnet_ok;
+}
+
+void* mnet_tcp_server_get_udata(const mnet_tcp_server_t* server, mnet_conn_id_t conn)
+{
+    const mnet_tcp_conn_t* c = mnet_tcp_lookup(server, conn);
+    return c ? c->udata : NULL;
+}
+
+mnet_result_t mnet_tcp_server_post_send(mnet_tcp_server_t* server, mnet_conn_id_t conn, const void* data, size_t len)
+{
+    return mnet_tcp_post(server, MNET_TCP_COMMAND_SEND, conn, data, len);
+}
+
+mnet_result_t mnet_tcp_server_post_close(mnet_tcp_server_t* server, mnet_conn_id_t conn)
+{
+    return mnet_tcp_post(server, MNET_TCP_COMMAND_CLOSE, conn, NULL, 0);
+}
+
+void mnet_tcp_server_wakeup(mnet_tcp_server_t* server)
+{
+    if (server) mnet_wakeup_signal(&server->wakeup);
+}
+
+mnet_result_t mnet_tcp_server_offload(mnet_tcp_server_t* server, mnet_pool_t* pool, mnet_job_t* job)
+{
+    if (!server) return mnet_error;
+    return mnet_pool_submit(pool, job, &server->jobs);
+}
+
+
+// ================================================
+//            RELIABLE UDP CHANNELS (HIGH LEVEL)
+//
+
+
+#define MNET_RUDP_INITIAL_RTO_MS    250.0
+#define MNET_RUDP_MIN_RTO_MS        30.0
+#define MNET_RUDP_MAX_RTO_MS        3000.0
+#define MNET_RUDP_MAX_BACKOFF       3
+
+// a is newer than b, with 16 bit wraparound.
+static int mnet_rudp_seq_greater(uint16_t a, uint16_t b)
+{
+    return ((a > b) && (a - b <= 32768)) || ((a < b) && (b - a > 32768));
+}
+
+static void mnet_rudp_put16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void mnet_rudp_put32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint16_t mnet_rudp_get16(const uint8_t* p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t mnet_rudp_get32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static mnet_rudp_msg_t* mnet_rudp_msg_new(uint8_t channel, uint16_t id, const void* data, size_t len)
+{
+    mnet_rudp_msg_t* msg = (mnet_rudp_msg_t*)malloc(sizeof(mnet_rudp_msg_t) + len);
+    if (!msg) return NULL;
+
+    msg->next = NULL;
+    msg->channel = channel;
+    msg->id = id;
+    msg->len = (uint16_t)len;
+    if (len) memcpy(msg->data, data, len);
+    return msg;
+}
+
+static void mnet_rudp_msg_free_list(mnet_rudp_msg_t* msg)
+{
+    while (msg)
+    {
+        mnet_rudp_msg_t* next = msg->next;
+        free(msg);
+        msg = next;
+    }
+}
+
+static void mnet_rudp_deliver(mnet_rudp_t* peer, mnet_rudp_msg_t* msg)
+{
+    msg->next = NULL;
+    if (peer->delivery_tail) peer->delivery_tail->next = msg;
+    else peer->delivery_head = msg;
+    peer->delivery_tail = msg;
+}
+
+static mnet_result_t mnet_rudp_deliver_copy(mnet_rudp_t* peer, uint8_t channel, uint16_t id,
+                                            const uint8_t* data, uint16_t len)
+{
+    mnet_rudp_msg_t* msg = mnet_rudp_msg_new(channel, id, data, len);
+    if (!msg) return mnet_error;
+    mnet_rudp_deliver(peer, msg);
+    return mnet_ok;
+}
+
+static void mnet_rudp_rtt_sample(mnet_rudp_t* peer, double rtt)
+{
+    // RFC 6298.
+    if (peer->stats.rtt_ms <= 0.0)
+    {
+        peer->stats.rtt_ms = rtt;
+        peer->rttvar_ms = rtt / 2.0;
+    }
+    else
+    {
+        const double delta = peer->stats.rtt_ms > rtt ? peer->stats.rtt_ms - rtt : rtt - peer->stats.rtt_ms;
+        peer->rttvar_ms = 0.75 * peer->rttvar_ms + 0.25 * delta;
+        peer->stats.rtt_ms = 0.875 * peer->stats.rtt_ms + 0.125 * rtt;
+    }
+
+    double rto = peer->stats.rtt_ms + 4.0 * peer->rttvar_ms;
+    if (rto < MNET_RUDP_MIN_RTO_MS) rto = MNET_RUDP_MIN_RTO_MS;
+    if (rto > MNET_RUDP_MAX_RTO_MS) rto = MNET_RUDP_MAX_RTO_MS;
+    peer->stats.rto_ms = rto;
+}
+
+static uint64_t mnet_rudp_resend_at(const mnet_rudp_t* peer, const mnet_rudp_slot_t* slot)
+{
+    const int backoff = slot->sends - 1 < MNET_RUDP_MAX_BACKOFF ? slot->sends - 1 : MNET_RUDP_MAX_BACKOFF;
+    return slot->sent_ms + ((uint64_t)peer->stats.rto_ms << backoff);
+}
+
+static void mnet_rudp_ack_packet(mnet_rudp_t* peer, uint16_t seq, uint64_t now_ms)
+{
+    mnet_rudp_sent_packet_t* sp = &peer->sent[seq % MNET_RUDP_WINDOW];
+    if (!sp->valid || sp->seq != seq) return;
+    sp->valid = 0;
+    peer->stats.packets_acked++;
+
+    // Karn: a packet carrying resends gives an ambiguous sample.
+    if (sp->count > 0 && !sp->resent && now_ms >= sp->sent_ms)
+    {
+        mnet_rudp_rtt_sample(peer, (double)(now_ms - sp->sent_ms));
+        mnet_stats_record_rtt((now_ms - sp->sent_ms) * 1000000u);
+    }
+
+    for (int i = 0; i < sp->count; i++)
+    {
+        mnet_rudp_channel_t* ch = &peer->channels[sp->channels[i]];
+        mnet_rudp_slot_t* slot = &ch->send_window[sp->ids[i] % MNET_RUDP_WINDOW];
+        if (!slot->msg || slot->msg->id != sp->ids[i]) continue;
+
+        free(slot->msg);
+        slot->msg = NULL;
+    }
+
+    for (int c = 0; c < peer->channel_count; c++)
+    {
+        mnet_rudp_channel_t* ch = &peer->channels[c];
+        if (ch->type == mnet_channel_unreliable_sequenced) continue;
+
+        while (ch->send_oldest != ch->send_next && !ch->send_window[ch->send_oldest % MNET_RUDP_WINDOW].msg)
+            ch->send_oldest++;
+    }
 }
 
-mnet_result_t mnet_listen(mnet_socket_t sock, int backlog)
+static mnet_result_t mnet_rudp_receive_message(mnet_rudp_t* peer, uint8_t channel, uint16_t id,
+                                               const uint8_t* data, uint16_t len)
 {
-    return listen(sock, backlog);
+    mnet_rudp_channel_t* ch = &peer->channels[channel];
+
+    if (ch->type == mnet_channel_unreliable_sequenced)
+    {
+        if (ch->has_recv && !mnet_rudp_seq_greater(id, ch->recv_next)) return mnet_ok;
+        ch->has_recv = 1;
+        ch->recv_next = id;
+        return mnet_rudp_deliver_copy(peer, channel, id, data, len);
+    }
+
+    // already delivered, or outside what the sender can have in flight.
+    if (mnet_rudp_seq_greater(ch->recv_next, id)) return mnet_ok;
+    if ((uint16_t)(id - ch->recv_next) >= MNET_RUDP_WINDOW) return mnet_ok;
+
+    const uint16_t slot = id % MNET_RUDP_WINDOW;
+
+    if (ch->type == mnet_channel_reliable_unordered)
+    {
+        if (ch->recv_seen[slot]) return mnet_ok;
+        if (mnet_rudp_deliver_copy(peer, channel, id, data, len) != mnet_ok) return mnet_error;
+
+        ch->recv_seen[slot] = 1;
+        while (ch->recv_seen[ch->recv_next % MNET_RUDP_WINDOW])
+        {
+            ch->recv_seen[ch->recv_next % MNET_RUDP_WINDOW] = 0;
+            ch->recv_next++;
+        }
+        return mnet_ok;
+    }
+
+    if (ch->recv_window[slot]) return mnet_ok;
+
+    mnet_rudp_msg_t* msg = mnet_rudp_msg_new(channel, id, data, len);
+    if (!msg) return mnet_error;
+    ch->recv_window[slot] = msg;
+
+    while (ch->recv_window[ch->recv_next % MNET_RUDP_WINDOW])
+    {
+        msg = ch->recv_window[ch->recv_next % MNET_RUDP_WINDOW];
+        ch->recv_window[ch->recv_next % MNET_RUDP_WINDOW] = NULL;
+        mnet_rudp_deliver(peer, msg);
+        ch->recv_next++;
+    }
+    return mnet_ok;
 }
 
-mnet_socket_t mnet_accept(mnet_socket_t sock, struct sockaddr *addr, mnet_socklen_t *addrlen)
+mnet_result_t mnet_rudp_init(mnet_rudp_t* peer, mnet_socket_t sock, const mnet_sockaddr_t* addr,
+                             mnet_socklen_t addrlen, const mnet_channel_type_t* channels, int channel_count)
 {
-    return accept(sock, addr, addrlen);
+    if (!peer || !addr || !channels) return mnet_error;
+    if (channel_count <= 0 || channel_count > MNET_RUDP_MAX_CHANNELS) return mnet_error;
+    if ((size_t)addrlen > sizeof(peer->addr)) return mnet_error;
+
+    memset(peer, 0, sizeof(*peer));
+    peer->sock = sock;
+    memcpy(&peer->addr, addr, (size_t)addrlen);
+    peer->addrlen = addrlen;
+    peer->mtu = MNET_RUDP_DEFAULT_MTU;
+    peer->channel_count = channel_count;
+    peer->stats.rto_ms = MNET_RUDP_INITIAL_RTO_MS;
+
+    // sequence 0 is never sent, an ack of 0 means nothing was received yet.
+    peer->send_seq = 1;
+
+    peer->sent = (mnet_rudp_sent_packet_t*)calloc(MNET_RUDP_WINDOW, sizeof(mnet_rudp_sent_packet_t));
+    if (!peer->sent) return mnet_error;
+
+    for (int c = 0; c < channel_count; c++)
+    {
+        mnet_rudp_channel_t* ch = &peer->channels[c];
+        ch->type = (uint8_t)channels[c];
+
+        switch (channels[c])
+        {
+            case mnet_channel_reliable_ordered:
+                ch->recv_window = (mnet_rudp_msg_t**)calloc(MNET_RUDP_WINDOW, sizeof(mnet_rudp_msg_t*));
+                if (!ch->recv_window) goto fail;
+                break;
+
+            case mnet_channel_reliable_unordered:
+                ch->recv_seen = (uint8_t*)calloc(MNET_RUDP_WINDOW, 1);
+                if (!ch->recv_seen) goto fail;
+                break;
+
+            case mnet_channel_unreliable_sequenced:
+                continue;
+
+            default:
+                goto fail;
+        }
+
+        ch->send_window = (mnet_rudp_slot_t*)calloc(MNET_RUDP_WINDOW, sizeof(mnet_rudp_slot_t));
+        if (!ch->send_window) goto fail;
+    }
+
+    return mnet_ok;
+
+fail:
+    mnet_rudp_destroy(peer);
+    return mnet_error;
 }
 
-mnet_result_t mnet_connect(mnet_socket_t sock, const struct sockaddr *addr, mnet_socklen_t addrlen)
+void mnet_rudp_destroy(mnet_rudp_t* peer)
 {
-    return connect(sock, addr, addrlen);
+    if (!peer) return;
+
+    for (int c = 0; c < peer->channel_count; c++)
+    {
+        mnet_rudp_channel_t* ch = &peer->channels[c];
+
+        for (int i = 0; i < MNET_RUDP_WINDOW; i++)
+        {
+            if (ch->send_window) free(ch->send_window[i].msg);
+            if (ch->recv_window) free(ch->recv_window[i]);
+        }
+
+        free(ch->send_window);
+        free(ch->recv_window);
+        free(ch->recv_seen);
+        mnet_rudp_msg_free_list(ch->unreliable_head);
+    }
+
+    mnet_rudp_msg_free_list(peer->delivery_head);
+    free(peer->sent);
+    memset(peer, 0, sizeof(*peer));
+    peer->sock = MNET_INVALID_SOCKET;
 }
 
-mnet_result_t mnet_shutdown(mnet_socket_t sock, mnet_shutdown_code_t how)
+mnet_result_t mnet_rudp_set_mtu(mnet_rudp_t* peer, uint16_t mtu)
 {
-    return shutdown(sock, (int)how);
+    if (!peer) return mnet_error;
+    if (mtu < MNET_RUDP_PACKET_HEADER + MNET_RUDP_MESSAGE_HEADER || mtu > MNET_RUDP_MAX_MTU) return mnet_error;
+
+    peer->mtu = mtu;
+    return mnet_ok;
 }
 
+mnet_result_t mnet_rudp_send(mnet_rudp_t* peer, uint8_t channel, const void* data, size_t len)
+{
+    if (!peer || channel >= peer->channel_count) return mnet_error;
+    if (len && !data) return mnet_error;
 
-// ================================================
-//               DATA TRANSFER (TCP)
-//
+    // the field is public, clamp it to the packet buffer of mnet_rudp_update.
+    const size_t mtu = peer->mtu < MNET_RUDP_MAX_MTU ? peer->mtu : MNET_RUDP_MAX_MTU;
+    if (mtu < MNET_RUDP_PACKET_HEADER + MNET_RUDP_MESSAGE_HEADER) return mnet_error;
+    if (len > mtu - MNET_RUDP_PACKET_HEADER - MNET_RUDP_MESSAGE_HEADER) return mnet_error;
 
+    mnet_rudp_channel_t* ch = &peer->channels[channel];
 
-int mnet_send(mnet_socket_t sock, const void *buf, size_t len, mnet_msg_flags_t flags)
-{
-#ifdef MNET_WINDOWS
-    return send(sock, (const char*)buf, (int)len, (int)flags);
-#elif defined(MNET_UNIX)
-    return (int)send(sock, buf, len, (int)flags);
-#endif
+    if (ch->type != mnet_channel_unreliable_sequenced &&
+        (uint16_t)(ch->send_next - ch->send_oldest) >= MNET_RUDP_WINDOW)
+        return mnet_error;
+
+    mnet_rudp_msg_t* msg = mnet_rudp_msg_new(channel, ch->send_next, data, len);
+    if (!msg) return mnet_error;
+
+    if (ch->type == mnet_channel_unreliable_sequenced)
+    {
+        if (ch->unreliable_tail) ch->unreliable_tail->next = msg;
+        else ch->unreliable_head = msg;
+        ch->unreliable_tail = msg;
+    }
+    else
+    {
+        mnet_rudp_slot_t* slot = &ch->send_window[ch->send_next % MNET_RUDP_WINDOW];
+        slot->msg = msg;
+        slot->sends = 0;
+        slot->sent_ms = 0;
+    }
+
+    ch->send_next++;
+    return mnet_ok;
 }
 
-int mnet_recv(mnet_socket_t sock, void *buf, size_t len, mnet_msg_flags_t flags)
+mnet_result_t mnet_rudp_on_packet(mnet_rudp_t* peer, const void* data, size_t len, uint64_t now_ms)
 {
-#ifdef MNET_WINDOWS
-    return recv(sock, (char*)buf, (int)len, (int)flags);
-#elif defined(MNET_UNIX)
-    return (int)recv(sock, buf, len, (int)flags);
-#endif
+    if (!peer || !data || len < MNET_RUDP_PACKET_HEADER) return mnet_error;
+
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + len;
+
+    const uint16_t seq = mnet_rudp_get16(p);
+    const uint16_t ack = mnet_rudp_get16(p + 2);
+    const uint32_t ack_bits = mnet_rudp_get32(p + 4);
+    p += MNET_RUDP_PACKET_HEADER;
+
+    // validate all message headers before touching any state.
+    for (const uint8_t* m = p; m < end; )
+    {
+        if ((size_t)(end - m) < MNET_RUDP_MESSAGE_HEADER) return mnet_error;
+        if (m[0] >= peer->channel_count) return mnet_error;
+
+        const uint16_t msg_len = mnet_rudp_get16(m + 3);
+        if ((size_t)(end - m) - MNET_RUDP_MESSAGE_HEADER < msg_len) return mnet_error;
+        m += MNET_RUDP_MESSAGE_HEADER + msg_len;
+    }
+
+    peer->stats.packets_received++;
+    peer->last_recv_ms = now_ms;
+
+    mnet_rudp_ack_packet(peer, ack, now_ms);
+    for (uint16_t i = 0; i < 32; i++)
+    {
+        if (ack_bits & (1u << i)) mnet_rudp_ack_packet(peer, (uint16_t)(ack - 1 - i), now_ms);
+    }
+
+    if (!peer->has_remote)
+    {
+        peer->has_remote = 1;
+        peer->remote_seq = seq;
+        peer->remote_bits = 0;
+    }
+    else if (mnet_rudp_seq_greater(seq, peer->remote_seq))
+    {
+        const uint16_t shift = (uint16_t)(seq - peer->remote_seq);
+        peer->remote_bits = shift < 32 ? peer->remote_bits << shift : 0;
+        if (shift <= 32) peer->remote_bits |= 1u << (shift - 1);
+        peer->remote_seq = seq;
+    }
+    else
+    {
+        const uint16_t behind = (uint16_t)(peer->remote_seq - seq);
+        if (behind >= 1 && behind <= 32) peer->remote_bits |= 1u << (behind - 1);
+    }
+
+    // bare acks are not acked back.
+    if (p < end) peer->ack_pending = 1;
+
+    while (p < end)
+    {
+        const uint8_t channel = p[0];
+        const uint16_t id = mnet_rudp_get16(p + 1);
+        const uint16_t msg_len = mnet_rudp_get16(p + 3);
+        p += MNET_RUDP_MESSAGE_HEADER;
+
+        if (mnet_rudp_receive_message(peer, channel, id, p, msg_len) != mnet_ok) return mnet_error;
+        p += msg_len;
+    }
+
+    return mnet_ok;
 }
 
-void mnet_iovec_init(mnet_iovec_t* iov, void* base, size_t len)
+int mnet_rudp_update(mnet_rudp_t* peer, uint64_t now_ms)
 {
-    if (!iov) return;
+    if (!peer) return -1;
 
-#ifdef MNET_WINDOWS
-    iov->buf = (char*)base;
-    iov->len = (ULONG)len;
-#elif defined(MNET_UNIX)
-    iov->iov_base = base;
-    iov->iov_len = len;
-#endif
+    uint8_t packet[MNET_RUDP_MAX_MTU];
+    const size_t mtu = peer->mtu < MNET_RUDP_MAX_MTU ? peer->mtu : MNET_RUDP_MAX_MTU;
+    size_t used = MNET_RUDP_PACKET_HEADER;
+    mnet_rudp_sent_packet_t info;
+    int msgs = 0;
+    int datagrams = 0;
+    int result = 0;
+
+    memset(&info, 0, sizeof(info));
+
+    for (int c = 0; c <= peer->channel_count; c++)
+    {
+        mnet_rudp_channel_t* ch = c < peer->channel_count ? &peer->channels[c] : NULL;
+        uint16_t id = ch ? ch->send_oldest : 0;
+        mnet_rudp_msg_t* unreliable = ch ? ch->unreliable_head : NULL;
+
+        for (;;)
+        {
+            mnet_rudp_slot_t* slot = NULL;
+            mnet_rudp_msg_t* msg = NULL;
+
+            if (ch && ch->type == mnet_channel_unreliable_sequenced)
+            {
+                msg = unreliable;
+                if (msg) unreliable = msg->next;
+            }
+            else if (ch)
+            {
+                while (id != ch->send_next && !msg)
+                {
+                    slot = &ch->send_window[id % MNET_RUDP_WINDOW];
+                    id++;
+                    if (slot->msg && (slot->sends == 0 || now_ms >= mnet_rudp_resend_at(peer, slot)))
+                        msg = slot->msg;
+                }
+            }
+
+            // the final pass (ch == NULL) only flushes and sends a bare ack.
+            // a message queued before the mtu shrank goes out alone.
+            const int full = msg && used > MNET_RUDP_PACKET_HEADER &&
+                             (used + MNET_RUDP_MESSAGE_HEADER + msg->len > mtu ||
+                              msgs == MNET_RUDP_MAX_PACKET_MSGS);
+            const int flush = full || (!ch && (used > MNET_RUDP_PACKET_HEADER || peer->ack_pending));
+
+            if (flush)
+            {
+                info.seq = peer->send_seq++;
+                if (peer->send_seq == 0) peer->send_seq = 1;
+                info.valid = (uint8_t)(info.count > 0);
+                info.sent_ms = now_ms;
+
+                mnet_rudp_put16(packet, info.seq);
+                mnet_rudp_put16(packet + 2, peer->remote_seq);
+                mnet_rudp_put32(packet + 4, peer->has_remote ? peer->remote_bits : 0);
+
+                peer->sent[info.seq % MNET_RUDP_WINDOW] = info;
+                peer->ack_pending = 0;
+                peer->stats.packets_sent++;
+
+                // a failed send is treated like a lost datagram.
+                if (mnet_sendto(peer->sock, packet, used, mnet_msg_nosignal,
+                                (const mnet_sockaddr_t*)&peer->addr, peer->addrlen) < 0)
+                    result = -1;
+                else
+                    datagrams++;
+
+                used = MNET_RUDP_PACKET_HEADER;
+                msgs = 0;
+                memset(&info, 0, sizeof(info));
+            }
+
+            if (!msg) break;
+
+            packet[used] = msg->channel;
+            mnet_rudp_put16(packet + used + 1, msg->id);
+            mnet_rudp_put16(packet + used + 3, msg->len);
+            if (msg->len) memcpy(packet + used + MNET_RUDP_MESSAGE_HEADER, msg->data, msg->len);
+            used += MNET_RUDP_MESSAGE_HEADER + msg->len;
+            msgs++;
+
+            if (slot)
+            {
+                if (slot->sends > 0)
+                {
+                    info.resent = 1;
+                    peer->stats.resends++;
+                }
+                if (slot->sends < UINT8_MAX) slot->sends++;
+                slot->sent_ms = now_ms;
+
+                info.channels[info.count] = (uint8_t)c;
+                info.ids[info.count] = msg->id;
+                info.count++;
+            }
+        }
+
+        if (ch && ch->type == mnet_channel_unreliable_sequenced)
+        {
+            mnet_rudp_msg_free_list(ch->unreliable_head);
+            ch->unreliable_head = NULL;
+            ch->unreliable_tail = NULL;
+        }
+    }
+
+    return result < 0 && datagrams == 0 ? -1 : datagrams;
 }
 
-void** mnet_iovec_base(
-    const mnet_iovec_t* iov)
+int mnet_rudp_next_update(const mnet_rudp_t* peer, uint64_t now_ms)
 {
-    return (void**)(&iov->buf);
+    if (!peer) return -1;
+    if (peer->ack_pending) return 0;
+
+    uint64_t next = UINT64_MAX;
+
+    for (int c = 0; c < peer->channel_count; c++)
+    {
+        const mnet_rudp_channel_t* ch = &peer->channels[c];
+
+        if (ch->type == mnet_channel_unreliable_sequenced)
+        {
+            if (ch->unreliable_head) return 0;
+            continue;
+        }
+
+        for (uint16_t id = ch->send_oldest; id != ch->send_next; id++)
+        {
+            const mnet_rudp_slot_t* slot = &ch->send_window[id % MNET_RUDP_WINDOW];
+            if (!slot->msg) continue;
+            if (slot->sends == 0) return 0;
+
+            const uint64_t at = mnet_rudp_resend_at(peer, slot);
+            if (at < next) next = at;
+        }
+    }
+
+    if (next == UINT64_MAX) return -1;
+    if (next <= now_ms) return 0;
+    return next - now_ms > INT32_MAX ? INT32_MAX : (int)(next - now_ms);
 }
 
-void* mnet_iovec_get_base(
-    const mnet_iovec_t iov)
+int mnet_rudp_receive(mnet_rudp_t* peer, uint8_t* channel, void* buf, size_t len)
 {
-    return (void*)iov.buf;
+    if (!peer || !peer->delivery_head) return 0;
+
+    mnet_rudp_msg_t* msg = peer->delivery_head;
+    if (msg->len > len) return -(int)msg->len;
+
+    if (msg->len) memcpy(buf, msg->data, msg->len);
+    if (channel) *channel = msg->channel;
+
+    const int size = (int)msg->len;
+    peer->delivery_head = msg->next;
+    if (!peer->delivery_head) peer->delivery_tail = NULL;
+    free(msg);
+    return size;
 }
 
-void mnet_iovec_set_base(
-    mnet_iovec_t* iov,
-    void* base)
+int mnet_rudp_pending(const mnet_rudp_t* peer)
 {
-    iov->buf = (void*)base;
+    return peer && peer->delivery_head ? 1 : 0;
 }
 
-size_t mnet_iovec_get_len(
-    const mnet_iovec_t iov)
+
+// ================================================
+//            TCP REACTOR (MULTI-THREADED)
+//
+
+
+static mnet_result_t mnet_tcp_reactor_steer(mnet_tcp_reactor_t* reactor)
 {
-    return (size_t)iov.len;
+#if defined(MNET_LINUX) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    // the reuseport group is indexed in bind order, worker N is
+    //  pinned to CPU N, so the receiving CPU picks the worker.
+    //  (only called with one worker per CPU, the modulo just keeps
+    //  CPU ids past mnet_cpu_count inside the group)
+    struct sock_filter code[] =
+    {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU) },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)reactor->count },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+
+    struct sock_fprog prog;
+    prog.len = (unsigned short)(sizeof(code) / sizeof(code[0]));
+    prog.filter = code;
+
+    for (int i = 0; i < reactor->count; i++)
+    {
+        // older kernels select the listener by incoming CPU instead.
+        int cpu = reactor->workers[i].cpu;
+        setsockopt(reactor->workers[i].server.listener, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+    }
+
+    if (setsockopt(reactor->workers[0].server.listener, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                   &prog, sizeof(prog)) != 0)
+        return mnet_error;
+    return mnet_ok;
+#else
+    (void)reactor;
+    return mnet_error;
+#endif
 }
 
-void mnet_iovec_set_len(mnet_iovec_t* iov, size_t len)
+static void mnet_tcp_reactor_main(void* arg)
 {
-#ifdef MNET_WINDOWS
-    iov->len = (u_long)len;
-#elif defined(MNET_UNIX)
-    iov->len = (size_t)len;
-#endif
+    mnet_tcp_reactor_worker_t* worker = (mnet_tcp_reactor_worker_t*)arg;
+    mnet_tcp_reactor_t* reactor = worker->reactor;
+
+    if (worker->cpu >= 0) mnet_thread_pin(worker->cpu);
+
+    while (mnet_atomic_load_u32((const volatile uint32_t*)&reactor->running))
+        mnet_tcp_server_poll(&worker->server, -1);
 }
 
-int mnet_sendv(mnet_socket_t sock, const mnet_iovec_t* iov, int iovcnt, mnet_msg_flags_t flags)
+mnet_result_t mnet_tcp_reactor_init(mnet_tcp_reactor_t* reactor, const mnet_sockaddr_t* addr, mnet_socklen_t addrlen,
+                                    const mnet_tcp_callbacks_t* callbacks, void* user, int threads, uint32_t flags)
 {
-    if (!iov || iovcnt <= 0) return -1;
+    if (!reactor || threads < 0) return mnet_error;
+    memset(reactor, 0, sizeof(*reactor));
 
-#ifdef MNET_WINDOWS
+    const int cpus = mnet_cpu_count();
+    if (threads == 0) threads = cpus;
+    if (flags & mnet_reactor_steer_cpu) flags |= mnet_reactor_pin_cpu;
 
-    DWORD sent = 0;
-    const int result = WSASend(sock, (LPWSABUF)iov, (DWORD)iovcnt, &sent, (DWORD)flags, NULL, NULL);
-    return result == 0 ? (int)sent : -1;
+    // with more workers than CPUs some would never be selected, with fewer
+    //  a connection lands on a worker pinned to another CPU.
+    if (threads != cpus) flags &= ~(uint32_t)mnet_reactor_steer_cpu;
 
-#elif defined(MNET_UNIX)
+    reactor->workers = (mnet_tcp_reactor_worker_t*)calloc((size_t)threads, sizeof(mnet_tcp_reactor_worker_t));
+    if (!reactor->workers) return mnet_error;
+    reactor->flags = flags;
 
-    struct msghdr msg;
-    memset(&msg, 0, sizeof(msg));
-    msg.msg_iov = (struct iovec*)iov;
-    msg.msg_iovlen = iovcnt;
+    // listeners join the reuseport group in this order, the steering program relies on it.
+    for (int i = 0; i < threads; i++)
+    {
+        mnet_tcp_reactor_worker_t* worker = &reactor->workers[i];
+        worker->reactor = reactor;
+        worker->cpu = (flags & mnet_reactor_pin_cpu) ? i % cpus : -1;
 
-    return (int)sendmsg(sock, &msg, (int)flags);
+        if (mnet_tcp_server_setup(&worker->server, addr, addrlen, callbacks, user, threads > 1) != mnet_ok)
+        {
+            mnet_tcp_reactor_destroy(reactor);
+            return mnet_error;
+        }
+        reactor->count++;
+    }
 
-#endif
+    // steering is best effort, the kernel hashes flows without it.
+    if ((flags & mnet_reactor_steer_cpu) && threads > 1)
+        mnet_tcp_reactor_steer(reactor);
+
+    return mnet_ok;
 }
 
-int mnet_recvv(mnet_socket_t sock, mnet_iovec_t* iov, int iovcnt, mnet_msg_flags_t flags)
+mnet_result_t mnet_tcp_reactor_start(mnet_tcp_reactor_t* reactor)
 {
-    if (!iov || iovcnt <= 0) return -1;
-
-#ifdef MNET_WINDOWS
+    if (!reactor || !reactor->workers || reactor->running) return mnet_error;
 
-    DWORD received = 0;
-    DWORD flags_dword = (DWORD)flags;
-    int result = WSARecv(sock, (LPWSABUF)iov, (DWORD)iovcnt, &received, &flags_dword, NULL, NULL);
-    return result == 0 ? (int)received : -1;
+    reactor->running = 1;
 
-#elif defined(MNET_UNIX)
+    for (int i = 0; i < reactor->count; i++)
+    {
+        mnet_tcp_reactor_worker_t* worker = &reactor->workers[i];
+        if (mnet_thread_create(&worker->thread, mnet_tcp_reactor_main, worker) != mnet_ok)
+        {
+            mnet_tcp_reactor_stop(reactor);
+            return mnet_error;
+        }
+        worker->started = 1;
+    }
 
-    struct msghdr msg;
-    memset(&msg, 0, sizeof(msg));
-    msg.msg_iov = (struct iovec*)iov;
-    msg.msg_iovlen = iovcnt;
+    return mnet_ok;
+}
 
-    return (int)recvmsg(sock, &msg, (int)flags);
+void mnet_tcp_reactor_stop(mnet_tcp_reactor_t* reactor)
+{
+    if (!reactor || !reactor->workers) return;
 
+#if defined(_MSC_VER)
+    InterlockedExchange((volatile LONG*)&reactor->running, 0);
+#else
+    __atomic_store_n(&reactor->running, 0, __ATOMIC_RELEASE);
 #endif
-}
 
+    for (int i = 0; i < reactor->count; i++)
+        mnet_tcp_server_wakeup(&reactor->workers[i].server);
 
-// ================================================
-//                DATA TRANSFER (UDP)
-//
+    for (int i = 0; i < reactor->count; i++)
+    {
+        mnet_tcp_reactor_worker_t* worker = &reactor->workers[i];
+        if (!worker->started) continue;
 
+        mnet_thread_join(worker->thread);
+        worker->started = 0;
+    }
+}
 
-int mnet_sendto(mnet_socket_t sock, const void* buf, size_t len, mnet_msg_flags_t flags,
-                const mnet_sockaddr_t* dest_addr, mnet_socklen_t addrlen)
+void mnet_tcp_reactor_destroy(mnet_tcp_reactor_t* reactor)
 {
-#ifdef MNET_WINDOWS
-    return sendto(sock, (const char*)buf, (int)len, (int)flags, dest_addr, addrlen);
-#elif defined(MNET_UNIX)
-    return (int)sendto(sock, buf, len, (int)flags, dest_addr, addrlen);
-#endif
+    if (!reactor) return;
+
+    mnet_tcp_reactor_stop(reactor);
+
+    for (int i = 0; i < reactor->count; i++)
+        mnet_tcp_server_destroy(&reactor->workers[i].server);
+
+    free(reactor->workers);
+    memset(reactor, 0, sizeof(*reactor));
 }
 
-int mnet_recvfrom(mnet_socket_t sock, void* buf, size_t len, mnet_msg_flags_t flags,
-                  mnet_sockaddr_t* src_addr, mnet_socklen_t* addrlen)
+mnet_tcp_server_t* mnet_tcp_reactor_server(mnet_tcp_reactor_t* reactor, int index)
 {
-#ifdef MNET_WINDOWS
-    return recvfrom(sock, (char*)buf, (int)len, (int)flags, src_addr, addrlen);
-#elif defined(MNET_UNIX)
-    return (int)recvfrom(sock, buf, len, (int)flags, src_addr, addrlen);
-#endif
+    if (!reactor || index < 0 || index >= reactor->count) return NULL;
+    return &reactor->workers[index].server;
 }
 
 
 // ================================================
-//                  SOCKET OPTIONS
+//            ASYNC DNS RESOLVER
 //
 
 
-int mnet_setsockopt(mnet_socket_t sock, mnet_sockopt_level_t level, mnet_sockopt_t optname,
-                    const void* optval, mnet_socklen_t optlen)
+#define MNET_DNS_HEADER_SIZE        12
+#define MNET_DNS_PACKET_MAX         1500
+#define MNET_DNS_TYPE_A             1
+#define MNET_DNS_TYPE_AAAA          28
+#define MNET_DNS_CLASS_IN           1
+#define MNET_DNS_DEFAULT_TIMEOUT    5000
+#define MNET_DNS_DEFAULT_ATTEMPTS   2
+#define MNET_DNS_MAX_TTL            86400
+
+typedef struct mnet_dns_query
 {
-#ifdef MNET_WINDOWS
-    return setsockopt(sock, (int)level, (int)optname, (const char*)optval, optlen);
-#elif defined(MNET_UNIX)
-    return setsockopt(sock, (int)level, (int)optname, optval, optlen);
-#endif
+    uint16_t        id;
+    uint8_t         active;     // waiting for an answer.
+    uint8_t         status;     // mnet_dns_status_t once answered.
+} mnet_dns_query_t;
+
+struct mnet_dns_request
+{
+    mnet_dns_request_t*     next;
+    char                    name[MNET_DNS_MAX_NAME + 1];
+    uint16_t                port;
+    uint8_t                 family;
+    int                     attempt;
+    int                     server;
+    uint64_t                deadline_ms;
+    mnet_dns_query_t        queries[2];     // A, AAAA.
+
+    uint32_t                ttl;
+    int                     count;
+    uint8_t                 ipv6[MNET_DNS_MAX_ADDRS];
+    uint8_t                 addrs[MNET_DNS_MAX_ADDRS][16];
+
+    mnet_dns_result_t*      answer;
+    // answered without a query, delivered by the next process.
+
+    mnet_dns_callback_t     callback;
+    void*                   udata;
+};
+
+static int mnet_dns_normalize(const char* name, char* out)
+{
+    size_t len = strlen(name);
+    if (len > 0 && name[len - 1] == '.') len--;
+    if (len == 0 || len > MNET_DNS_MAX_NAME) return -1;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        const char c = name[i];
+        out[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    out[len] = '\0';
+    return 0;
 }
 
-int mnet_getsockopt(mnet_socket_t sock, mnet_sockopt_level_t level, mnet_sockopt_t optname,
-                    void* optval, mnet_socklen_t* optlen)
+static uint32_t mnet_dns_hash(const char* name, uint8_t family)
 {
-#ifdef MNET_WINDOWS
-    return getsockopt(sock, (int)level, (int)optname, (char*)optval, optlen);
-#elif defined(MNET_UNIX)
-    return getsockopt(sock, (int)level, (int)optname, optval, optlen);
-#endif
+    // FNV-1a.
+    uint32_t hash = 2166136261u ^ family;
+    for (; *name; name++)
+    {
+        hash ^= (uint8_t)*name;
+        hash *= 16777619u;
+    }
+    return hash;
 }
 
+static void mnet_dns_fill_result(
+                mnet_dns_result_t* result,
+                uint16_t port,
+                int count,
+                const uint8_t* ipv6,
+                const uint8_t (*addrs)[16])
+{
+    result->count = 0;
+    for (int i = 0; i < count; i++)
+    {
+        mnet_sockaddr_storage* storage = &result->addrs[result->count];
+        memset(storage, 0, sizeof(*storage));
+
+        if (ipv6[i])
+        {
+            mnet_sockaddr_in6_t* in6 = (mnet_sockaddr_in6_t*)storage;
+            in6->sin6_family = AF_INET6;
+            in6->sin6_port = htons(port);
+            memcpy(&in6->sin6_addr, addrs[i], 16);
+            result->addrlens[result->count] = (mnet_socklen_t)sizeof(*in6);
+        }
+        else
+        {
+            mnet_sockaddr_in_t* in = (mnet_sockaddr_in_t*)storage;
+            in->sin_family = AF_INET;
+            in->sin_port = htons(port);
+            memcpy(&in->sin_addr, addrs[i], 4);
+            result->addrlens[result->count] = (mnet_socklen_t)sizeof(*in);
+        }
+        result->count++;
+    }
+}
 
-// ================================================
-//              EXTRA SOCKET CONTROL
-//
+void mnet_dns_cache_init(mnet_dns_cache_t* cache)
+{
+    if (!cache) return;
+    memset(cache, 0, sizeof(*cache));
+}
 
-mnet_result_t mnet_set_blocking(mnet_socket_t sock, const int do_block)
+void mnet_dns_cache_destroy(mnet_dns_cache_t* cache)
 {
-#ifdef MNET_WINDOWS
+    if (!cache) return;
 
-    u_long mode = do_block ? 0 : 1;
-    return ioctlsocket(sock, (long int)FIONBIO, &mode) == 0 ? mnet_ok : mnet_error;
+    for (int i = 0; i < MNET_DNS_CACHE_BUCKETS; i++)
+    {
+        mnet_dns_cache_entry_t* entry = cache->buckets[i];
+        while (entry)
+        {
+            mnet_dns_cache_entry_t* next = entry->next;
+            free(entry);
+            entry = next;
+        }
+        cache->buckets[i] = NULL;
+    }
+    cache->count = 0;
+}
 
-#elif defined(MNET_UNIX)
+static int mnet_dns_cache_lookup(
+                mnet_dns_cache_t* cache,
+                const char* name,
+                uint8_t family,
+                uint16_t port,
+                uint64_t now_ms,
+                mnet_dns_result_t* result)
+{
+    const uint32_t bucket = mnet_dns_hash(name, family) % MNET_DNS_CACHE_BUCKETS;
+    int found = 0;
 
-    int flags = fcntl(sock, F_GETFL, 0);
-    if (flags == -1) return mnet_error;
+    mnet_spin_lock(&cache->lock);
 
-    if (do_block)
-        flags &= ~O_NONBLOCK;
-    else
-        flags |= O_NONBLOCK;
+    mnet_dns_cache_entry_t** link = &cache->buckets[bucket];
+    while (*link)
+    {
+        mnet_dns_cache_entry_t* entry = *link;
+
+        if (entry->expires_ms <= now_ms)
+        {
+            *link = entry->next;
+            cache->count--;
+            free(entry);
+            continue;
+        }
+
+        if (entry->family == family && strcmp(entry->name, name) == 0)
+        {
+            result->status = (mnet_dns_status_t)entry->status;
+            result->ttl = (uint32_t)((entry->expires_ms - now_ms + 999) / 1000);
+            mnet_dns_fill_result(result, port, entry->count, entry->ipv6, (const uint8_t (*)[16])entry->addrs);
+            found = 1;
+            break;
+        }
+        link = &entry->next;
+    }
 
-    return fcntl(sock, F_SETFL, flags) == 0 ? mnet_ok : mnet_error;
+    mnet_spin_unlock(&cache->lock);
+    return found;
+}
 
-#endif
+static void mnet_dns_cache_purge(mnet_dns_cache_t* cache, uint64_t now_ms)
+{
+    for (int i = 0; i < MNET_DNS_CACHE_BUCKETS; i++)
+    {
+        mnet_dns_cache_entry_t** link = &cache->buckets[i];
+        while (*link)
+        {
+            mnet_dns_cache_entry_t* entry = *link;
+            if (entry->expires_ms <= now_ms)
+            {
+                *link = entry->next;
+                cache->count--;
+                free(entry);
+            }
+            else link = &entry->next;
+        }
+    }
 }
 
-mnet_result_t mnet_set_reuseaddr(
-    const mnet_socket_t sock,
-    const int do_reuse)
-{
-    if (sock == MNET_INVALID_SOCKET) return mnet_error;
+static void mnet_dns_cache_store(mnet_dns_cache_t* cache, const mnet_dns_request_t* request,
+                                 mnet_dns_status_t status, uint32_t ttl, uint64_t now_ms)
+{
+    if (ttl == 0) return;
+
+    mnet_dns_cache_entry_t* fresh = (mnet_dns_cache_entry_t*)malloc(sizeof(*fresh));
+    if (!fresh) return;
+
+    memset(fresh, 0, sizeof(*fresh));
+    fresh->expires_ms = now_ms + (uint64_t)ttl * 1000;
+    fresh->family = request->family;
+    fresh->status = (uint8_t)status;
+    fresh->count = (uint8_t)request->count;
+    memcpy(fresh->ipv6, request->ipv6, sizeof(fresh->ipv6));
+    memcpy(fresh->addrs, request->addrs, sizeof(fresh->addrs));
+    memcpy(fresh->name, request->name, sizeof(fresh->name));
+
+    const uint32_t bucket = mnet_dns_hash(fresh->name, fresh->family) % MNET_DNS_CACHE_BUCKETS;
+
+    mnet_spin_lock(&cache->lock);
+
+    // replace an older answer for the same name.
+    mnet_dns_cache_entry_t** link = &cache->buckets[bucket];
+    while (*link)
+    {
+        mnet_dns_cache_entry_t* entry = *link;
+        if (entry->family == fresh->family && strcmp(entry->name, fresh->name) == 0)
+        {
+            *link = entry->next;
+            cache->count--;
+            free(entry);
+            break;
+        }
+        link = &entry->next;
+    }
 
-    int optval = do_reuse ? 1 : 0;
+    if (cache->count >= MNET_DNS_CACHE_MAX) mnet_dns_cache_purge(cache, now_ms);
 
-#ifdef MNET_WINDOWS
-    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&optval, sizeof(optval)) != 0)
-        return mnet_error;
-#elif defined(MNET_UNIX)
-    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) != 0)
-        return mnet_error;
-#endif
+    if (cache->count < MNET_DNS_CACHE_MAX)
+    {
+        fresh->next = cache->buckets[bucket];
+        cache->buckets[bucket] = fresh;
+        cache->count++;
+        fresh = NULL;
+    }
 
-    return mnet_ok;
+    mnet_spin_unlock(&cache->lock);
+    free(fresh);
 }
 
-int mnet_available(mnet_socket_t sock, unsigned long* bytes)
+static int mnet_dns_add_server(mnet_resolver_t* resolver, const char* ip)
 {
-    if (!bytes) return mnet_error;
+    if (resolver->server_count >= MNET_DNS_MAX_SERVERS) return -1;
 
-#ifdef MNET_WINDOWS
-    return ioctlsocket(sock, FIONREAD, bytes) == 0 ? mnet_ok : mnet_error;
-#elif defined(MNET_UNIX)
-    return ioctl(sock, FIONREAD, bytes) == 0 ? mnet_ok : mnet_error;
-#endif
-}
+    mnet_sockaddr_storage* storage = &resolver->servers[resolver->server_count];
+    memset(storage, 0, sizeof(*storage));
 
-// ================================================
-//             I/O MULTIPLEXING (POLL)
-//
+    mnet_sockaddr_in_t* in = (mnet_sockaddr_in_t*)storage;
+    mnet_sockaddr_in6_t* in6 = (mnet_sockaddr_in6_t*)storage;
 
-int mnet_poll(mnet_pollfd_t* fds, int nfds, int timeout)
-{
-    if (!fds) return mnet_error;
+    if (mnet_inet_pton(mnet_af_inet, ip, &in->sin_addr) == 1)
+    {
+        in->sin_family = AF_INET;
+        in->sin_port = htons(53);
+        resolver->server_lens[resolver->server_count] = (mnet_socklen_t)sizeof(*in);
+    }
+    else if (mnet_inet_pton(mnet_af_inet6, ip, &in6->sin6_addr) == 1)
+    {
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(53);
+        resolver->server_lens[resolver->server_count] = (mnet_socklen_t)sizeof(*in6);
+    }
+    else return -1;
 
-#ifdef MNET_WINDOWS
-    return WSAPoll((WSAPOLLFD*)fds, (ULONG)nfds, timeout);
-#elif defined(MNET_UNIX)
-    return poll((struct pollfd*)fds, nfds, timeout);
-#endif
+    // one socket, so every server has to share the first one's family.
+    if (resolver->server_count > 0 && storage->ss_family != resolver->servers[0].ss_family) return -1;
+
+    resolver->server_count++;
+    return 0;
 }
 
-int mnet_pollfd_has_event(const mnet_pollfd_t* pfd, short event)
+static void mnet_dns_strip_line(char* line, const char* comments)
 {
-    if (!pfd) return 0;
-    return (pfd->revents & event) != 0;
+    // cut the line at its newline or first comment character.
+    line[strcspn(line, comments)] = '\0';
 }
 
+static char* mnet_dns_next_token(char** cursor)
+{
+    char* p = *cursor;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '\0') return NULL;
 
-// ================================================
-//           ADDRESS AND NAME RESOLUTION
-//
-
+    char* start = p;
+    while (*p && *p != ' ' && *p != '\t') p++;
+    if (*p) *p++ = '\0';
 
-int mnet_getsockname(mnet_socket_t sock, mnet_sockaddr_t* addr, mnet_socklen_t* addrlen)
-{
-    return getsockname(sock, addr, addrlen);
+    *cursor = p;
+    return start;
 }
 
-int mnet_getpeername(mnet_socket_t sock, mnet_sockaddr_t* addr, mnet_socklen_t* addrlen)
+static void mnet_dns_read_resolv_conf(mnet_resolver_t* resolver)
 {
-    return getpeername(sock, addr, addrlen);
+    FILE* file = fopen(MNET_RESOLV_CONF_PATH, "r");
+    if (!file) return;
+
+    char line[512];
+    while (fgets(line, sizeof(line), file))
+    {
+        mnet_dns_strip_line(line, "#;\r\n");
+        char* cursor = line;
+        const char* key = mnet_dns_next_token(&cursor);
+        if (!key) continue;
+
+        if (strcmp(key, "nameserver") == 0)
+        {
+            const char* ip = mnet_dns_next_token(&cursor);
+            if (ip) mnet_dns_add_server(resolver, ip);
+        }
+        else if (strcmp(key, "options") == 0)
+        {
+            const char* option;
+            while ((option = mnet_dns_next_token(&cursor)) != NULL)
+            {
+                if (strncmp(option, "timeout:", 8) == 0)
+                {
+                    const int seconds = atoi(option + 8);
+                    if (seconds > 0 && seconds <= 30) resolver->timeout_ms = seconds * 1000;
+                }
+                else if (strncmp(option, "attempts:", 9) == 0)
+                {
+                    const int attempts = atoi(option + 9);
+                    if (attempts > 0 && attempts <= 5) resolver->attempts = attempts;
+                }
+            }
+        }
+    }
+
+    fclose(file);
 }
 
-int mnet_getaddrinfo(const char* node, const char* service,
-                     const struct addrinfo* hints, struct addrinfo** res)
+static void mnet_dns_read_hosts(mnet_resolver_t* resolver)
 {
-    return getaddrinfo(node, service, hints, res);
+    FILE* file = fopen(MNET_HOSTS_PATH, "r");
+    if (!file) return;
+
+    int capacity = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), file))
+    {
+        mnet_dns_strip_line(line, "#\r\n");
+        char* cursor = line;
+        const char* ip = mnet_dns_next_token(&cursor);
+        if (!ip) continue;
+
+        uint8_t addr[16];
+        uint8_t ipv6;
+        if (mnet_inet_pton(mnet_af_inet, ip, addr) == 1) ipv6 = 0;
+        else if (mnet_inet_pton(mnet_af_inet6, ip, addr) == 1) ipv6 = 1;
+        else continue;
+
+        const char* name;
+        while ((name = mnet_dns_next_token(&cursor)) != NULL)
+        {
+            char normalized[MNET_DNS_MAX_NAME + 1];
+            if (mnet_dns_normalize(name, normalized) != 0) continue;
+
+            if (resolver->host_count == capacity)
+            {
+                const int grown = capacity ? capacity * 2 : 16;
+                mnet_dns_host_t* hosts = (mnet_dns_host_t*)realloc(resolver->hosts, (size_t)grown * sizeof(*hosts));
+                if (!hosts) { fclose(file); return; }
+                resolver->hosts = hosts;
+                capacity = grown;
+            }
+
+            const size_t len = strlen(normalized) + 1;
+            char* copy = (char*)malloc(len);
+            if (!copy) { fclose(file); return; }
+            memcpy(copy, normalized, len);
+
+            mnet_dns_host_t* host = &resolver->hosts[resolver->host_count++];
+            host->name = copy;
+            host->ipv6 = ipv6;
+            memcpy(host->addr, addr, 16);
+        }
+    }
+
+    fclose(file);
 }
 
-void mnet_freeaddrinfo(struct addrinfo* res)
+static uint16_t mnet_dns_random_id(mnet_resolver_t* resolver)
 {
-    freeaddrinfo(res);
+    for (;;)
+    {
+        // xorshift32.
+        uint32_t x = resolver->rng;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        resolver->rng = x;
+
+        const uint16_t id = (uint16_t)(x >> 16);
+        int taken = 0;
+        for (const mnet_dns_request_t* r = resolver->requests; r && !taken; r = r->next)
+            taken = (r->queries[0].active && r->queries[0].id == id) ||
+                    (r->queries[1].active && r->queries[1].id == id);
+        if (!taken) return id;
+    }
 }
 
-int mnet_getnameinfo(const mnet_sockaddr_t* addr, mnet_socklen_t addrlen,
-                     char* host, mnet_socklen_t hostlen,
-                     char* serv, mnet_socklen_t servlen, int flags)
+static void mnet_dns_send_query(mnet_resolver_t* resolver, mnet_dns_request_t* request, int type_index)
 {
-#ifdef MNET_WINDOWS
-    return getnameinfo(addr, addrlen, host, (DWORD)hostlen, serv, (DWORD)servlen, flags);
-#elif defined(MNET_UNIX)
-    return getnameinfo(addr, addrlen, host, hostlen, serv, servlen, flags);
-#endif
+    uint8_t packet[MNET_DNS_HEADER_SIZE + MNET_DNS_MAX_NAME + 2 + 4];
+    mnet_dns_query_t* query = &request->queries[type_index];
+    query->id = mnet_dns_random_id(resolver);
+
+    memset(packet, 0, MNET_DNS_HEADER_SIZE);
+    packet[0] = (uint8_t)(query->id >> 8);
+    packet[1] = (uint8_t)query->id;
+    packet[2] = 0x01;       // RD.
+    packet[5] = 1;          // QDCOUNT.
+
+    // labels were checked in mnet_resolver_resolve.
+    size_t pos = MNET_DNS_HEADER_SIZE;
+    const char* label = request->name;
+    for (;;)
+    {
+        const char* dot = strchr(label, '.');
+        const size_t len = dot ? (size_t)(dot - label) : strlen(label);
+        packet[pos++] = (uint8_t)len;
+        memcpy(packet + pos, label, len);
+        pos += len;
+        if (!dot) break;
+        label = dot + 1;
+    }
+    packet[pos++] = 0;
+
+    const uint16_t type = type_index ? MNET_DNS_TYPE_AAAA : MNET_DNS_TYPE_A;
+    packet[pos++] = (uint8_t)(type >> 8);
+    packet[pos++] = (uint8_t)type;
+    packet[pos++] = 0;
+    packet[pos++] = MNET_DNS_CLASS_IN;
+
+    // a failed send is handled like a lost datagram.
+    mnet_sendto(resolver->sock, packet, pos, mnet_msg_none,
+                (const mnet_sockaddr_t*)&resolver->servers[request->server],
+                resolver->server_lens[request->server]);
 }
 
-int mnet_inet_pton(mnet_address_family_t af, const char* src, void* dst)
+static void mnet_dns_send_request(mnet_resolver_t* resolver, mnet_dns_request_t* request, uint64_t now_ms)
 {
-#ifdef MNET_WINDOWS
-    return InetPtonA((int)af, src, dst);
-#elif defined(MNET_UNIX)
-    return inet_pton((int)af, src, dst);
-#endif
+    request->server = request->attempt % resolver->server_count;
+    request->deadline_ms = now_ms + (uint64_t)resolver->timeout_ms;
+
+    for (int i = 0; i < 2; i++)
+        if (request->queries[i].active) mnet_dns_send_query(resolver, request, i);
 }
 
-const char* mnet_inet_ntop(mnet_address_family_t af, const void* src, char* dst, mnet_socklen_t size)
+mnet_result_t mnet_resolver_init(mnet_resolver_t* resolver, mnet_dns_cache_t* cache)
 {
-#ifdef MNET_WINDOWS
-    return InetNtopA((int)af, (void*)src, dst, (size_t)size);
-#elif defined(MNET_UNIX)
-    return inet_ntop((int)af, src, dst, size);
-#endif
-}
+    if (!resolver) return mnet_error;
 
+    memset(resolver, 0, sizeof(*resolver));
+    resolver->sock = MNET_INVALID_SOCKET;
+    resolver->timeout_ms = MNET_DNS_DEFAULT_TIMEOUT;
+    resolver->attempts = MNET_DNS_DEFAULT_ATTEMPTS;
 
-// ================================================
-//              ADDRESS UTILITIES
-//
+    if (cache)
+    {
+        resolver->cache = cache;
+    }
+    else
+    {
+        resolver->cache = (mnet_dns_cache_t*)malloc(sizeof(mnet_dns_cache_t));
+        if (!resolver->cache) return mnet_error;
+        mnet_dns_cache_init(resolver->cache);
+        resolver->owns_cache = 1;
+    }
 
+    mnet_dns_read_resolv_conf(resolver);
+    if (resolver->server_count == 0) mnet_dns_add_server(resolver, "127.0.0.1");
+    mnet_dns_read_hosts(resolver);
+
+    resolver->rng = (uint32_t)mnet_time_ns() ^ (uint32_t)(uintptr_t)resolver;
+    if (resolver->rng == 0) resolver->rng = 0x9e3779b9u;
+
+    const mnet_address_family_t af =
+        resolver->servers[0].ss_family == AF_INET6 ? mnet_af_inet6 : mnet_af_inet;
+    resolver->sock = mnet_socket(af, mnet_sock_dgram, mnet_ipproto_udp);
+    if (resolver->sock == MNET_INVALID_SOCKET || mnet_set_blocking(resolver->sock, 0) != mnet_ok)
+    {
+        mnet_resolver_destroy(resolver);
+        return mnet_error;
+    }
 
-mnet_result_t mnet_get_family(const mnet_sockaddr_t* addr, mnet_address_family_t* out_family)
-{
-    if (!addr || !out_family) return mnet_error;
-    *out_family = (mnet_address_family_t)addr->sa_family;
     return mnet_ok;
 }
 
-int mnet_addr_ip_to_string(
-    const mnet_sockaddr_t* addr,
-    char ip_buf[],
-    size_t ip_buf_size)
+void mnet_resolver_destroy(mnet_resolver_t* resolver)
 {
-    if (!addr || !ip_buf) return mnet_error;
+    if (!resolver) return;
 
-    if (addr->sa_family == AF_INET)
-    {
-        mnet_sockaddr_in_t* addr_in = (mnet_sockaddr_in_t*)addr;
-        if (mnet_inet_ntop(mnet_af_inet, &addr_in->sin_addr, ip_buf, (mnet_socklen_t)ip_buf_size) == NULL)
-            return mnet_error;
+    if (resolver->sock != MNET_INVALID_SOCKET) mnet_close(resolver->sock);
+    resolver->sock = MNET_INVALID_SOCKET;
 
-        return mnet_ok;
-    }
-    else if (addr->sa_family == AF_INET6)
+    while (resolver->requests)
     {
-        mnet_sockaddr_in6_t* addr_in6 = (mnet_sockaddr_in6_t*)addr;
-        if (mnet_inet_ntop(mnet_af_inet6, &addr_in6->sin6_addr, ip_buf, (mnet_socklen_t)ip_buf_size) == NULL)
-            return mnet_error;
-
-        return mnet_ok;
+        mnet_dns_request_t* next = resolver->requests->next;
+        free(resolver->requests);
+        resolver->requests = next;
     }
 
-    return mnet_error;
+    for (int i = 0; i < resolver->host_count; i++) free(resolver->hosts[i].name);
+    free(resolver->hosts);
+    resolver->hosts = NULL;
+    resolver->host_count = 0;
+
+    if (resolver->owns_cache)
+    {
+        mnet_dns_cache_destroy(resolver->cache);
+        free(resolver->cache);
+    }
+    resolver->cache = NULL;
+    resolver->owns_cache = 0;
 }
 
-// mnet_addr_to_string.
+mnet_result_t mnet_resolver_set_nameserver(
+                mnet_resolver_t* resolver,
+                const mnet_sockaddr_t* addr,
+                mnet_socklen_t addrlen)
+{
+    if (!resolver || !addr || addrlen <= 0 || (size_t)addrlen > sizeof(mnet_sockaddr_storage)) return mnet_error;
+    if (addr->sa_family != resolver->servers[0].ss_family) return mnet_error;
+
+    memset(&resolver->servers[0], 0, sizeof(resolver->servers[0]));
+    memcpy(&resolver->servers[0], addr, (size_t)addrlen);
+    resolver->server_lens[0] = addrlen;
+    resolver->server_count = 1;
+    return mnet_ok;
+}
 
-uint16_t mnet_addr_get_port(const mnet_sockaddr_t* addr)
+static int mnet_dns_answer_local(
+                mnet_resolver_t* resolver,
+                const char* name,
+                uint16_t port,
+                uint8_t family,
+                mnet_dns_result_t* result)
 {
-    if (!addr) return 0;
+    uint8_t ipv6[MNET_DNS_MAX_ADDRS];
+    uint8_t addrs[MNET_DNS_MAX_ADDRS][16];
+    int count = 0;
+    int listed = 0;
 
-    if (addr->sa_family == AF_INET)
+    // IP literal.
+    if (mnet_inet_pton(mnet_af_inet, name, addrs[0]) == 1) ipv6[0] = 0;
+    else if (mnet_inet_pton(mnet_af_inet6, name, addrs[0]) == 1) ipv6[0] = 1;
+    else ipv6[0] = 2;
+
+    if (ipv6[0] != 2)
     {
-        mnet_sockaddr_in_t* addr_in = (mnet_sockaddr_in_t*)addr;
-        return mnet_ntohs(addr_in->sin_port);
+        count = (family & (ipv6[0] ? mnet_dns_ipv6 : mnet_dns_ipv4)) ? 1 : 0;
+        listed = 1;
     }
-    else if (addr->sa_family == AF_INET6)
+    else
     {
-        const mnet_sockaddr_in6_t* addr_in6 = (mnet_sockaddr_in6_t*)addr;
-        return mnet_ntohs(addr_in6->sin6_port);
+        // hosts file, ipv4 first like the dns answers.
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (int i = 0; i < resolver->host_count; i++)
+            {
+                const mnet_dns_host_t* host = &resolver->hosts[i];
+                if (host->ipv6 != pass || strcmp(host->name, name) != 0) continue;
+
+                // a name only listed for the other family is still answered here.
+                listed = 1;
+                if (!(family & (pass ? mnet_dns_ipv6 : mnet_dns_ipv4)) || count == MNET_DNS_MAX_ADDRS) continue;
+
+                ipv6[count] = host->ipv6;
+                memcpy(addrs[count], host->addr, 16);
+                count++;
+            }
+        }
     }
 
-    return 0;
+    if (!listed) return 0;
+
+    result->status = count ? mnet_dns_ok : mnet_dns_not_found;
+    result->ttl = 0;
+    mnet_dns_fill_result(result, port, count, ipv6, (const uint8_t (*)[16])addrs);
+    return 1;
 }
 
-int mnet_addr_set_port(mnet_sockaddr_t* addr, uint16_t port)
+mnet_result_t mnet_resolver_resolve(
+                mnet_resolver_t* resolver,
+                const char* name,
+                uint16_t port,
+                mnet_dns_family_t family,
+                mnet_dns_callback_t callback,
+                void* udata)
 {
-    if (!addr) return mnet_error;
+    if (!resolver || !name || !callback || !(family & mnet_dns_any)) return mnet_error;
+    if (resolver->sock == MNET_INVALID_SOCKET) return mnet_error;
 
-    if (addr->sa_family == AF_INET)
+    char normalized[MNET_DNS_MAX_NAME + 1];
+    if (mnet_dns_normalize(name, normalized) != 0) return mnet_error;
+
+    const uint8_t wanted = (uint8_t)(family & mnet_dns_any);
+    const uint64_t now_ms = mnet_time_ms();
+
+    mnet_dns_result_t result;
+    if (mnet_dns_answer_local(resolver, normalized, port, wanted, &result) ||
+        mnet_dns_cache_lookup(resolver->cache, normalized, wanted, port, now_ms, &result))
     {
-        mnet_sockaddr_in_t* addr_in = (mnet_sockaddr_in_t*)addr;
-        addr_in->sin_port = mnet_htons(port);
+        // not called from here, the caller may not expect it inside
+        //  resolve. it finishes with the next process instead.
+        mnet_dns_request_t* request = (mnet_dns_request_t*)malloc(sizeof(*request) + sizeof(result));
+        if (!request) return mnet_error;
+
+        memset(request, 0, sizeof(*request));
+        memcpy(request->name, normalized, sizeof(request->name));
+        request->answer = (mnet_dns_result_t*)(request + 1);
+        memcpy(request->answer, &result, sizeof(result));
+        request->callback = callback;
+        request->udata = udata;
+
+        request->next = resolver->requests;
+        resolver->requests = request;
         return mnet_ok;
     }
-    else if (addr->sa_family == AF_INET6)
+
+    // every label has to fit the 63 byte length prefix.
+    const char* label = normalized;
+    for (;;)
     {
-        mnet_sockaddr_in6_t* addr_in6 = (mnet_sockaddr_in6_t*)addr;
-        addr_in6->sin6_port = mnet_htons(port);
-        return mnet_ok;
+        const char* dot = strchr(label, '.');
+        const size_t len = dot ? (size_t)(dot - label) : strlen(label);
+        if (len == 0 || len > 63) return mnet_error;
+        if (!dot) break;
+        label = dot + 1;
     }
 
-    return mnet_error;
+    mnet_dns_request_t* request = (mnet_dns_request_t*)malloc(sizeof(*request));
+    if (!request) return mnet_error;
+
+    memset(request, 0, sizeof(*request));
+    memcpy(request->name, normalized, sizeof(request->name));
+    request->port = port;
+    request->family = wanted;
+    request->ttl = UINT32_MAX;
+    request->callback = callback;
+    request->udata = udata;
+    request->queries[0].active = (wanted & mnet_dns_ipv4) ? 1 : 0;
+    request->queries[1].active = (wanted & mnet_dns_ipv6) ? 1 : 0;
+    request->queries[0].status = mnet_dns_timeout;
+    request->queries[1].status = mnet_dns_timeout;
+
+    // link first so the random ids see each other.
+    request->next = resolver->requests;
+    resolver->requests = request;
+
+    mnet_dns_send_request(resolver, request, now_ms);
+    return mnet_ok;
 }
 
-
-// ================================================
-//              BYTE ORDER CONVERSION
-//
-
-uint16_t mnet_htons(uint16_t hostshort)
+mnet_socket_t mnet_resolver_socket(const mnet_resolver_t* resolver)
 {
-    return htons(hostshort);
+    return resolver ? resolver->sock : MNET_INVALID_SOCKET;
 }
 
-uint16_t mnet_ntohs(uint16_t netshort)
+static size_t mnet_dns_read_name(const uint8_t* msg, size_t len, size_t pos, char* out, size_t outsize)
 {
-    return ntohs(netshort);
-}
+    // returns the offset after the name, 0 if malformed.
+    //  (compression pointers are followed, out can be NULL)
+    size_t end = 0;
+    size_t written = 0;
+    int jumps = 0;
 
-uint32_t mnet_htonl(uint32_t hostlong)
-{
-    return htonl(hostlong);
-}
+    for (;;)
+    {
+        if (pos >= len) return 0;
+        const uint8_t c = msg[pos];
+
+        if ((c & 0xC0) == 0xC0)
+        {
+            if (pos + 1 >= len || ++jumps > 64) return 0;
+            if (!end) end = pos + 2;
+            pos = ((size_t)(c & 0x3F) << 8) | msg[pos + 1];
+            continue;
+        }
+        if (c & 0xC0) return 0;
+
+        pos++;
+        if (c == 0) break;
+        if (pos + c > len) return 0;
+
+        if (out)
+        {
+            if (written + c + 1 >= outsize) return 0;
+            if (written) out[written++] = '.';
+            for (size_t i = 0; i < c; i++)
+            {
+                const char ch = (char)msg[pos + i];
+                out[written++] = (ch >= 'A' && ch <= 'Z') ? (char)(ch - 'A' + 'a') : ch;
+            }
+        }
+        pos += c;
+    }
 
-uint32_t mnet_ntohl(uint32_t netlong)
-{
-    return ntohl(netlong);
+    if (out) out[written] = '\0';
+    return end ? end : pos;
 }
 
-
-// ================================================
-//                  ERROR HANDLING
-//
-
-
-mnet_error_t mnet_get_platform_error(void)
+static int mnet_dns_from_server(const mnet_resolver_t* resolver, const mnet_dns_request_t* request,
+                                const mnet_sockaddr_storage* from)
 {
-#ifdef MNET_WINDOWS
-    return (mnet_error_t)WSAGetLastError();
-#elif defined(MNET_UNIX)
-    return (mnet_error_t)errno;
-#endif
-}
+    const mnet_sockaddr_storage* server = &resolver->servers[request->server];
+    if (from->ss_family != server->ss_family) return 0;
 
-const char* mnet_error_string(
-    const mnet_error_t error_code)
-{
-#ifdef MNET_WINDOWS
-    static char buf[256];
-    FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-                   NULL, (DWORD)error_code, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                   buf, sizeof(buf), NULL);
-    return buf;
-#elif defined(MNET_UNIX)
-    return strerror(error_code);
-#endif
+    if (from->ss_family == AF_INET)
+    {
+        const mnet_sockaddr_in_t* a = (const mnet_sockaddr_in_t*)from;
+        const mnet_sockaddr_in_t* b = (const mnet_sockaddr_in_t*)server;
+        return a->sin_port == b->sin_port && memcmp(&a->sin_addr, &b->sin_addr, 4) == 0;
+    }
+
+    const mnet_sockaddr_in6_t* a = (const mnet_sockaddr_in6_t*)from;
+    const mnet_sockaddr_in6_t* b = (const mnet_sockaddr_in6_t*)server;
+    return a->sin6_port == b->sin6_port && memcmp(&a->sin6_addr, &b->sin6_addr, 16) == 0;
 }
 
-void mnet_error_string_r(mnet_error_t error_code, char* buf, size_t bufsize)
+static void mnet_dns_handle_response(mnet_resolver_t* resolver, const uint8_t* msg, size_t len,
+                                     const mnet_sockaddr_storage* from)
 {
-#ifdef MNET_WINDOWS
-    FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-                   NULL, (DWORD)error_code, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                   buf, (DWORD)bufsize, NULL);
-#elif defined(MNET_UNIX)
-    strerror_r(error_code, buf, bufsize);
-#endif
-}
+    if (len < MNET_DNS_HEADER_SIZE || !(msg[2] & 0x80)) return;
 
+    const uint16_t id = (uint16_t)((msg[0] << 8) | msg[1]);
+    mnet_dns_request_t* request = resolver->requests;
+    int type_index = -1;
 
-// ================================================
-//              ADDRESS CREATORS
-//
+    for (; request; request = request->next)
+    {
+        if (request->queries[0].active && request->queries[0].id == id) { type_index = 0; break; }
+        if (request->queries[1].active && request->queries[1].id == id) { type_index = 1; break; }
+    }
+    if (!request || !mnet_dns_from_server(resolver, request, from)) return;
 
+    const uint16_t qdcount = (uint16_t)((msg[4] << 8) | msg[5]);
+    const uint16_t ancount = (uint16_t)((msg[6] << 8) | msg[7]);
+    const uint16_t want_type = type_index ? MNET_DNS_TYPE_AAAA : MNET_DNS_TYPE_A;
+    if (qdcount != 1) return;
 
-int mnet_addr_ipv4(struct sockaddr_in *addr, const char *ip, uint16_t port)
-{
-    if (!addr) return -1;
+    // the question has to be ours, or it is a spoofed or stale answer.
+    char qname[MNET_DNS_MAX_NAME + 2];
+    size_t pos = mnet_dns_read_name(msg, len, MNET_DNS_HEADER_SIZE, qname, sizeof(qname));
+    if (!pos || pos + 4 > len || strcmp(qname, request->name) != 0) return;
+    if (((msg[pos] << 8) | msg[pos + 1]) != want_type) return;
+    pos += 4;
 
-    memset(addr, 0, sizeof(*addr));
-    addr->sin_family = AF_INET;
-    addr->sin_port = htons(port);
+    mnet_dns_query_t* query = &request->queries[type_index];
+    const int rcode = msg[3] & 0x0F;
 
-    if (!ip || strcmp(ip, "0.0.0.0") == 0)
+    if (rcode == 3)
     {
-        addr->sin_addr.s_addr = INADDR_ANY;
-        return 0;
+        query->status = mnet_dns_not_found;
+    }
+    else if (rcode != 0)
+    {
+        query->status = mnet_dns_failed;
+    }
+    else
+    {
+        int found = 0;
+        for (uint16_t i = 0; i < ancount; i++)
+        {
+            pos = mnet_dns_read_name(msg, len, pos, NULL, 0);
+            if (!pos || pos + 10 > len) break;
+
+            const uint16_t type = (uint16_t)((msg[pos] << 8) | msg[pos + 1]);
+            const uint16_t klass = (uint16_t)((msg[pos + 2] << 8) | msg[pos + 3]);
+            const uint32_t ttl = ((uint32_t)msg[pos + 4] << 24) | ((uint32_t)msg[pos + 5] << 16) |
+                                 ((uint32_t)msg[pos + 6] << 8) | (uint32_t)msg[pos + 7];
+            const uint16_t rdlen = (uint16_t)((msg[pos + 8] << 8) | msg[pos + 9]);
+            pos += 10;
+            if (pos + rdlen > len) break;
+
+            // CNAME chains come along in the same answer, the records
+            //  of the wanted type are the final addresses.
+            const size_t size = type_index ? 16 : 4;
+            if (type == want_type && klass == MNET_DNS_CLASS_IN && rdlen == size)
+            {
+                found++;
+                if (ttl < request->ttl) request->ttl = ttl;
+                if (request->count < MNET_DNS_MAX_ADDRS)
+                {
+                    request->ipv6[request->count] = (uint8_t)type_index;
+                    memcpy(request->addrs[request->count], msg + pos, size);
+                    request->count++;
+                }
+            }
+            pos += rdlen;
+        }
+        query->status = found ? mnet_dns_ok : mnet_dns_not_found;
     }
 
-    return inet_pton(AF_INET, ip, &addr->sin_addr) == 1 ? 0 : -1;
+    query->active = 0;
 }
 
-int mnet_addr_ipv6(struct sockaddr_in6 *addr, const char *ip, uint16_t port)
+static mnet_dns_status_t mnet_dns_request_status(const mnet_dns_request_t* request)
 {
-    if (!addr) return -1;
+    if (request->count > 0) return mnet_dns_ok;
 
-    memset(addr, 0, sizeof(*addr));
-    addr->sin6_family = AF_INET6;
-    addr->sin6_port = htons(port);
-
-    if (!ip || strcmp(ip, "::") == 0)
+    mnet_dns_status_t status = mnet_dns_not_found;
+    for (int i = 0; i < 2; i++)
     {
-        addr->sin6_addr = in6addr_any;
-        return 0;
+        if (!(request->family & (i ? mnet_dns_ipv6 : mnet_dns_ipv4))) continue;
+        const mnet_dns_status_t query = (mnet_dns_status_t)request->queries[i].status;
+        if (query == mnet_dns_timeout || query == mnet_dns_failed) status = query;
     }
-
-    return inet_pton(AF_INET6, ip, &addr->sin6_addr) == 1 ? 0 : -1;
+    return status;
 }
 
-int mnet_addr_any_ipv4(struct sockaddr_in *addr, uint16_t port)
+int mnet_resolver_process(mnet_resolver_t* resolver, uint64_t now_ms)
 {
-    return mnet_addr_ipv4(addr, NULL, port);
+    if (!resolver || resolver->sock == MNET_INVALID_SOCKET) return 0;
+
+    uint8_t packet[MNET_DNS_PACKET_MAX];
+    for (;;)
+    {
+        mnet_sockaddr_storage from;
+        mnet_socklen_t fromlen = (mnet_socklen_t)sizeof(from);
+        const int n = mnet_recvfrom(resolver->sock, packet, sizeof(packet), mnet_msg_none,
+                                    (mnet_sockaddr_t*)&from, &fromlen);
+        if (n < 0) break;
+        mnet_dns_handle_response(resolver, packet, (size_t)n, &from);
+    }
+
+    // unlink finished lookups first, callbacks may start new ones.
+    mnet_dns_request_t* done = NULL;
+    mnet_dns_request_t** link = &resolver->requests;
+    while (*link)
+    {
+        mnet_dns_request_t* request = *link;
+        const int active = request->queries[0].active || request->queries[1].active;
+
+        if (active && request->deadline_ms <= now_ms)
+        {
+            // retry on the next server, until every server had its attempts.
+            if (++request->attempt < resolver->attempts * resolver->server_count)
+            {
+                mnet_dns_send_request(resolver, request, now_ms);
+                link = &request->next;
+                continue;
+            }
+        }
+        else if (active)
+        {
+            link = &request->next;
+            continue;
+        }
+
+        *link = request->next;
+        request->next = done;
+        done = request;
+    }
+
+    int finished = 0;
+    while (done)
+    {
+        mnet_dns_request_t* request = done;
+        done = request->next;
+
+        if (request->answer)
+        {
+            request->callback(resolver, request->name, request->answer, request->udata);
+            free(request);
+            finished++;
+            continue;
+        }
+
+        mnet_dns_result_t result;
+        result.status = mnet_dns_request_status(request);
+        result.ttl = 0;
+
+        if (result.status == mnet_dns_ok)
+        {
+            result.ttl = request->ttl > MNET_DNS_MAX_TTL ? MNET_DNS_MAX_TTL : request->ttl;
+            mnet_dns_cache_store(resolver->cache, request, result.status, result.ttl, now_ms);
+        }
+        else if (result.status == mnet_dns_not_found)
+        {
+            result.ttl = MNET_DNS_NEGATIVE_TTL;
+            mnet_dns_cache_store(resolver->cache, request, result.status, result.ttl, now_ms);
+        }
+
+        mnet_dns_fill_result(&result, request->port, request->count, request->ipv6,
+                             (const uint8_t (*)[16])request->addrs);
+        request->callback(resolver, request->name, &result, request->udata);
+        free(request);
+        finished++;
+    }
+
+    return finished;
 }
 
-int mnet_addr_any_ipv6(struct sockaddr_in6 *addr, uint16_t port)
+int mnet_resolver_timeout(const mnet_resolver_t* resolver, uint64_t now_ms)
 {
-    return mnet_addr_ipv6(addr, NULL, port);
+    if (!resolver || !resolver->requests) return -1;
+
+    // answered ones keep deadline 0, they are due right away.
+    uint64_t nearest = UINT64_MAX;
+    for (const mnet_dns_request_t* r = resolver->requests; r; r = r->next)
+        if (r->deadline_ms < nearest) nearest = r->deadline_ms;
+
+    if (nearest <= now_ms) return 0;
+    return nearest - now_ms > INT32_MAX ? INT32_MAX : (int)(nearest - now_ms);
 }
 
 #endif
\ No newline at end of file